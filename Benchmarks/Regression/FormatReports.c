@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../../include/Whiro.h"
+
+//Compares the formatter of the runtime with fprintf. First, it reports random values of every format
+//with both and checks that the outputs are the same, byte by byte. Then, it measures how long each
+//one takes to write the same reports to /dev/null, and prints the times as CSV. Raw regions, such as
+//unions, are checked and measured in the same way, against the decimal bytes printed by older versions
+//of Whiro and against hexadecimal digits printed with "%02x".
+//Usage: ./FormatReports.out [millions of reports] (default: 4)
+
+extern int DecimalBytes;
+
+//Size of the raw regions, as a union holding a page
+#define REGION_SIZE 4096
+
+static uint64_t State = 88172645463325252ULL;
+
+static uint64_t next() {
+  State ^= State << 13;
+  State ^= State >> 7;
+  State ^= State << 17;
+  return State;
+}
+
+static double nextDouble() {
+  //Mixes small values with two decimals, values around the rounding ties, and arbitrary bit patterns
+  uint64_t Bits = next();
+  switch (Bits % 4) {
+    case 0: return ((int64_t)(next() % 2000001) - 1000000) / 100.0;
+    case 1: return ((int64_t)(next() % 2000001) - 1000000) / 1000.0 + 0.005;
+    case 2: return (double)(int64_t)next() / (double)(1ULL << (next() % 64));
+    default: {
+      double Value;
+      uint64_t Pattern = next();
+      memcpy(&Value, &Pattern, sizeof(double));
+      return Value;
+    }
+  }
+}
+
+static void reportPrintf(FILE* Output, int Format, uint64_t Bits, double Real, long Counter) {
+  switch (Format) {
+    case 0: fprintf(Output, "%s %s %ld : %d\n", "var", "main", Counter, (int)Bits); break;
+    case 1: fprintf(Output, "%s %s %ld : %hi\n", "var", "main", Counter, (short)Bits); break;
+    case 2: fprintf(Output, "%s %s %ld : %ld\n", "var", "main", Counter, (long)Bits); break;
+    case 3: fprintf(Output, "%s %s %ld : %u\n", "var", "main", Counter, (unsigned)Bits); break;
+    case 4: fprintf(Output, "%s %s %ld : %hu\n", "var", "main", Counter, (unsigned short)Bits); break;
+    case 5: fprintf(Output, "%s %s %ld : %lu\n", "var", "main", Counter, (unsigned long)Bits); break;
+    case 6: fprintf(Output, "%s %s %ld : %c\n", "var", "main", Counter, (char)Bits); break;
+    case 7: fprintf(Output, "%s %s %ld : %.2f\n", "var", "main", Counter, (float)Real); break;
+    default: fprintf(Output, "%s %s %ld : %.2lf\n", "var", "main", Counter, Real); break;
+  }
+}
+
+static void reportWhiro(FILE* Output, int Format, uint64_t Bits, double Real, long Counter) {
+  switch (Format) {
+    case 0: WhiroReportI64(Output, "var", "main", Counter, " : ", (int)Bits); break;
+    case 1: WhiroReportI64(Output, "var", "main", Counter, " : ", (short)Bits); break;
+    case 2: WhiroReportI64(Output, "var", "main", Counter, " : ", (long)Bits); break;
+    case 3: WhiroReportU64(Output, "var", "main", Counter, " : ", (unsigned)Bits); break;
+    case 4: WhiroReportU64(Output, "var", "main", Counter, " : ", (unsigned short)Bits); break;
+    case 5: WhiroReportU64(Output, "var", "main", Counter, " : ", (unsigned long)Bits); break;
+    case 6: WhiroReportChar(Output, "var", "main", Counter, " : ", (char)Bits); break;
+    case 7: WhiroReportF64(Output, "var", "main", Counter, " : ", (float)Real); break;
+    default: WhiroReportF64(Output, "var", "main", Counter, " : ", Real); break;
+  }
+}
+
+static void reportBytesPrintf(FILE* Output, const unsigned char* Region, size_t Size, long Counter) {
+  fprintf(Output, "%s %s %ld : ", "var", "main", Counter);
+  for (size_t i = 0; i < Size; i++)
+    fprintf(Output, DecimalBytes ? "%d" : "%02x", DecimalBytes ? (int)(char)Region[i] : Region[i]);
+  fprintf(Output, "\n");
+}
+
+static void reportBytesWhiro(FILE* Output, const unsigned char* Region, size_t Size, long Counter) {
+  WhiroReportBytes(Output, "var", "main", Counter, " : ", Region, Size);
+}
+
+static int compareOutputs(const char* Expected, size_t ExpectedSize, const char* Actual, size_t ActualSize) {
+  if (ExpectedSize == ActualSize && memcmp(Expected, Actual, ExpectedSize) == 0)
+    return 1;
+
+  size_t i = 0;
+  while (i < ExpectedSize && i < ActualSize && Expected[i] == Actual[i])
+    i++;
+  printf("The outputs differ at byte %zu\n", i);
+  return 0;
+}
+
+static int checkBytes(void) {
+  //Regions of every size up to 64 bytes, so the tails that are not encoded sixteen bytes at a time are checked too
+  unsigned char Region[64];
+  for (int Decimal = 0; Decimal <= 1; Decimal++) {
+    DecimalBytes = Decimal;
+    char *Expected = NULL, *Actual = NULL;
+    size_t ExpectedSize = 0, ActualSize = 0;
+    FILE* ExpectedOutput = open_memstream(&Expected, &ExpectedSize);
+    FILE* ActualOutput = open_memstream(&Actual, &ActualSize);
+    for (long i = 0; i < 100000; i++) {
+      size_t Size = (size_t)(next() % 65);
+      for (size_t j = 0; j < Size; j++)
+        Region[j] = (unsigned char)next();
+      reportBytesPrintf(ExpectedOutput, Region, Size, i);
+      reportBytesWhiro(ActualOutput, Region, Size, i);
+    }
+    fclose(ExpectedOutput);
+    fclose(ActualOutput);
+    int Same = compareOutputs(Expected, ExpectedSize, Actual, ActualSize);
+    free(Expected);
+    free(Actual);
+    if (!Same)
+      return 0;
+  }
+  DecimalBytes = 0;
+  return 1;
+}
+
+static double measureBytes(void (*report)(FILE*, const unsigned char*, size_t, long), long Quant) {
+  static unsigned char Region[REGION_SIZE];
+  for (size_t i = 0; i < REGION_SIZE; i++)
+    Region[i] = (unsigned char)next();
+  FILE* Output = fopen("/dev/null", "w");
+  struct timespec Start, End;
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  for (long i = 0; i < Quant; i++)
+    report(Output, Region, REGION_SIZE, i);
+  clock_gettime(CLOCK_MONOTONIC, &End);
+  fclose(Output);
+  return (End.tv_sec - Start.tv_sec) + (End.tv_nsec - Start.tv_nsec) / 1e9;
+}
+
+static double measure(void (*report)(FILE*, int, uint64_t, double, long), long Quant) {
+  FILE* Output = fopen("/dev/null", "w");
+  State = 88172645463325252ULL;
+  struct timespec Start, End;
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  for (long i = 0; i < Quant; i++)
+    report(Output, (int)(i % 9), next(), nextDouble(), i);
+  clock_gettime(CLOCK_MONOTONIC, &End);
+  fclose(Output);
+  return (End.tv_sec - Start.tv_sec) + (End.tv_nsec - Start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char** argv) {
+  long Quant = (argc > 1 ? atol(argv[1]) : 4) * 1000000;
+
+  //Both outputs are written to memory and compared
+  char *Expected = NULL, *Actual = NULL;
+  size_t ExpectedSize = 0, ActualSize = 0;
+  FILE* ExpectedOutput = open_memstream(&Expected, &ExpectedSize);
+  FILE* ActualOutput = open_memstream(&Actual, &ActualSize);
+  for (long i = 0; i < 1000000; i++) {
+    int Format = (int)(next() % 9);
+    uint64_t Bits = next();
+    double Real = nextDouble();
+    long Counter = (long)next();
+    reportPrintf(ExpectedOutput, Format, Bits, Real, Counter);
+    reportWhiro(ActualOutput, Format, Bits, Real, Counter);
+  }
+  fclose(ExpectedOutput);
+  fclose(ActualOutput);
+  if (!compareOutputs(Expected, ExpectedSize, Actual, ActualSize) || !checkBytes())
+    return 1;
+
+  printf("formatter,seconds\n");
+  printf("fprintf,%.3f\n", measure(reportPrintf, Quant));
+  printf("whiro,%.3f\n", measure(reportWhiro, Quant));
+
+  //Each region takes 4096 calls to fprintf with the decimal bytes, so a thousandth of the reports is enough
+  long QuantRegions = Quant / 1000;
+  DecimalBytes = 1;
+  printf("fprintf-union-decimal,%.3f\n", measureBytes(reportBytesPrintf, QuantRegions));
+  printf("whiro-union-decimal,%.3f\n", measureBytes(reportBytesWhiro, QuantRegions));
+  DecimalBytes = 0;
+  printf("whiro-union-hex,%.3f\n", measureBytes(reportBytesWhiro, QuantRegions));
+  return 0;
+}
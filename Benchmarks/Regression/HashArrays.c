@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../../include/Whiro.h"
+
+//Compares the 32-bit hashcode of arrays with the 64-bit hash of their bytes (-hash64). First, it hashes
+//pairs of arrays that differ in a single element and counts how many pairs each hash cannot tell apart.
+//Then, it measures how long each one takes to hash a large array of every kind, and prints the times and
+//the throughput as CSV.
+//Usage: ./HashArrays.out [size of the arrays in MiB] (default: 256)
+
+static uint64_t State = 88172645463325252ULL;
+
+static uint64_t next() {
+  State ^= State << 13;
+  State ^= State >> 7;
+  State ^= State << 17;
+  return State;
+}
+
+static double elapsed(struct timespec Start, struct timespec End) {
+  return (End.tv_sec - Start.tv_sec) + (End.tv_nsec - Start.tv_nsec) / 1e9;
+}
+
+static void countCollisions(const char* Kind, int Format, size_t Elements, void (*change)(void*, size_t)) {
+  //Each pair is an array of random values and a copy with one element changed
+  size_t ElementSize = (Format == 1 || Format == 4) ? 8 : 4;
+  unsigned char *Array = malloc(Elements * ElementSize), *Copy = malloc(Elements * ElementSize);
+  long Narrow = 0, Wide = 0, Pairs = 10000;
+  for (long i = 0; i < Pairs; i++) {
+    for (size_t j = 0; j < Elements * ElementSize; j++)
+      Array[j] = (unsigned char)next();
+    if (Format == 1)
+      for (size_t j = 0; j < Elements; j++)
+        ((double*)Array)[j] = (double)(int64_t)next() / (1 << 20);
+    memcpy(Copy, Array, Elements * ElementSize);
+    change(Copy, (size_t)(next() % Elements));
+    Narrow += WhiroComputeHashcode(Array, Elements, Elements, Format) == WhiroComputeHashcode(Copy, Elements, Elements, Format);
+    Wide += WhiroComputeHashcode64(Array, Elements, Format) == WhiroComputeHashcode64(Copy, Elements, Format);
+  }
+  printf("%s,%ld,%ld,%ld\n", Kind, Pairs, Narrow, Wide);
+  free(Array);
+  free(Copy);
+}
+
+//Changes that the 32-bit hashcode does not see: the high half of a long, and a double by less than one unit
+static void changeHighBits(void* Array, size_t Index) { ((long*)Array)[Index] ^= 1L << 40; }
+static void changeFraction(void* Array, size_t Index) { ((double*)Array)[Index] += 0.25; }
+//Swapping two elements of different rows keeps the sum of the hashcodes of the rows
+static void swapRows(void* Array, size_t Index) {
+  int *Rows = (int*)Array, Other = (int)((Index + 8) % 64), Value = Rows[Index];
+  Rows[Index] = Rows[Other];
+  Rows[Other] = Value;
+}
+
+static void measure(const char* Kind, int Format, size_t Bytes) {
+  size_t ElementSize = (Format == 1 || Format == 4) ? 8 : 4, Elements = Bytes / ElementSize;
+  unsigned char *Array = malloc(Bytes);
+  for (size_t i = 0; i < Elements; i++) {
+    if (Format == 1)
+      ((double*)Array)[i] = (double)(int64_t)next() / (1 << 20);
+    else
+      memcpy(Array + i * ElementSize, &(uint64_t){next()}, ElementSize);
+  }
+
+  struct timespec Start, End;
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  volatile int Narrow = WhiroComputeHashcode(Array, Elements, Elements, Format);
+  clock_gettime(CLOCK_MONOTONIC, &End);
+  double NarrowTime = elapsed(Start, End);
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  volatile uint64_t Wide = WhiroComputeHashcode64(Array, Elements, Format);
+  clock_gettime(CLOCK_MONOTONIC, &End);
+  double WideTime = elapsed(Start, End);
+  printf("%s,%.3f,%.3f,%.2f\n", Kind, NarrowTime, WideTime, Bytes / WideTime / (1 << 30));
+  (void)Narrow;
+  (void)Wide;
+  free(Array);
+}
+
+int main(int argc, char** argv) {
+  size_t Bytes = (size_t)(argc > 1 ? atol(argv[1]) : 256) << 20;
+
+  //The swapped elements must be in the same column of different rows of 8 elements
+  printf("change,pairs,collisions32,collisions64\n");
+  countCollisions("long-high-bits", 4, 64, changeHighBits);
+  countCollisions("double-fraction", 1, 64, changeFraction);
+
+  //The rows are given by the step of the 32-bit hashcode
+  long Swaps = 0, WideSwaps = 0;
+  int Matrix[64], Swapped[64];
+  for (long i = 0; i < 10000; i++) {
+    for (int j = 0; j < 64; j++)
+      Matrix[j] = (int)next();
+    memcpy(Swapped, Matrix, sizeof(Matrix));
+    swapRows(Swapped, (size_t)(next() % 64));
+    Swaps += WhiroComputeHashcode(Matrix, 64, 8, 6) == WhiroComputeHashcode(Swapped, 64, 8, 6);
+    WideSwaps += WhiroComputeHashcode64(Matrix, 64, 6) == WhiroComputeHashcode64(Swapped, 64, 6);
+  }
+  printf("int-rows-swapped,10000,%ld,%ld\n", Swaps, WideSwaps);
+
+  printf("array,seconds32,seconds64,gib-per-second64\n");
+  measure("int", 6, Bytes);
+  measure("long", 4, Bytes);
+  measure("double-quantized", 1, Bytes);
+  WhiroSetArrayHashing(1, 1);
+  measure("double-exact", 1, Bytes);
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+//Builds a heap with many small blocks (the nodes of a list) and some large ones (the
+//vectors held by the nodes). It is meant to measure the inspection of the entire heap.
+//Usage: ./HeapScale.out [thousands of nodes] (default: 1000)
+
+typedef struct node {
+  int key;
+  double weight;
+  int* values;
+  struct node* next;
+} Node;
+
+Node* push(Node* head, int key) {
+  Node* node = (Node*)malloc(sizeof(Node));
+  node->key = key;
+  node->weight = key * 0.25;
+  node->values = NULL;
+  //Every 16th node holds a vector, so the heap mixes blocks of different sizes
+  if (key % 16 == 0) {
+    node->values = (int*)malloc(256 * sizeof(int));
+    for (int i = 0; i < 256; i++)
+      node->values[i] = key + i;
+  }
+  node->next = head;
+  return node;
+}
+
+int main(int argc, char** argv) {
+  int thousands = (argc > 1) ? atoi(argv[1]) : 0;
+  if (thousands <= 0)
+    thousands = 1000;
+
+  Node* head = NULL;
+  for (int i = 0; i < thousands * 1000; i++)
+    head = push(head, i);
+
+  long sum = 0;
+  for (Node* node = head; node != NULL; node = node->next)
+    sum += node->key;
+
+  printf("%d nodes, sum of keys: %ld\n", thousands * 1000, sum);
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+//Loop-heavy kernels. Each one has inner loops whose latches become inspection points with -loops,
+//so the cost of these points dominates the running time of the instrumented program
+
+double MatMul(int N, double A[N][N], double B[N][N], double C[N][N]){
+  for(int i = 0; i < N; i++)
+    for(int j = 0; j < N; j++){
+      double Sum = 0;
+      for(int k = 0; k < N; k++)
+        Sum += A[i][k] * B[k][j];
+      C[i][j] = Sum;
+    }
+  return C[N - 1][N - 1];
+}
+
+long PrefixSums(int N, long* Values, long* Sums){
+  long Running = 0;
+  for(int i = 0; i < N; i++){
+    Running += Values[i];
+    Sums[i] = Running;
+  }
+  return Sums[N - 1];
+}
+
+double Stencil(int N, int Steps, double Grid[N][N], double Next[N][N]){
+  for(int t = 0; t < Steps; t++){
+    for(int i = 1; i < N - 1; i++)
+      for(int j = 1; j < N - 1; j++)
+        Next[i][j] = 0.2 * (Grid[i][j] + Grid[i - 1][j] + Grid[i + 1][j] + Grid[i][j - 1] + Grid[i][j + 1]);
+    for(int i = 1; i < N - 1; i++)
+      for(int j = 1; j < N - 1; j++)
+        Grid[i][j] = Next[i][j];
+  }
+  return Grid[N / 2][N / 2];
+}
+
+int main(int argc, char** argv){
+  int N = argc > 1 ? atoi(argv[1]) : 200;
+  double (*A)[N] = malloc(sizeof(double[N][N]));
+  double (*B)[N] = malloc(sizeof(double[N][N]));
+  double (*C)[N] = malloc(sizeof(double[N][N]));
+  for(int i = 0; i < N; i++)
+    for(int j = 0; j < N; j++){
+      A[i][j] = (i + j) % 7;
+      B[i][j] = (i * j) % 5;
+      C[i][j] = 0;
+    }
+  
+  long* Values = malloc(sizeof(long) * N * N);
+  long* Sums = malloc(sizeof(long) * N * N);
+  for(int i = 0; i < N * N; i++)
+    Values[i] = i % 13;
+  
+  printf("%f\n", MatMul(N, A, B, C));
+  printf("%ld\n", PrefixSums(N * N, Values, Sums));
+  printf("%f\n", Stencil(N, 10, A, C));
+  
+  free(A);
+  free(B);
+  free(C);
+  free(Values);
+  free(Sums);
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Grows vectors with realloc until they reach a multi-GB size. The char vector
+//ends up with more than 2^31 elements, and the interleaved allocations force
+//realloc to move the blocks from time to time.
+//Usage: ./ReallocGrow.out [MiB] (default: 3072 MiB for the char vector)
+
+int numMoves = 0;
+
+char* growBytes(char* bytes, size_t oldSize, size_t newSize) {
+  char* grown = (char*)realloc(bytes, newSize);
+  if (grown == NULL) {
+    printf("Could not grow vector to %zu bytes\n", newSize);
+    exit(1);
+  }
+  if (grown != bytes)
+    numMoves++;
+  memset(grown + oldSize, (int)(newSize % 127), newSize - oldSize);
+  return grown;
+}
+
+long* growLongs(long* longs, size_t oldSize, size_t newSize) {
+  long* grown = (long*)realloc(longs, newSize * sizeof(long));
+  if (grown == NULL) {
+    printf("Could not grow vector to %zu elements\n", newSize);
+    exit(1);
+  }
+  if (grown != longs)
+    numMoves++;
+  for (size_t i = oldSize; i < newSize; i++)
+    grown[i] = (long)i;
+  return grown;
+}
+
+int main(int argc, char** argv) {
+  size_t targetMiB = 3072;
+  if (argc > 1 && atol(argv[1]) > 0)
+    targetMiB = (size_t)atol(argv[1]);
+
+  size_t targetBytes = targetMiB << 20;
+  size_t size = 1;
+  char* bytes = (char*)malloc(size);
+  bytes[0] = 0;
+  long* longs = NULL;
+  size_t longSize = 0;
+  while (size < targetBytes) {
+    size_t newSize = (size * 2 > targetBytes) ? targetBytes : size * 2;
+    bytes = growBytes(bytes, size, newSize);
+    size = newSize;
+    //Keep a smaller vector of longs growing alongside, so the allocator
+    //cannot always extend the blocks in place
+    if (longSize < (size >> 4)) {
+      longs = growLongs(longs, longSize, size >> 4);
+      longSize = size >> 4;
+    }
+  }
+
+  //The vectors are not released, so the inspection point of main reports them
+  printf("Grew %zu bytes and %zu longs (%d moves)\n", size, longSize, numMoves);
+  return 0;
+}
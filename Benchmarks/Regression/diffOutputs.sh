@@ -0,0 +1,50 @@
+#!/bin/bash
+
+#Measures the comparison of two large output files. LoopKernels.c is instrumented with -loops,
+#compiled with llc -O0 and with llc -O2, and both programs are run to produce their outputs. The
+#outputs are compared with diff and with whiro-diff for each number of threads. SIZE sets the size
+#of the kernels, and so the size of the outputs (a few GB with the default). The results are printed
+#as CSV.
+#Usage: LLVM=/path/to/llvm/build/bin ./diffOutputs.sh
+
+set -e
+WHIRODIR=${WHIRODIR:-../../}
+#LLVM=<path/to/llvm/build/dir
+source $WHIRODIR/Benchmarks/components.sh
+THREADS=${THREADS:-"1 2 4 8 16"}
+SIZE=${SIZE:-400}
+
+Bitcodes=""
+for Component in $COMPONENTS; do
+  $LLVM/clang -O3 -c -Wall -Wextra -emit-llvm $WHIRODIR/lib/$Component.c -o $WHIRODIR/lib/$Component.bc
+  Bitcodes="$Bitcodes $WHIRODIR/lib/$Component.bc"
+done
+gcc -O2 $WHIRODIR/tools/WhiroDiff.c -o whiro-diff -lpthread
+
+$LLVM/clang -Xclang -disable-O0-optnone -fno-discard-value-names -c -emit-llvm -g LoopKernels.c -o LoopKernels.bc
+$LLVM/opt -mem2reg -mergereturn LoopKernels.bc -o LoopKernels.bc
+$LLVM/opt -load $WHIRODIR/build/lib/libMemoryMonitor.so -memoryMonitor -loops LoopKernels.bc -o LoopKernels.wbc
+$LLVM/llvm-link $Bitcodes LoopKernels.wbc -o LoopKernels.wbc
+for Level in 0 2; do
+  $LLVM/llc -O$Level LoopKernels.wbc -o LoopKernels.s
+  $LLVM/clang LoopKernels.s -o LoopKernels.out -lpthread
+  ./LoopKernels.out $SIZE > /dev/null
+  mv LoopKernels.c_Output LoopKernels.O$Level.Output
+done
+
+function measure(){
+  Name=$1
+  shift
+  Start=$(date +%s.%N)
+  "$@" LoopKernels.O0.Output LoopKernels.O2.Output > /dev/null 2>&1 || true
+  End=$(date +%s.%N)
+  echo "$Name,$(echo "$End - $Start" | bc)"
+}
+
+echo "# $(du -h LoopKernels.O0.Output | cut -f1) per output"
+echo "tool,seconds"
+measure diff diff
+for Threads in $THREADS; do
+  measure whiro-diff-$Threads ./whiro-diff -j $Threads
+done
+rm -f LoopKernels.bc LoopKernels.wbc LoopKernels.s LoopKernels.out LoopKernels.O0.Output LoopKernels.O2.Output whiro-diff
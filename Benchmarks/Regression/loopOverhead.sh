@@ -0,0 +1,52 @@
+#!/bin/bash
+
+#Measures the overhead of inspection points at the latches of loops. LoopKernels.c is run without
+#instrumentation and instrumented with -loops. If BASELINE points to another build of
+#libMemoryMonitor.so, e.g. one that does not hoist the inputs of inspection points, it is measured
+#with -loops as well. The results are printed as CSV.
+#Usage: LLVM=/path/to/llvm/build/bin ./loopOverhead.sh
+
+set -e
+WHIRODIR=${WHIRODIR:-../../}
+#LLVM=<path/to/llvm/build/dir
+source $WHIRODIR/Benchmarks/components.sh
+PLUGIN=$WHIRODIR/build/lib/libMemoryMonitor.so
+STRIDE=${STRIDE:-1000}
+SIZE=${SIZE:-200}
+
+Bitcodes=""
+for Component in $COMPONENTS; do
+  $LLVM/clang -O3 -c -Wall -Wextra -emit-llvm $WHIRODIR/lib/$Component.c -o $WHIRODIR/lib/$Component.bc
+  Bitcodes="$Bitcodes $WHIRODIR/lib/$Component.bc"
+done
+
+$LLVM/clang -Xclang -disable-O0-optnone -fno-discard-value-names -c -emit-llvm -g LoopKernels.c -o LoopKernels.bc
+$LLVM/opt -mem2reg -mergereturn LoopKernels.bc -o LoopKernels.bc
+
+function measure(){
+  Start=$(date +%s.%N)
+  ./LoopKernels.out $SIZE > /dev/null
+  End=$(date +%s.%N)
+  echo "$1,$(echo "$End - $Start" | bc)"
+}
+
+function instrumentAndMeasure(){
+  Name=$1
+  Plugin=$2
+  shift 2
+  $LLVM/opt -load $Plugin -memoryMonitor -loops -stride=$STRIDE "$@" LoopKernels.bc -o LoopKernels.wbc
+  $LLVM/llvm-link $Bitcodes LoopKernels.wbc -o LoopKernels.wbc
+  $LLVM/llc -O2 LoopKernels.wbc -o LoopKernels.s
+  $LLVM/clang LoopKernels.s -o LoopKernels.out -lpthread
+  measure $Name
+}
+
+echo "version,seconds"
+$LLVM/llc -O2 LoopKernels.bc -o LoopKernels.s
+$LLVM/clang LoopKernels.s -o LoopKernels.out
+measure native
+if [[ -n $BASELINE ]]; then
+  instrumentAndMeasure baseline $BASELINE
+fi
+instrumentAndMeasure loops $PLUGIN
+rm -f LoopKernels.bc LoopKernels.wbc LoopKernels.s LoopKernels.out LoopKernels.c_Output
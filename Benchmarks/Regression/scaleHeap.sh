@@ -0,0 +1,37 @@
+#!/bin/bash
+
+#Measures how the inspection of the entire heap scales with the size of the heap and
+#the number of workers. HeapScale.c is instrumented once for each number of workers and
+#run with each heap size. The results are printed as CSV.
+#Usage: LLVM=/path/to/llvm/build/bin ./scaleHeap.sh
+
+set -e
+WHIRODIR=${WHIRODIR:-../../}
+#LLVM=<path/to/llvm/build/dir
+source $WHIRODIR/Benchmarks/components.sh
+WORKERS=${WORKERS:-"0 1 2 4 8 16 32 64"}
+SIZES=${SIZES:-"100 1000 4000"}
+
+Bitcodes=""
+for Component in $COMPONENTS; do
+  $LLVM/clang -O3 -c -Wall -Wextra -emit-llvm $WHIRODIR/lib/$Component.c -o $WHIRODIR/lib/$Component.bc
+  Bitcodes="$Bitcodes $WHIRODIR/lib/$Component.bc"
+done
+
+$LLVM/clang -Xclang -disable-O0-optnone -fno-discard-value-names -c -emit-llvm -g HeapScale.c -o HeapScale.bc
+$LLVM/opt -mem2reg -mergereturn HeapScale.bc -o HeapScale.bc
+
+echo "workers,thousands of nodes,seconds"
+for Workers in $WORKERS; do
+  $LLVM/opt -load $WHIRODIR/build/lib/libMemoryMonitor.so -memoryMonitor -om -fp -fp-workers=$Workers HeapScale.bc -o HeapScale.wbc
+  $LLVM/llvm-link $Bitcodes HeapScale.wbc -o HeapScale.wbc
+  $LLVM/llc -O2 HeapScale.wbc -o HeapScale.s
+  $LLVM/clang HeapScale.s -o HeapScale.out -lpthread
+  for Size in $SIZES; do
+    Start=$(date +%s.%N)
+    ./HeapScale.out $Size > /dev/null
+    End=$(date +%s.%N)
+    echo "$Workers,$Size,$(echo "$End - $Start" | bc)"
+  done
+done
+rm -f HeapScale.bc HeapScale.wbc HeapScale.s HeapScale.out HeapScale.c_Output
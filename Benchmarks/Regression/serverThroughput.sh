@@ -0,0 +1,56 @@
+#!/bin/bash
+
+#Measures how many programs per second are instrumented by separate invocations of opt and by a
+#whiro-cc server. The programs of the Suite and Regression folders are compiled to bytecodes, and
+#each one is copied COPIES times, as a batch of small programs that include the same headers. The
+#server runs with JOBS threads. The options of the pass are given by FLAGS. The results are printed
+#as CSV.
+#Usage: LLVM=/path/to/llvm/build/bin ./serverThroughput.sh
+
+set -e
+WHIRODIR=${WHIRODIR:-../../}
+#LLVM=<path/to/llvm/build/dir
+PLUGIN=$WHIRODIR/build/lib/libMemoryMonitor.so
+WHIROCC=$WHIRODIR/build/bin/whiro-cc
+COPIES=${COPIES:-20}
+JOBS=${JOBS:-$(nproc)}
+FLAGS=${FLAGS:-""}
+SOCKET=$(pwd)/whiro.sock
+
+mkdir -p Batch
+for Source in ../Suite/*.c *.c; do
+  Program=$(basename ${Source%.c})
+  $LLVM/clang -Xclang -disable-O0-optnone -fno-discard-value-names -c -emit-llvm -g $Source -o Batch/$Program.bc
+  for Copy in $(seq $COPIES); do
+    cp Batch/$Program.bc Batch/$Program$Copy.bc
+  done
+  rm Batch/$Program.bc
+done
+cd Batch
+Quant=$(ls *.bc | wc -l)
+
+function rate(){
+  awk "BEGIN { printf \"%.2f\", $Quant / (($2 - $1) / 1e9) }"
+}
+
+echo "version,programs,programs per second"
+Start=$(date +%s%N)
+for Bytecode in *.bc; do
+  $LLVM/opt -mem2reg -mergereturn $Bytecode -o ${Bytecode%.bc}.wbc
+  $LLVM/opt -load $PLUGIN -memoryMonitor $FLAGS ${Bytecode%.bc}.wbc -o ${Bytecode%.bc}.wbc
+done
+End=$(date +%s%N)
+echo "opt,$Quant,$(rate $Start $End)"
+
+rm -f *.wbc
+$WHIROCC -serve=$SOCKET -emit-wbc -j $JOBS $FLAGS 2> /dev/null &
+Server=$!
+while [[ ! -S $SOCKET ]]; do sleep 0.1; done
+Start=$(date +%s%N)
+$WHIROCC -connect=$SOCKET -j $JOBS *.bc
+End=$(date +%s%N)
+echo "server,$Quant,$(rate $Start $End)"
+kill $Server
+
+cd ..
+rm -rf Batch $SOCKET
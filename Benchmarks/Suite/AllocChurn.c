@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//High allocation churn: blocks of many sizes are allocated, resized and freed all the time, so the
+//Heap Table is updated at almost every instruction and is full of freed entries
+
+struct Buffer {
+  char* Data;
+  long Size;
+  struct Buffer* Next;
+};
+
+struct Buffer* Live = NULL;
+long Allocated = 0;
+unsigned Seed = 42;
+
+unsigned NextRandom(){
+  Seed = Seed * 1664525 + 1013904223;
+  return Seed >> 8;
+}
+
+struct Buffer* Acquire(long Size){
+  struct Buffer* B = (struct Buffer*) malloc(sizeof(struct Buffer));
+  B->Data = (char*) malloc(Size);
+  memset(B->Data, Size & 0xff, Size);
+  B->Size = Size;
+  B->Next = Live;
+  Live = B;
+  Allocated += Size;
+  return B;
+}
+
+void Grow(struct Buffer* B){
+  B->Data = (char*) realloc(B->Data, B->Size * 2);
+  memset(B->Data + B->Size, 1, B->Size);
+  Allocated += B->Size;
+  B->Size *= 2;
+}
+
+void ReleaseHalf(){
+  struct Buffer** Link = &Live;
+  int Turn = 0;
+  while(*Link){
+    struct Buffer* B = *Link;
+    if(Turn++ % 2){
+      *Link = B->Next;
+      Allocated -= B->Size;
+      free(B->Data);
+      free(B);
+    }
+    else
+      Link = &B->Next;
+  }
+}
+
+int main(int argc, char** argv){
+  int Rounds = argc > 1 ? atoi(argv[1]) : 20;
+  long Checksum = 0;
+  for(int r = 0; r < Rounds; r++){
+    for(int i = 0; i < 500; i++){
+      struct Buffer* B = Acquire(16 + NextRandom() % 512);
+      if(i % 7 == 0)
+        Grow(B);
+    }
+    ReleaseHalf();
+    for(struct Buffer* B = Live; B; B = B->Next)
+      Checksum += B->Data[B->Size - 1];
+  }
+  printf("%ld %ld\n", Checksum, Allocated);
+  return 0;
+}
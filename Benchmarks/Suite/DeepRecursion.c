@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+//Deep recursion. Every call is an inspection point, so the cost of the instrumentation grows with
+//the number of calls and with the number of live frames
+
+long Depth = 0;
+
+long SumDown(long N, long Acc){
+  Depth++;
+  if(N == 0)
+    return Acc;
+  long Next = SumDown(N - 1, Acc + N);
+  return Next;
+}
+
+long Ackermann(long M, long N){
+  if(M == 0)
+    return N + 1;
+  if(N == 0)
+    return Ackermann(M - 1, 1);
+  return Ackermann(M - 1, Ackermann(M, N - 1));
+}
+
+int Fibonacci(int N){
+  if(N < 2)
+    return N;
+  int Left = Fibonacci(N - 1);
+  int Right = Fibonacci(N - 2);
+  return Left + Right;
+}
+
+int main(int argc, char** argv){
+  int Scale = argc > 1 ? atoi(argv[1]) : 20;
+  long Sum = SumDown(Scale * 1000L, 0);
+  long Ack = Ackermann(2, Scale * 10L);
+  int Fib = Fibonacci(Scale);
+  printf("%ld %ld %d %ld\n", Sum, Ack, Fib, Depth);
+  return 0;
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+//Large arrays in the three memory segments. Whiro reports arrays by their hashcodes, so the cost
+//of each inspection point grows with the size of the arrays
+
+#define STATIC_SIZE 1000000
+
+double StaticGrid[STATIC_SIZE];
+int StaticCounts[STATIC_SIZE / 4];
+
+void Smooth(double* Data, long N){
+  for(long i = 1; i < N - 1; i++)
+    Data[i] = (Data[i - 1] + Data[i] + Data[i + 1]) / 3.0;
+}
+
+long Histogram(int* Counts, long Buckets, double* Data, long N){
+  long Max = 0;
+  for(long i = 0; i < N; i++){
+    long Bucket = (long)(Data[i] * 7.0) % Buckets;
+    if(Bucket < 0)
+      Bucket = -Bucket;
+    if(++Counts[Bucket] > Max)
+      Max = Counts[Bucket];
+  }
+  return Max;
+}
+
+double StackWork(int Steps){
+  float Local[4096];
+  for(int i = 0; i < 4096; i++)
+    Local[i] = i * 0.5f;
+  double Total = 0;
+  for(int s = 0; s < Steps; s++)
+    for(int i = 0; i < 4096; i++)
+      Total += Local[(i * 31 + s) % 4096];
+  return Total;
+}
+
+int main(int argc, char** argv){
+  int Rounds = argc > 1 ? atoi(argv[1]) : 10;
+  long HeapSize = 4 * STATIC_SIZE;
+  double* HeapGrid = (double*) malloc(sizeof(double) * HeapSize);
+  long* HeapIndex = (long*) malloc(sizeof(long) * HeapSize);
+  for(long i = 0; i < HeapSize; i++){
+    HeapGrid[i] = (i % 1000) / 10.0;
+    HeapIndex[i] = (i * 7919) % HeapSize;
+  }
+  for(long i = 0; i < STATIC_SIZE; i++)
+    StaticGrid[i] = (i % 500) / 5.0;
+
+  long Max = 0;
+  double Total = 0;
+  for(int r = 0; r < Rounds; r++){
+    Smooth(StaticGrid, STATIC_SIZE);
+    Smooth(HeapGrid, HeapSize);
+    Max += Histogram(StaticCounts, STATIC_SIZE / 4, HeapGrid, HeapSize);
+    Total += StackWork(4);
+  }
+  printf("%ld %.2f %.2f %ld\n", Max, Total, HeapGrid[HeapIndex[HeapSize / 2]], HeapIndex[1]);
+  free(HeapGrid);
+  free(HeapIndex);
+  return 0;
+}
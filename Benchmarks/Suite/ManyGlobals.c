@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+//A program with many static variables of all kinds of types, updated by many small functions.
+//Every inspection point reports all of them, unless only the stack or the heap is inspected
+
+struct Account {
+  long Id;
+  double Balance;
+  char Owner[16];
+  short Flags;
+};
+
+union Register {
+  int Word;
+  float Real;
+  unsigned char Bytes[4];
+};
+
+typedef struct Account Account;
+
+int Counter0, Counter1, Counter2, Counter3, Counter4, Counter5, Counter6, Counter7;
+long Total0, Total1, Total2, Total3;
+unsigned Hash0, Hash1, Hash2, Hash3;
+double Rate0 = 0.5, Rate1 = 1.5, Rate2 = 2.5, Rate3 = 3.5;
+float Ratio0, Ratio1;
+char Letter = 'a';
+unsigned char Byte;
+short Small;
+unsigned long long Wide;
+const int Limit = 1000;
+static int Hidden = 7;
+Account Accounts[64];
+Account Single;
+union Register Registers[8];
+int Matrix[32][32];
+int* Cursor = &Counter0;
+Account* Current;
+
+void Step0(int i){ Counter0 += i; Total0 += Counter0; Hash0 = Hash0 * 31 + i; }
+void Step1(int i){ Counter1 ^= i; Total1 -= Counter1; Hash1 = Hash1 * 37 + i; Rate0 *= 1.0001; }
+void Step2(int i){ Counter2 = i % 17; Total2 += i * 3; Hash2 += Hash1; Ratio0 = i / 3.0f; }
+void Step3(int i){ Counter3++; Total3 = Total0 + Total1; Hash3 ^= Hash2; Ratio1 += 0.5f; }
+void Step4(int i){ Counter4 = Counter3 * 2; Letter = 'a' + i % 26; Byte = i; Small = -i; }
+void Step5(int i){ Counter5 += Hidden; Wide += (unsigned long long) i << 20; Rate1 += Rate0; }
+void Step6(int i){ Counter6 = Limit - i % Limit; Matrix[i % 32][(i / 32) % 32] += i; Rate2 = Rate1 / 2; }
+void Step7(int i){
+  Counter7 = i;
+  Current = &Accounts[i % 64];
+  Current->Balance += Rate3;
+  Current->Flags = i % 3;
+  Single = *Current;
+  Registers[i % 8].Word = i;
+  Cursor = (i % 2) ? &Counter1 : &Counter0;
+}
+
+int main(int argc, char** argv){
+  int N = argc > 1 ? atoi(argv[1]) : 2000;
+  for(int i = 0; i < 64; i++){
+    Accounts[i].Id = i;
+    snprintf(Accounts[i].Owner, sizeof(Accounts[i].Owner), "owner%d", i);
+  }
+  for(int i = 0; i < N; i++){
+    Step0(i); Step1(i); Step2(i); Step3(i);
+    Step4(i); Step5(i); Step6(i); Step7(i);
+  }
+  printf("%ld %u %.2f %d\n", Total3, Hash3, Rate2, *Cursor);
+  return 0;
+}
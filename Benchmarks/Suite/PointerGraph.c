@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+//A graph of heap nodes linked by pointers, with shared nodes and cycles. Tracking pointers (-pr)
+//and inspecting the entire heap (-fp) follow every edge of the graph
+
+struct Vertex {
+  int Id;
+  double Weight;
+  struct Vertex* Next;
+  struct Vertex* Edges[4];
+  struct Edge* Labels;
+};
+
+struct Edge {
+  int Label;
+  struct Edge* Next;
+};
+
+struct Graph {
+  int QuantVertices;
+  struct Vertex* First;
+  struct Vertex** Index;
+};
+
+struct Graph* Global;
+unsigned Seed = 12345;
+
+unsigned NextRandom(){
+  Seed = Seed * 1103515245 + 12345;
+  return (Seed / 65536) % 32768;
+}
+
+struct Vertex* AddVertex(struct Graph* G, int Id){
+  struct Vertex* V = (struct Vertex*) calloc(1, sizeof(struct Vertex));
+  V->Id = Id;
+  V->Weight = Id * 0.25;
+  V->Next = G->First;
+  G->First = V;
+  G->Index[Id] = V;
+  return V;
+}
+
+void Connect(struct Vertex* From, struct Vertex* To, int Slot){
+  From->Edges[Slot] = To;
+  struct Edge* E = (struct Edge*) malloc(sizeof(struct Edge));
+  E->Label = To->Id;
+  E->Next = From->Labels;
+  From->Labels = E;
+}
+
+double Relax(struct Graph* G, int Rounds){
+  double Total = 0;
+  for(int r = 0; r < Rounds; r++){
+    for(struct Vertex* V = G->First; V; V = V->Next){
+      for(int s = 0; s < 4; s++){
+        if(V->Edges[s] && V->Edges[s]->Weight > V->Weight + 1)
+          V->Edges[s]->Weight = V->Weight + 1;
+      }
+      Total += V->Weight;
+    }
+  }
+  return Total;
+}
+
+int main(int argc, char** argv){
+  int N = argc > 1 ? atoi(argv[1]) : 1000;
+  Global = (struct Graph*) malloc(sizeof(struct Graph));
+  Global->QuantVertices = N;
+  Global->First = NULL;
+  Global->Index = (struct Vertex**) calloc(N, sizeof(struct Vertex*));
+  for(int i = 0; i < N; i++)
+    AddVertex(Global, i);
+  for(int i = 0; i < N; i++)
+    for(int s = 0; s < 4; s++)
+      Connect(Global->Index[i], Global->Index[NextRandom() % N], s);
+
+  double Total = Relax(Global, 10);
+  printf("%.2f\n", Total);
+  return 0;
+}
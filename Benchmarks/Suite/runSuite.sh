@@ -0,0 +1,113 @@
+#!/bin/bash
+
+#Runs the benchmark suite. Every program in this folder is built without instrumentation and
+#instrumented with each mode in MODES, and every build is run REPEAT times. For each run, the
+#wall time, the peak resident memory and the size of the output file are written as CSV to
+#RESULTS, so the results of different versions of Whiro can be compared.
+#A mode is a list of options of the pass separated by commas, such as "-om,-pr". The mode
+#"native" is the program without instrumentation. Runs longer than TIMEOUT seconds are stopped
+#and recorded as "timeout". If a mode contains "lto", the program is optimized together with
+#the runtime, so hot runtime calls can be inlined; "native,lto" is the baseline of these modes.
+#Usage: LLVM=/path/to/llvm/build/bin ./runSuite.sh
+
+set -e
+WHIRODIR=${WHIRODIR:-../../}
+#LLVM=<path/to/llvm/build/dir
+source $WHIRODIR/Benchmarks/components.sh
+PLUGIN=${PLUGIN:-$WHIRODIR/build/lib/libMemoryMonitor.so}
+MODES=${MODES:-"native -om -stk -hp -stc -pr -fp"}
+PROGRAMS=${PROGRAMS:-$(ls *.c)}
+REPEAT=${REPEAT:-3}
+TIMEOUT=${TIMEOUT:-600}
+RESULTS=${RESULTS:-suite.csv}
+
+#GNU time reports the peak resident memory. Without it, only the wall time is measured
+TIME=""
+if /usr/bin/time -f "%M" true > /dev/null 2>&1; then
+  TIME="/usr/bin/time -f %M -o Run.rss"
+fi
+
+Bitcodes=""
+for Component in $COMPONENTS; do
+  $LLVM/clang -O3 -c -Wall -Wextra -emit-llvm $RUNTIME_FLAGS $WHIRODIR/lib/$Component.c -o $WHIRODIR/lib/$Component.bc
+  Bitcodes="$Bitcodes $WHIRODIR/lib/$Component.bc"
+done
+$LLVM/llvm-link $Bitcodes -o $WHIRODIR/lib/WhiroRuntime.bc
+$LLVM/opt -O3 $WHIRODIR/lib/WhiroRuntime.bc -o $WHIRODIR/lib/WhiroRuntime.bc
+
+function build(){
+  Program=$1
+  Mode=$2
+  Options=""
+  Lto=false
+  for Option in ${Mode//,/ }; do
+    case $Option in
+      "lto")Lto=true;;
+      "native");;
+      *)Options="$Options $Option";;
+    esac
+  done
+  if [[ $Mode == native* ]]; then
+    cp $Program.bc $Program.wbc
+    if [[ $Lto = true ]]; then
+      $LLVM/opt -O2 $Program.wbc -o $Program.wbc
+    fi
+    $LLVM/llc -O2 $Program.wbc -o $Program.s
+    $LLVM/clang $Program.s -o $Program.out -lm
+    return
+  fi
+  $LLVM/opt -load $PLUGIN -memoryMonitor $Options $Program.bc -o $Program.wbc
+  if [[ $Lto = true ]]; then
+    #The runtime is optimized together with the program, so its hot calls can be inlined
+    $LLVM/llvm-link $WHIRODIR/lib/WhiroRuntime.bc $Program.wbc -o $Program.wbc
+    $LLVM/opt -O2 $Program.wbc -o $Program.wbc
+  else
+    $LLVM/llvm-link $Bitcodes $Program.wbc -o $Program.wbc
+  fi
+  $LLVM/llc -O2 $Program.wbc -o $Program.s
+  $LLVM/clang $Program.s -o $Program.out -lpthread -lm
+}
+
+function measure(){
+  Program=$1
+  Mode=$2
+  Run=$3
+  rm -f $Program.c_Output Run.rss
+  Start=$(date +%s%N)
+  Status=0
+  timeout $TIMEOUT $TIME ./$Program.out > /dev/null 2>&1 || Status=$?
+  End=$(date +%s%N)
+
+  Seconds=$(awk "BEGIN { printf \"%.3f\", ($End - $Start) / 1e9 }")
+  if [[ $Status -eq 124 ]]; then
+    Seconds="timeout"
+  elif [[ $Status -ne 0 ]]; then
+    Seconds="error"
+  fi
+  Rss="NA"
+  if [[ -s Run.rss ]]; then
+    Rss=$(tail -n 1 Run.rss)
+  fi
+  Bytes=0
+  if [[ -f $Program.c_Output ]]; then
+    Bytes=$(stat -c %s $Program.c_Output)
+  fi
+  echo "$Program,$Mode,$Run,$Seconds,$Rss,$Bytes" >> $RESULTS
+}
+
+echo "program,mode,run,seconds,peak rss (KB),output bytes" > $RESULTS
+for Source in $PROGRAMS; do
+  Program=${Source%.c}
+  $LLVM/clang -Xclang -disable-O0-optnone -fno-discard-value-names -c -emit-llvm -g $Source -o $Program.bc
+  $LLVM/opt -mem2reg -mergereturn $Program.bc -o $Program.bc
+  for Mode in $MODES; do
+    echo "Running $Program with $Mode"
+    build $Program $Mode
+    for Run in $(seq $REPEAT); do
+      measure $Program $Mode $Run
+    done
+  done
+  rm -f $Program.bc $Program.wbc $Program.s $Program.out $Program.c_Output ${Program}_TypeTable.bin
+done
+rm -f Run.rss
+echo "Results written to $RESULTS"
@@ -0,0 +1,3 @@
+#Runtime components linked into every instrumented program. The scripts source this file, and CMake reads the
+#list from it to build the runtime libraries
+COMPONENTS="HeapTable TypeTable CompositeInspector ArrayHashCalculator HeapHasher Snapshot ParallelHeap CallProfile StaticTracker Watchpoints CheckpointIndex CheckpointReader ReferenceChecker RuntimeProfile SharedRuntime Formatter HashTree"
@@ -1,8 +1,9 @@
 #!/bin/bash
 
 set -e
-WHIRODIR=../
+WHIRODIR=${WHIRODIR:-../}
 #LLVM=<path/to/llvm/build/dir
+source $WHIRODIR/Benchmarks/components.sh
 
 debugMM=""
 debugTT=""
@@ -12,6 +13,10 @@ static=""
 onlymain=""
 precise=""
 fullheap=""
+hashheap=""
+fork=""
+loops=""
+lto=false
 help=false
 
 function usage(){
@@ -25,15 +30,23 @@ function usage(){
   echo " -stc: inspect only static-allocated data"
   echo " -hp:  inspect only heap-allocated data"
   echo " -fp:  report the entire heap at every inspection point"
+  echo " -hh:  report heap graphs as structural hashcodes"
+  echo " -loops: create inspection points at the latches of loops"
+  echo " -fork: report the program state from forked snapshots"
   echo " -pr:   enable Precise instrumentation mode (track the contents pointed by pointer variables)"
+  echo " -lto:  optimize the instrumented program together with the runtime, inlining hot runtime calls"
   echo " -h:   displays this help"
 }
 
 function compileComponents(){
-  $LLVM/clang -O3 -c -w -emit-llvm $WHIRODIR/lib/HeapTable.c -o $WHIRODIR/lib/HeapTable.bc
-  $LLVM/clang -O3 -c -w -emit-llvm $WHIRODIR/lib/TypeTable.c -o $WHIRODIR/lib/TypeTable.bc
-  $LLVM/clang -O3 -c -w -emit-llvm $WHIRODIR/lib/CompositeInspector.c -o $WHIRODIR/lib/CompositeInspector.bc
-  $LLVM/clang -O3 -c -w -emit-llvm $WHIRODIR/lib/ArrayHashCalculator.c -o $WHIRODIR/lib/ArrayHashCalculator.bc
+  Bitcodes=""
+  for Component in $COMPONENTS; do
+    $LLVM/clang -O3 -c -Wall -Wextra -emit-llvm $RUNTIME_FLAGS $WHIRODIR/lib/$Component.c -o $WHIRODIR/lib/$Component.bc
+    Bitcodes="$Bitcodes $WHIRODIR/lib/$Component.bc"
+  done
+  #The components are linked only once, into a single optimized bitcode
+  $LLVM/llvm-link $Bitcodes -o $WHIRODIR/lib/WhiroRuntime.bc
+  $LLVM/opt -O3 $WHIRODIR/lib/WhiroRuntime.bc -o $WHIRODIR/lib/WhiroRuntime.bc
 }
 
 function instrumentAndRun(){
@@ -43,13 +56,13 @@ function instrumentAndRun(){
   fi
   $LLVM/clang -Xclang -disable-O0-optnone -fno-discard-value-names -c -emit-llvm -g $1 -o "${ProgramName}.bc"
   $LLVM/opt -mem2reg -mergereturn "${ProgramName}.bc" -o "${ProgramName}.bc"
-  $LLVM/opt -load $WHIRODIR/build/lib/libMemoryMonitor.so -memoryMonitor $debugMM $debugTT $stack $heap $static $onlymain $precise $fullheap -stats "${ProgramName}.bc" -S -o "${ProgramName}.wbc"
-  $LLVM/llvm-link $WHIRODIR/lib/ArrayHashCalculator.bc "${ProgramName}.wbc" -o "${ProgramName}.wbc"
-  $LLVM/llvm-link $WHIRODIR/lib/CompositeInspector.bc "${ProgramName}.wbc" -o "${ProgramName}.wbc"
-  $LLVM/llvm-link $WHIRODIR/lib/TypeTable.bc "${ProgramName}.wbc" -o "${ProgramName}.wbc"
-  $LLVM/llvm-link $WHIRODIR/lib/HeapTable.bc "${ProgramName}.wbc" -o "${ProgramName}.wbc"
+  $LLVM/opt -load $WHIRODIR/build/lib/libMemoryMonitor.so -memoryMonitor $debugMM $debugTT $stack $heap $static $onlymain $precise $fullheap $hashheap $fork $loops -stats "${ProgramName}.bc" -S -o "${ProgramName}.wbc"
+  $LLVM/llvm-link $WHIRODIR/lib/WhiroRuntime.bc "${ProgramName}.wbc" -o "${ProgramName}.wbc"
+  if [[ "$lto" = true ]]; then
+    $LLVM/opt -O2 "${ProgramName}.wbc" -o "${ProgramName}.wbc"
+  fi
   $LLVM/llc "${ProgramName}.wbc" -o "${ProgramName}.s"
-  $LLVM/clang "${ProgramName}.s" -o "${ProgramName}.out"
+  $LLVM/clang "${ProgramName}.s" -o "${ProgramName}.out" -lpthread
   echo "Running"
   echo ""
   ./"${ProgramName}.out" a
@@ -64,8 +77,12 @@ for arg in "$@"; do
     "-stk")stack="-stk";;
     "-stc")static="-stc";;
     "-hp")heap="-hp";;
-    "-fh")fullheap="-fh";;
+    "-fp")fullheap="-fp";;
+    "-hh")hashheap="-hh";;
+    "-fork")fork="-fork";;
+    "-loops")loops="-loops";;
     "-pr")precise="-pr";;	
+    "-lto")lto=true;;
     "-h")help=true;;
   esac
 done
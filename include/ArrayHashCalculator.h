@@ -7,7 +7,7 @@
 /**
  * This method returns the array index as string to print pretty array dimensions.
  * @param Index is the index of the array.
- * @return the string corresponding to that array index.
+ * @return the string corresponding to that array index, which the caller frees.
  */
 char* WhiroGetArrayIndexAsString(int Index);
 
@@ -18,7 +18,7 @@ char* WhiroGetArrayIndexAsString(int Index);
  * @param Format is the type of the elements of the array.
  * @return the hashcode.
  */
-int WhiroComputeHashcode1D(void* Array, int Size, int Format);
+int WhiroComputeHashcode1D(void* Array, size_t Size, int Format);
 
 /**
  * This method computes the hashcode for a ND array. It traverses the array in a
@@ -30,6 +30,104 @@ int WhiroComputeHashcode1D(void* Array, int Size, int Format);
  * @param Total_Elements is the amout of elements of the array.
  * @return the hashcode computed for this array.
  */
-int WhiroComputeHashcode(void* Array, int TotalElements, int Step, int Format);
+int WhiroComputeHashcode(void* Array, size_t TotalElements, size_t Step, int Format);
+
+/**
+ * This method mixes a 64-bit value into a 64-bit hashcode. It is used to combine many values,
+ * e.g. the fields of a heap graph, into a single hashcode.
+ * @param Hashcode is the hashcode computed so far.
+ * @param Value is the value to be mixed into it.
+ * @return the new hashcode.
+ */
+uint64_t WhiroHashCombine(uint64_t Hashcode, uint64_t Value);
+
+/**
+ * This method sets how arrays and floating-point values are hashed.
+ * @param WideHashArg is true to hash arrays with the 64-bit hash of their bytes instead of the 32-bit hashcode.
+ * @param ExactRealsArg is true to hash floating-point values by their bits instead of quantizing them with FpPrecision.
+ */
+void WhiroSetArrayHashing(int WideHashArg, int ExactRealsArg);
+
+/**
+ * This method rounds a floating-point value to the precision Whiro uses to print it, so values printed
+ * alike are hashed alike.
+ * @param Value is the value to be quantized.
+ * @return the value times FpPrecision, rounded to an integer. NaNs and huge values return their bits.
+ */
+uint64_t WhiroQuantize(double Value);
+
+/**
+ * This method returns the 64 bits by which a floating-point value is hashed: its bits, or its quantized
+ * value, according to the settings of WhiroSetArrayHashing.
+ * @param Value is the value to be hashed.
+ * @return the bits to be mixed into a hashcode.
+ */
+uint64_t WhiroHashReal(double Value);
+
+/**
+ * This method computes a 64-bit hash of a region of memory, in the style of wyhash. It reads the region
+ * once, many bytes at a time.
+ * @param Data is a pointer to the beginning of the region.
+ * @param Size is the number of bytes in the region.
+ * @param Seed is the seed of the hash, e.g. the hash of the previous region of a stream.
+ * @return the hashcode.
+ */
+uint64_t WhiroHashBytes64(const void* Data, size_t Size, uint64_t Seed);
+
+/**
+ * This method returns the size of a scalar.
+ * @param Format is the type of the scalar.
+ * @return its size in bytes, or zero if Format is not a scalar type.
+ */
+size_t WhiroScalarSize(int Format);
+
+/**
+ * This method computes the 64-bit hash of consecutive scalars, over their raw bytes. Floating-point
+ * elements are quantized first, unless they are hashed by their bits.
+ * @param Array is a pointer to the first element.
+ * @param QuantElements is the amount of elements to be hashed.
+ * @param Format is the type of the elements.
+ * @param Seed is the seed of the hash.
+ * @return the hashcode.
+ */
+uint64_t WhiroHashScalars64(void* Array, size_t QuantElements, int Format, uint64_t Seed);
+
+/**
+ * This method computes the 64-bit hashcode of an array of scalars of any dimension, over the raw bytes of
+ * its elements. Floating-point elements are quantized first, unless they are hashed by their bits. Arrays
+ * large enough for hash trees are hashed as trees, and the root of the tree is returned.
+ * @param Array is a pointer to the beginning of the array.
+ * @param TotalElements is the amount of elements of the array, in all of its dimensions.
+ * @param Format is the type of the elements of the array.
+ * @return the hashcode.
+ */
+uint64_t WhiroComputeHashcode64(void* Array, size_t TotalElements, int Format);
+
+/**
+ * This method computes the hashcode of an array of scalars with the hash selected by WhiroSetArrayHashing.
+ * It is used to mix arrays into other hashcodes.
+ * @param Array is a pointer to the beginning of the array.
+ * @param TotalElements is the amount of elements of the array.
+ * @param Step is the step that the base pointer takes in the 32-bit hashcode.
+ * @param Format is the type of the elements of the array.
+ * @return the hashcode, in 64 bits.
+ */
+uint64_t WhiroHashArray(void* Array, size_t TotalElements, size_t Step, int Format);
+
+/**
+ * This method reports the hashcode of an array of scalars, computed with the hash selected by
+ * WhiroSetArrayHashing. The 32-bit hashcode is printed as a signed integer, and the 64-bit one as an
+ * unsigned integer. The trees of arrays hashed as trees are also written to the file of trees.
+ * @param OutputFile is a pointer to the output file of the program.
+ * @param Name is the name of the array.
+ * @param FuncName is the name of the function currently being inspected.
+ * @param CallCounter is the current value of the call counter of FuncName.
+ * @param Tag is written between the call counter and the hashcode, e.g., " : ".
+ * @param Array is a pointer to the beginning of the array.
+ * @param TotalElements is the amount of elements of the array.
+ * @param Step is the step that the base pointer takes in the 32-bit hashcode.
+ * @param Format is the type of the elements of the array.
+ */
+void WhiroReportArrayHashcode(FILE* OutputFile, const char* Name, const char* FuncName, long CallCounter, const char* Tag, void* Array, size_t TotalElements, size_t Step, int Format);
 
 #endif
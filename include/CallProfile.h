@@ -0,0 +1,78 @@
+#ifndef CALLPROFILE_H
+#define CALLPROFILE_H
+
+/**
+ * The counters of the instrumented program. Every thread has a block of its own, indexed by
+ * the identifier the Memory Monitor gives to each function and inspection point, so updating
+ * a counter is a single increment that no other thread touches. In separate compilation, the
+ * blocks are allocated per unit with WhiroGetUnitCounterBlock, and this one stays null.
+ */
+extern __thread uint64_t* WhiroCounters;
+
+/**
+ * The identifier of the counter of the innermost instrumented function running in each thread.
+ * It is kept only in the watch mode, and it is -1 before any instrumented function starts.
+ */
+extern __thread int WhiroCurrentFunction;
+
+/**
+ * This function sets the counters created by the Memory Monitor. It must be called before any
+ * counter block is allocated.
+ * @param QuantCounters is the number of counters in the program
+ * @param Names is an array with the name of each counter
+ */
+void WhiroSetCounters(int QuantCounters, const char** Names);
+
+/**
+ * This function appends the counters of a translation unit to the counters of the program, in separate
+ * compilation. Units are registered by their constructors, so a library opened with dlopen registers its
+ * units while the program runs. The counters of each unit live in a block of their own in every thread.
+ * @param Quant is the number of counters in the unit
+ * @param Names is an array with the name of each counter of the unit
+ * @param Base receives the identifier of the first counter of the unit
+ * @param Unit receives the index of the unit, with which its blocks are allocated
+ */
+void WhiroRegisterCounters(int Quant, const char** Names, int* Base, int* Unit);
+
+/**
+ * This function returns the name of a counter.
+ * @param Id is the identifier of the counter
+ */
+const char* WhiroGetCounterName(int Id);
+
+/**
+ * This function allocates the counter block of the calling thread. It is called the first time
+ * a thread reaches an instrumented function.
+ * @return the counter block of the calling thread
+ */
+uint64_t* WhiroGetCounterBlock();
+
+/**
+ * This function allocates the counter block of a translation unit for the calling thread, in separate
+ * compilation. It is called the first time a thread reaches an instrumented function of the unit.
+ * @param Unit is the index of the unit given by WhiroRegisterCounters
+ * @return the counter block of the unit in the calling thread, indexed from the first counter of the unit
+ */
+uint64_t* WhiroGetUnitCounterBlock(int Unit);
+
+/**
+ * This function reads a counter of the calling thread, or zero if the thread has not reached it yet.
+ * It does not allocate nor lock, so it may be called from signal handlers.
+ * @param Id is the identifier of the counter
+ */
+uint64_t WhiroReadCounter(int Id);
+
+/**
+ * This function enables the call profile. At the end of the execution, the number of times each
+ * function and inspection point was reached, summed over all the threads, is written to a file.
+ * @param OutputName is the name of the profile file
+ */
+void WhiroSetCallProfile(const char* OutputName);
+
+/**
+ * This function writes the call profile, with the counters sorted from the most to the least
+ * frequent. It is registered to run at the exit of the program.
+ */
+void WhiroDumpCallProfile();
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef CHECKPOINTINDEX_H
+#define CHECKPOINTINDEX_H
+
+/**
+ * The layout of an indexed output file. The body holds the reports of the inspection points in
+ * the usual text format. The points are grouped into blocks, and every block is followed by its
+ * index, which is written as soon as the block is closed:
+ * - a WhiroCheckpointBlock
+ * - the names of the points first reported in the block, each one as a 32-bit length followed by
+ *   its characters. Points are numbered in the order their names appear in the file
+ * - a WhiroCheckpointRange for each point reported in the block, sorted by point
+ * - the entries of the block, sorted by point and call counter
+ * The last bytes of the file are a WhiroCheckpointTrailer, which tells where the index of the last
+ * block is. Each block index points to the one before it. A file without a trailer, as left by a
+ * program that crashed, can still be read up to the last block that was closed.
+ */
+#define WHIRO_CHECKPOINT_MAGIC "WHIROIDX"
+#define WHIRO_CHECKPOINT_BLOCK_MAGIC "WHIROBLK"
+#define WHIRO_CHECKPOINT_VERSION 2
+
+/**
+ * This structure describes a report of an inspection point
+ * Point is the index of the name of the point
+ * Block is the index of the block holding the report
+ * Counter is the call counter of the point
+ * Start is the offset of the report inside its block
+ * Length is the size of the report in bytes
+ */
+typedef struct {
+  uint32_t Point;
+  uint32_t Block;
+  uint64_t Counter;
+  uint32_t Start;
+  uint32_t Length;
+} WhiroCheckpointEntry;
+
+/**
+ * This structure describes the entries of a point in a block
+ * Point is the index of the point
+ * First is the index of the first entry of the point among the entries of the block
+ * MinCounter and MaxCounter are the smallest and the largest call counters of these entries
+ */
+typedef struct {
+  uint32_t Point;
+  uint32_t First;
+  uint64_t MinCounter;
+  uint64_t MaxCounter;
+} WhiroCheckpointRange;
+
+/**
+ * This structure is kept by the readers of an indexed output file to find the entries of a point in a block
+ * Range is the range of the point in the block
+ * Block is the index of the block
+ * Quant is the amount of entries of the point in the block
+ */
+typedef struct {
+  WhiroCheckpointRange Range;
+  uint64_t Block;
+  uint64_t Quant;
+} WhiroCheckpointSpan;
+
+/**
+ * This structure begins the index of a block
+ * Block is the index of the block
+ * Offset is where the reports of the block start in the file
+ * Previous is where the index of the previous block starts
+ * FirstPoint is the index of the first point named in this block
+ * QuantNames, QuantRanges and QuantEntries are the amount of names, ranges and entries that follow
+ */
+typedef struct {
+  char Magic[8];
+  uint64_t Block;
+  uint64_t Offset;
+  uint64_t Previous;
+  uint32_t FirstPoint;
+  uint32_t QuantNames;
+  uint32_t QuantRanges;
+  uint32_t QuantEntries;
+} WhiroCheckpointBlock;
+
+/**
+ * This structure closes an indexed output file
+ * LastBlock is where the index of the last block starts
+ */
+typedef struct {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t QuantPoints;
+  uint64_t QuantEntries;
+  uint64_t QuantBlocks;
+  uint64_t LastBlock;
+} WhiroCheckpointTrailer;
+
+/**
+ * This function enables the indexed output. Every inspection point is indexed as it starts, and
+ * the index of each block is written to the output file when the block is closed.
+ * @param BlockSize is the number of inspection points grouped in a block
+ */
+void WhiroSetIndexedOutput(int BlockSize);
+
+/**
+ * This function opens the indexed output file. The program writes its reports to the returned
+ * stream, which keeps what each thread writes inside an inspection point in a buffer of its own.
+ * The report of a point is written to the file as a whole when its thread reaches the next point,
+ * so the reports of threads that run at the same time never interleave, and each entry of the
+ * index covers the report of its point alone.
+ * @param FileName is the name of the indexed output file
+ * @return the stream the program writes its reports to, or NULL if the file cannot be opened
+ */
+FILE* WhiroOpenIndexedOutput(const char* FileName);
+
+/**
+ * This function indexes an inspection point. It must be called before the point writes anything.
+ * Threads may index points at the same time.
+ * @param OutputFile is the stream returned by WhiroOpenIndexedOutput
+ * @param Point is the name of the point: its function, followed by @line for points inside functions
+ * @param CallCounter is the call counter of the point
+ */
+void WhiroIndexPoint(FILE* OutputFile, char* Point, long CallCounter);
+
+/**
+ * This function writes the last report of every thread, closes the last block and appends the
+ * trailer to the output file. It must be called before closing the file.
+ * @param OutputFile is the stream returned by WhiroOpenIndexedOutput
+ */
+void WhiroWriteIndex(FILE* OutputFile);
+
+#endif
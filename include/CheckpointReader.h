@@ -0,0 +1,107 @@
+#ifndef CHECKPOINTREADER_H
+#define CHECKPOINTREADER_H
+
+#include<stdio.h>
+#include<stdint.h>
+#include "uthash.h"
+#include "CheckpointIndex.h"
+
+/**
+ * This structure holds an inspection point of an indexed output file
+ * Name is the name of the point
+ * Spans holds the blocks where the point was reported, in the order of the file
+ * Monotonic tells whether the call counters of the point grow along its spans, so they can be binary searched
+ */
+typedef struct {
+  char* Name;
+  WhiroCheckpointSpan* Spans;
+  uint64_t QuantSpans;
+  uint64_t SpansCapacity;
+  int Monotonic;
+} WhiroCheckpointPoint;
+
+/**
+ * This structure maps the name of an inspection point to its index
+ * Name is the name of the point
+ * Id is the index of the point
+ * hh is the member to make this entry "hashable"
+ */
+typedef struct {
+  char* Name;
+  uint32_t Id;
+  UT_hash_handle hh;
+} WhiroCheckpointName;
+
+/**
+ * This structure holds an indexed output file opened for reading. The file is mapped in memory, and
+ * the names of the points and the ranges of each block are loaded. The entries of a point in a block
+ * are binary searched in the mapping, so finding an inspection point reads O(log n) entries.
+ * Data and Size are the mapped file
+ * Points holds the inspection points of the file, and Names maps their names to their index
+ * Blocks holds where the reports of each block start
+ * Entries holds where the entries of each block start
+ */
+typedef struct {
+  const char* Data;
+  uint64_t Size;
+  WhiroCheckpointPoint* Points;
+  WhiroCheckpointName* Names;
+  uint32_t QuantPoints;
+  uint64_t* Blocks;
+  uint64_t* Entries;
+  uint64_t QuantBlocks;
+  uint64_t BlocksCapacity;
+} WhiroCheckpoint;
+
+/**
+ * This function opens an indexed output file. If the program that wrote it did not close it, the
+ * blocks closed before the program ended are read.
+ * @param FileName is the name of the file
+ * @return the opened file, or NULL if it could not be opened or it is not indexed
+ */
+WhiroCheckpoint* WhiroOpenCheckpoint(const char* FileName);
+
+/**
+ * This function closes an indexed output file.
+ * @param Checkpoint is the opened file
+ */
+void WhiroCloseCheckpoint(WhiroCheckpoint* Checkpoint);
+
+/**
+ * This function returns the index of an inspection point.
+ * @param Checkpoint is the opened file
+ * @param Point is the name of the point: its function, followed by @line for points inside functions
+ * @return the index of the point, or -1 if the point was never reported
+ */
+long WhiroFindCheckpointPoint(WhiroCheckpoint* Checkpoint, const char* Point);
+
+/**
+ * This function finds the first report of an inspection point at a call counter.
+ * @param Checkpoint is the opened file
+ * @param Id is the index of the point
+ * @param Counter is the call counter
+ * @param Entry receives the entry of the report, whose text starts at Data + Blocks[Entry->Block] + Entry->Start
+ * @return 1 if the point was reported with the counter, or 0 otherwise
+ */
+int WhiroFindCheckpointReport(WhiroCheckpoint* Checkpoint, long Id, uint64_t Counter, WhiroCheckpointEntry* Entry);
+
+/**
+ * This function prints the reports of an inspection point at a call counter, in the text format of
+ * the output file. A point reported by many threads with the same counter has many reports.
+ * @param Checkpoint is the opened file
+ * @param Point is the name of the point
+ * @param Counter is the call counter
+ * @param Output is where the reports are printed
+ * @return the number of reports printed
+ */
+long WhiroPrintCheckpoint(WhiroCheckpoint* Checkpoint, const char* Point, uint64_t Counter, FILE* Output);
+
+/**
+ * This function lists the inspection points of an indexed output file, with the number of reports
+ * of each one and the range of their call counters.
+ * @param Checkpoint is the opened file
+ * @param Output is where the points are listed
+ */
+void WhiroListCheckpoint(WhiroCheckpoint* Checkpoint, FILE* Output);
+
+#endif
@@ -1,6 +1,38 @@
 #ifndef COMPOSITE_INSPECTOR_H
 #define COMPOSITE_INSPECTOR_H
 
+//Kinds of frames in the work-list used to traverse the memory graph
+#define WHIRO_FRAME_FIELDS 0
+#define WHIRO_FRAME_POINTERS 1
+#define WHIRO_FRAME_ELEMENTS 2
+
+//Mode of a thread that inspects data as the program was instrumented to, Precise or Fast
+#define WHIRO_MODE_PROGRAM -1
+
+/**
+ * This structure describes a pending step of the traversal of the memory graph. Whiro
+ * follows pointers with an explicit work-list of frames instead of recursion, so long
+ * chains of pointers do not overflow the stack of the program.
+ * Data is the address of the data being inspected
+ * Type is the type descriptor of Data
+ * Next is the index of the next field (or array element) to be inspected
+ * Count is the number of elements of an array. Unused for fields
+ * Stride is the distance, in bytes, between two elements of an array of data. Unused
+ * for fields and arrays of pointers
+ * NameLength is the length of the name of Data in the name buffer
+ * Kind tells whether the frame visits the fields of Data, the elements of an array
+ * of pointers or the elements of an array of data (e.g. structs or unions)
+ */
+typedef struct {
+  void* Data;
+  TypeDescriptor* Type;
+  size_t Next;
+  size_t Count;
+  size_t Stride;
+  size_t NameLength;
+  int Kind;
+} InspectionFrame;
+
 /**
  * This function prints any type of data manipulated by the program. It receives a type
  * descriptor and print every field within data data. It is usually used to print non-scalar
@@ -12,7 +44,100 @@
  * @param FuncName is the name of the function currently being inspected
  * @param CallCounter is the current value of the call counter of FuncName
  */
-void WhiroInspectData(FILE* OutputFile, void* Data, TypeDescriptor* DataType, char* Name, char* FuncName, int CallCounter);
+void WhiroInspectData(FILE* OutputFile, void* Data, TypeDescriptor* DataType, char* Name, char* FuncName, long CallCounter);
+
+/**
+ * This function reports every frame in the work-list until it is empty. Scalar fields
+ * are printed right away, and pointers to other data push new frames, so the data is
+ * reported in the same order as a depth-first traversal.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroTraverseWorkList(FILE* OutputFile, char* FuncName, long CallCounter);
+
+/**
+ * This function takes the next element to be visited from the work-list. Frames whose
+ * elements were all visited are popped.
+ * @param Current receives a copy of the frame that owns the element
+ * @param Index receives the index of the field (or array element) to be visited
+ * @return 1 if there is an element to be visited, or 0 if the work-list is empty
+ */
+int WhiroNextWorkItem(InspectionFrame* Current, size_t* Index);
+
+/**
+ * This function pushes a new frame in the work-list. The work-list is allocated once
+ * and reused by every inspection point.
+ * @param Data is the address of the data to be inspected
+ * @param Type is the type descriptor of Data
+ * @param Count is the number of elements, for arrays of pointers
+ * @param NameLength is the length of the name of Data in the name buffer
+ * @param Kind is either WHIRO_FRAME_FIELDS or WHIRO_FRAME_POINTERS
+ */
+void WhiroPushFrame(void* Data, TypeDescriptor* Type, size_t Count, size_t NameLength, int Kind);
+
+/**
+ * This function pushes a frame that visits every element of an array whose elements are
+ * not scalars. Arrays of pointers are visited as WHIRO_FRAME_POINTERS frames, and any
+ * other array as a WHIRO_FRAME_ELEMENTS frame, which inspects each element with the type
+ * descriptor of the elements.
+ * @param Data is the address of the first element of the array
+ * @param ElementType is the type descriptor of the elements
+ * @param Count is the number of elements
+ * @param Stride is the size, in bytes, of each element
+ * @param NameLength is the length of the name of the array in the name buffer
+ */
+void WhiroPushArrayFrame(void* Data, TypeDescriptor* ElementType, size_t Count, size_t Stride, size_t NameLength);
+
+/**
+ * This function sets the mode of the inspections made by the calling thread, without changing
+ * the mode of the other threads.
+ * @param Mode is 1 for the Precise mode, 0 for Fast, or WHIRO_MODE_PROGRAM for the mode of the program
+ * @return the previous mode of the calling thread
+ */
+int WhiroSetThreadMode(int Mode);
+
+/**
+ * This function tells whether the calling thread inspects data in the Precise mode.
+ * @return true if pointers are followed by the inspections of the calling thread
+ */
+int WhiroIsPrecise();
+
+/**
+ * This function releases the work-list, the name buffer and the line buffer of the calling thread. Threads
+ * that inspect the heap on behalf of the program call it before exiting.
+ */
+void WhiroReleaseInspectionBuffers();
+
+/**
+ * This function sets the name of the root of a traversal in the name buffer.
+ * @param Name is the name of the variable being inspected
+ * @return the length of Name
+ */
+size_t WhiroSetInspectionName(const char* Name);
+
+/**
+ * This function appends the name of a field to the name stored in the name buffer.
+ * @param Length is the length of the name of the parent of the field
+ * @param FieldName is the name of the field. Unnamed fields keep the parent name
+ * @return the length of the full name of the field
+ */
+size_t WhiroAppendInspectionName(size_t Length, const char* FieldName);
+
+/**
+ * This function appends an array index, e.g. "[3]", to the name in the name buffer.
+ * @param Length is the length of the name of the array
+ * @param Index is the index of the element
+ * @return the length of the full name of the element
+ */
+size_t WhiroAppendInspectionIndex(size_t Length, size_t Index);
+
+/**
+ * This function returns the name buffer terminated at a given length.
+ * @param Length is the length of the name to be read
+ * @return the name buffer
+ */
+char* WhiroInspectionName(size_t Length);
 
 /**
  * This function is responsible to report a value pointed by a pointer in the program. If
@@ -25,7 +150,7 @@ void WhiroInspectData(FILE* OutputFile, void* Data, TypeDescriptor* DataType, ch
  * @param FuncName is the name of the function currently being inspected
  * @param CallCounter is the current value of the call counter of FuncName
  */
-void WhiroInspectPointer(FILE* OutputFile, void* Ptr, int TypeIndex, char* Name, char* FuncName, int CallCounter);
+void WhiroInspectPointer(FILE* OutputFile, void* Ptr, int TypeIndex, char* Name, char* FuncName, long CallCounter);
 
 /**
  * This function will track the pointer to print its contents. It checks if Ptr
@@ -41,19 +166,61 @@ void WhiroInspectPointer(FILE* OutputFile, void* Ptr, int TypeIndex, char* Name,
  * @param FuncName is the name of the function currently being inspected
  * @param CallCounter is the current value of the call counter of FuncName
  */
-void WhiroTrackPointer(FILE* OutputFile, void* Ptr, int TypeIndex, char* Name, char* FuncName, int CallCounter);
+void WhiroTrackPointer(FILE* OutputFile, void* Ptr, int TypeIndex, char* Name, char* FuncName, long CallCounter);
+
+/**
+ * This function is the non-recursive counterpart of trackPointer, used while the work-list
+ * is being traversed. Instead of inspecting the data pointed by Ptr, it schedules such data
+ * in the work-list. Only NULL pointers and freed heap blocks are reported immediately.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Ptr is the pointer to be inspected
+ * @param TypeIndex is the type to access the type descriptor of that data
+ * @param NameLength is the length of the name of the pointer in the name buffer
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroVisitPointer(FILE* OutputFile, void* Ptr, int TypeIndex, size_t NameLength, char* FuncName, long CallCounter);
 
 /**
  * This function is in charge of inspecting variables of union type. Whiro 
- * prints unions as bitmaps. It iterates the pointer to U nion and prints every
- * byte of it.
+ * prints unions as bitmaps: every byte of the union, in hexadecimal, or in
+ * decimal with -decimal-bytes.
  * @param Union is the pointer to an union
  * @param Size is the size of the largest composing part in the union type
  * @param Name is the name of the variable holding Union in the program
  * @param FuncName is the name of the function currently being inspected
  * @param CallCounter is the current value of the call counter of FuncName
  */
-void WhiroInspectUnion(FILE* OutputFile, char* Union, size_t Size, char* Name, char* FuncName, int CallCounter);
+void WhiroInspectUnion(FILE* OutputFile, char* Union, size_t Size, char* Name, char* FuncName, long CallCounter);
+
+/**
+ * This function inspects an array whose elements are structs, unions or pointers. Each
+ * element is reported as a variable named after its index, e.g. "Name[3]-Field". With
+ * heap hashing (-hh), the whole array is reported as a single hashcode instead.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Array is the address of the first element of the array
+ * @param Count is the number of elements in the array
+ * @param ElementSize is the size, in bytes, of each element
+ * @param TypeIndex is the index of the type descriptor of the elements
+ * @param Name is the name of the variable holding Array in the program
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroInspectArrayOfData(FILE* OutputFile, void* Array, size_t Count, size_t ElementSize, int TypeIndex, char* Name, char* FuncName, long CallCounter);
+
+/**
+ * This function reports every element of an array whose elements are structs, unions or
+ * pointers, regardless of heap hashing. It is called by inspectArrayOfData.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Array is the address of the first element of the array
+ * @param Count is the number of elements in the array
+ * @param ElementSize is the size, in bytes, of each element
+ * @param TypeIndex is the index of the type descriptor of the elements
+ * @param Name is the name of the variable holding Array in the program
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroInspectArrayElements(FILE* OutputFile, void* Array, size_t Count, size_t ElementSize, int TypeIndex, char* Name, char* FuncName, long CallCounter);
 
 /**
  * This function inspects a structure type. It retrieves the type descriptor using
@@ -65,7 +232,7 @@ void WhiroInspectUnion(FILE* OutputFile, char* Union, size_t Size, char* Name, c
  * @param FuncName is the name of the function currently being inspected
  * @param CallCounter is the current value of the call counter of FuncName
  */
-void WhiroInspectStruct(FILE* OutputFile, void* Struct, int TypeIndex, char* Name, char* FuncName, int CallCounter);
+void WhiroInspectStruct(FILE* OutputFile, void* Struct, int TypeIndex, char* Name, char* FuncName, long CallCounter);
 
 
 #endif
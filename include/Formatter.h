@@ -0,0 +1,55 @@
+#ifndef FORMATTER_H
+#define FORMATTER_H
+
+/**
+ * These functions report a scalar value as a line "Name Scope CallCounter Tag Value". They write
+ * the same bytes as fprintf with the format specifiers of the Memory Monitor, but they convert the
+ * values with specialized routines and write each line to the output file at once.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Name is the name of the value
+ * @param Scope is the scope of the value (e.g., the name of the function being inspected)
+ * @param CallCounter is the current value of the call counter of the function being inspected
+ * @param Tag is written between the call counter and the value, e.g., " : "
+ * @param Value is the value, already converted to the width of its format specifier
+ */
+
+//Integers printed with %d, %hi, %ld and %lld
+void WhiroReportI64(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, int64_t Value);
+
+//Integers printed with %u, %hu, %lu and %llu
+void WhiroReportU64(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, uint64_t Value);
+
+//Floating-point values printed with %.2f and %.2lf
+void WhiroReportF64(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, double Value);
+
+//Characters printed with %c
+void WhiroReportChar(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, char Value);
+
+/**
+ * This function reports a raw region of memory, such as a union, as a line "Name Scope CallCounter
+ * Tag Bytes". The bytes are encoded in hexadecimal, two digits per byte in the order they are stored
+ * in memory, many bytes at a time. In the decimal mode, each byte is printed as a signed char without
+ * separators, as older versions of Whiro printed unions.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Name is the name of the value
+ * @param Scope is the scope of the value (e.g., the name of the function being inspected)
+ * @param CallCounter is the current value of the call counter of the function being inspected
+ * @param Tag is written between the call counter and the value, e.g., " : "
+ * @param Bytes is the address of the region
+ * @param Size is the number of bytes in the region
+ */
+void WhiroReportBytes(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, const void* Bytes, size_t Size);
+
+/**
+ * This function sets the decimal mode of WhiroReportBytes, in which raw bytes are printed as
+ * signed decimals instead of hexadecimal digits.
+ */
+void WhiroSetDecimalBytes();
+
+/**
+ * This function releases the line buffer of the calling thread. Threads that report values on
+ * behalf of the program call it before exiting.
+ */
+void WhiroReleaseLineBuffer();
+
+#endif
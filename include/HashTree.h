@@ -0,0 +1,79 @@
+#ifndef HASH_TREE_H
+#define HASH_TREE_H
+
+#include<stdio.h>
+#include<stdint.h>
+
+//Default number of elements in each chunk (leaf) of a hash tree
+#define WHIRO_TREE_CHUNK 4096
+//Number of children of each internal node of a hash tree
+#define WHIRO_TREE_FANOUT 16
+//Leaves taken by a worker at a time
+#define WHIRO_TREE_BATCH 16
+//Arrays smaller than this many bytes are hashed by the thread of the program alone
+#define WHIRO_TREE_PARALLEL_BYTES (8 << 20)
+//First bytes of a file of hash trees
+#define WHIRO_TREE_MAGIC "WHIROTRE"
+
+/**
+ * This structure begins the record of a hash tree in the file of trees. It is followed by the name
+ * and the scope of the array, without terminators, and then by the nodes of the tree, as 64-bit
+ * hashcodes, level by level from the leaves up to the root.
+ * CallCounter is the call counter of the scope when the array was reported
+ * TotalElements is the amount of elements of the array, in all of its dimensions
+ * ChunkElements is the amount of elements hashed by each leaf. The last leaf may hash fewer
+ * ElementSize and Format describe the elements of the array
+ * Fanout is the amount of children of each internal node
+ * QuantLevels is the amount of levels of the tree, including the leaves and the root
+ * QuantNodes is the amount of nodes of the tree
+ */
+typedef struct {
+  uint32_t NameLength;
+  uint32_t ScopeLength;
+  int64_t CallCounter;
+  uint64_t TotalElements;
+  uint64_t ChunkElements;
+  uint32_t ElementSize;
+  uint32_t Format;
+  uint32_t Fanout;
+  uint32_t QuantLevels;
+  uint64_t QuantNodes;
+} WhiroTreeRecord;
+
+/**
+ * This method enables hash trees. Arrays of scalars with at least Threshold elements are hashed as
+ * trees of chunks, whose root is reported as their 64-bit hashcode.
+ * @param Threshold is the least amount of elements of an array hashed as a tree. Zero disables trees.
+ * @param ChunkElements is the amount of elements hashed by each leaf. Zero selects WHIRO_TREE_CHUNK.
+ * @param Workers is the amount of threads that hash the leaves of very large arrays.
+ * @param TreeFileName is the file where the trees of the reported arrays are written, or NULL.
+ */
+void WhiroSetHashTree(size_t Threshold, size_t ChunkElements, int Workers, const char* TreeFileName);
+
+/**
+ * This method tells whether an array is hashed as a tree.
+ * @param TotalElements is the amount of elements of the array.
+ * @return true if hash trees are enabled and the array is large enough.
+ */
+int WhiroUsesHashTree(size_t TotalElements);
+
+/**
+ * This method hashes an array of scalars as a tree. Each chunk of the array is hashed by a leaf, and
+ * each internal node hashes the hashcodes of its children. If the array is reported with a name and
+ * the trees are persisted, the whole tree is written to the file of trees.
+ * @param Array is a pointer to the beginning of the array.
+ * @param TotalElements is the amount of elements of the array, in all of its dimensions.
+ * @param Format is the type of the elements of the array.
+ * @param Name is the name of the array, or NULL if the tree is not persisted.
+ * @param FuncName is the name of the function currently being inspected.
+ * @param CallCounter is the current value of the call counter of FuncName.
+ * @return the root of the tree.
+ */
+uint64_t WhiroComputeHashTree(void* Array, size_t TotalElements, int Format, const char* Name, const char* FuncName, long CallCounter);
+
+/**
+ * This method closes the file of trees. It is called at the exit of the program.
+ */
+void WhiroCloseTreeFile();
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef HEAP_HASHER_H
+#define HEAP_HASHER_H
+
+/**
+ * This function enables the structural hashing of heap graphs. Instead of printing every
+ * field of every heap block reachable from a root, Whiro reports one hashcode per root.
+ * The hashcode covers the shape of the graph and its scalar contents, but not the
+ * concrete addresses of the blocks, so it can be compared across runs. If a reference
+ * output is given, roots whose hashcode differs from the reference are also dumped.
+ * @param ReferenceFile is the output file of a reference run. It might be empty
+ */
+void WhiroSetHeapHashing(const char* ReferenceFile);
+
+/**
+ * This function computes the structural hashcode of the heap graph reachable from a
+ * heap block. Blocks are identified by the order in which they are discovered.
+ * @param Entry is the heap table entry where the traversal starts
+ * @return the hashcode of the graph
+ */
+uint64_t WhiroHashHeapGraph(HeapEntry* Entry);
+
+/**
+ * This function reports the structural hashcode of the heap graph reachable from a
+ * pointer variable. Pointers that do not point to the heap are inspected as usual.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Ptr is the pointer to be inspected
+ * @param TypeIndex is the type to access the type descriptor of that data
+ * @param Name is the name of the variable holding Ptr in the program
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroReportPointerHash(FILE* OutputFile, void* Ptr, int TypeIndex, char* Name, char* FuncName, long CallCounter);
+
+/**
+ * This function reports the structural hashcode of an array whose elements are structs,
+ * unions or pointers. The fields of every element are mixed into the hashcode in a single
+ * pass over the array, following the heap graphs reachable from the pointers in it. If the
+ * hashcode differs from the reference, the array is also reported element by element.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Array is the address of the first element of the array
+ * @param Count is the number of elements in the array
+ * @param ElementSize is the size, in bytes, of each element
+ * @param TypeIndex is the index of the type descriptor of the elements
+ * @param Name is the name of the variable holding Array in the program
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroReportArrayHash(FILE* OutputFile, void* Array, size_t Count, size_t ElementSize, int TypeIndex, char* Name, char* FuncName, long CallCounter);
+
+/**
+ * This function reports the entire heap as a set of structural hashcodes, one for each
+ * root. A root is a live block that was not reached from the roots reported before it,
+ * following the order of the Heap Table.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroReportHeapHash(FILE* OutputFile, char* FuncName, long CallCounter);
+
+#endif
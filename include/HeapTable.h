@@ -6,26 +6,31 @@
  * Size is the number of elements allocated
  * ArrayStep is the increment the pointer to that data, so Whiro 
  * can visit all data allocated in that block
+ * Bytes is the number of bytes allocated for the block
  */
 typedef struct {
   int TypeIndex;
-	int Size;
-	int ArrayStep; 
+  size_t Size;
+  size_t ArrayStep;
+  size_t Bytes;
 } HeapData;
 
 /**
  * This structure describes an entry from the heap table
  * Key is the address of that entry
  * Data describes the type of the data stored in this entry
- * Visited is a flag indicating whether that block was visited when traversing the heap graph
+ * Visited is the traversal epoch in which that block was last visited when traversing the heap
+ * graph. The block is visited in the current traversal if Visited is equal to WhiroVisitEpoch
  * Free is a flag indicante whether this block holds valid data
+ * Order is the order in which the block was discovered when hashing the heap graph
  * hh is the member to make this entry "hashable"
  */
 typedef struct {
   void* Key;
   HeapData* Data;
-	int Visited;
+	unsigned Visited;
 	int Free;
+  size_t Order;
   UT_hash_handle hh;
 } HeapEntry;
 
@@ -38,18 +43,26 @@ typedef struct {
  * @param Size is the number of elements allocated
  * @param ArrayStep is the increment the pointer to Block, so Whiro can visit all data
  * allocated in that block
+ * @param Bytes is the number of bytes allocated
  * @param TypeIndex is the type to access the type descriptor of that data
  */
-void WhiroInsertHeapEntry(void* Block, int ArraySize, int ArrayPtrStep, int TypeIndex);
+void WhiroInsertHeapEntry(void* Block, size_t Size, size_t ArrayStep, size_t Bytes, int TypeIndex);
 
 
 /**
- * This function updates the size of a H entry when there is a heap reallocation in the
- * original program.
- * @param Block is the heap address
- * @param NewSize is the new size of the entry
+ * This function updates H when there is a heap reallocation in the original program.
+ * If the block did not move, its entry is resized in place. If it moved, the entry of
+ * OldBlock is set to unreachable and a new entry is inserted for NewBlock. A failed
+ * reallocation (NewBlock is NULL and Bytes is not zero) leaves H untouched.
+ * @param OldBlock is the heap address passed to realloc
+ * @param NewBlock is the heap address returned by realloc
+ * @param Bytes is the new number of bytes of the block
+ * @param ElementSize is the size of one element of the block. It is only used when
+ * OldBlock is not in H, e.g., realloc(NULL, Bytes)
+ * @param TypeIndex is the type to access the type descriptor of that data. It is only
+ * used when OldBlock is not in H
  */
-void WhiroUpdateHeapEntrySize(void* Block, int NewSize);
+void WhiroReallocHeapEntry(void* OldBlock, void* NewBlock, size_t Bytes, size_t ElementSize, int TypeIndex);
 
 /**
  * This function sets the heap entry addressed by Block to unreachable, if such entry
@@ -71,23 +84,33 @@ void WhiroDeleteHeapEntry(void* Block);
  * @param FuncName is the name of the function from the source code that it is being
  * inspected
  * @param CallCounter is the current value of FuncName
- * @param FollowPtr indicates whether Whiro should follow the chain of reachability of
- * this data in case it points to somewhere in memory
 */
-void WhiroInspectHeapData(FILE* OutputFile, HeapEntry* Entry, char* PtrName, char* FuncName, int CallCounter, int FollowPtr);
+void WhiroInspectHeapData(FILE* OutputFile, HeapEntry* Entry, char* PtrName, char* FuncName, long CallCounter);
+
+/**
+ * This function is the non-recursive counterpart of inspectHeapData, used while the work-list
+ * is being traversed. It sets Entry as visited and reports it if it is freed or if it is an
+ * array of scalars. Otherwise, it schedules the data in the work-list.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param Entry is the heap table entry to be inspected
+ * @param NameLength is the length of the name of the pointer in the name buffer
+ * @param FuncName is the name of the function from the source code that it is being
+ * inspected
+ * @param CallCounter is the current value of FuncName
+ */
+void WhiroVisitHeapData(FILE* OutputFile, HeapEntry* Entry, size_t NameLength, char* FuncName, long CallCounter);
 
 /**
  * This function reports an entry from the heap table that has a size greater than 1. 
- * It reports it as an array. 
+ * It reports it as an array. Arrays of pointers are scheduled in the work-list.
  * @param OutputFile is a pointer to the output file of the program
  * @param Entry is the heap table entry to be inspected
- * @param PtrName is the name of the pointer that points to that heap address in the
- * source code
+ * @param NameLength is the length of the name of the pointer in the name buffer
  * @param FuncName is the name of the function from the source code that it is being
  * inspected
  * @param CallCounter is the current value of FuncName
  */
-void WhiroInspectHeapArray(FILE* OutputFile, HeapEntry* Entry, char* PtrName, char* FuncName, int CallCounter);
+void WhiroVisitHeapArray(FILE* OutputFile, HeapEntry* Entry, size_t NameLength, char* FuncName, long CallCounter);
 
 /**
  * This function reports all the contents of the Heap Table, that is, all the heap-
@@ -97,10 +120,11 @@ void WhiroInspectHeapArray(FILE* OutputFile, HeapEntry* Entry, char* PtrName, ch
  * inspected
  * @param CallCounter is the current value of FuncName
  */
-void WhiroInspectEntireHeap(FILE* OutputFile, char* FuncName, int CallCounter);
+void WhiroInspectEntireHeap(FILE* OutputFile, char* FuncName, long CallCounter);
 
 /**
  * This function sets the entire heap table as univisited. Whiro uses it to report aliases.
+ * It starts a new traversal epoch, so it does not need to walk the table.
  */
 void WhiroSetAllHeapUnivisited();
 
@@ -1,6 +1,24 @@
 #ifndef MEMORYMONITOR_H
 #define MEMORYMONITOR_H
 
+//! The type descriptor of a debug type, without the indexes of its base types.
+/*!
+	Everything in this descriptor depends only on the structure of the debug type, so it can be shared by the modules
+	in which the same type is found, such as the types of common headers. The base types are resolved in the Type Table
+	of each module when the descriptor is written.
+	Processed tells whether the type goes to the Type Table. Valid tells whether a descriptor is written for it.
+	Fields holds the name, the format and the offset of every field of a struct.
+*/
+struct TypeDescriptorEntry {
+	bool Processed = false;
+	bool Valid = false;
+	std::string Name;
+	int QuantFields = 0;
+	int Format = 0;
+	int Offset = 0;
+	std::vector<std::tuple<std::string, int, int>> Fields;
+};
+
 //! A class to insert verification code in benchmarks and create the inspection points.
 /*!
 	This class is responsible to insert all the necessary instrumentation into a program to insert the verification code. It tracks the values of a variable through the LLVM IR, and create the inspection points just before the return of every function. All the variables are printed to an extern file which will be created by the instrumented program.
@@ -12,6 +30,11 @@ class MemoryMonitor : public llvm::ModulePass {
     
 		//! Class constructor. To initialize the pass identifier.
    	MemoryMonitor() : ModulePass(ID) {}
+   	
+		//! Class constructor for modules whose program is built in another directory.
+		/*! @param WorkingDirectory is the directory in which relative files, such as the Type Table, are written
+		*/
+   	MemoryMonitor(std::string WorkingDirectory) : ModulePass(ID), WorkingDirectory(WorkingDirectory) {}
 
 		//! Class destructor.
 		~ MemoryMonitor() {}
@@ -22,6 +45,19 @@ class MemoryMonitor : public llvm::ModulePass {
 		@return true if the program is modified, or false otherwise.
 		*/
     bool runOnModule(llvm::Module &M) override;
+    
+		/**
+		 * This method resolves the options of the pass that conflict with each other, e.g., the indexed output
+		 * file in the snapshot mode. It is called by runOnModule, and it must be called once before instrumenting
+		 * many modules in parallel, so the pass does not write the options while other modules read them
+		 */
+		static void ResolveOptions();
+		
+		/**
+		 * This method tells every instance of the pass to share the descriptors of the debug types they find, keyed
+		 * by the structural hash of the types. It is used when many modules are instrumented by the same process
+		 */
+		static void ShareTypeDescriptors();
 
 	private:
 	  //-- Fields --//
@@ -30,6 +66,8 @@ class MemoryMonitor : public llvm::ModulePass {
 		llvm::Module *M;
 	  // A pointer to the output file.
 	  llvm::Value* OutputFile;
+	  // The store of the output file opened in main. The output file is loaded right after it in main
+	  llvm::StoreInst* OutputFileStore = nullptr;
 	  // A pointer to type of the output file.
 	  llvm::PointerType* OutputFileType;
 	  // A boolean indicating whether the monitor should filter memory regions
@@ -45,6 +83,50 @@ class MemoryMonitor : public llvm::ModulePass {
 	  // A boolean indicating whether a inspection point in the current function was already created. Used to get the 
 	  // right number of variables inspected in a function
 	  bool FirstInspection;
+	  // A tag appended to the scope of the variables reported at inspection points inside functions, such as
+	  // the latches of loops. It is empty at the return of functions
+	  std::string PointTag;
+	  // The first instruction of main after the allocas, before which the settings of Whiro are inserted. It is null
+	  // in translation units without main
+	  llvm::Instruction* MainBody = nullptr;
+	  // In separate compilation (-tu), the constructor that registers this unit with the runtime, the map from the
+	  // indexes of its Type Table to the indexes of the program, the identifier of its first counter, and its index
+	  // in the runtime, with which the counter blocks of the unit are allocated
+	  llvm::Function* UnitConstructor = nullptr;
+	  llvm::GlobalVariable* TypeMap = nullptr;
+	  llvm::GlobalVariable* CounterBase = nullptr;
+	  llvm::GlobalVariable* CounterUnit = nullptr;
+	  // The counter block of the running thread, loaded at the beginning of the function currently being instrumented
+	  llvm::Value* CurrentCounters = nullptr;
+	  // The names of the counters created in the program. The identifier of a counter is its index in this vector
+	  std::vector<std::string> CounterNames;
+	  // The call that enables the call profile, whose names are set after every function is instrumented
+	  llvm::CallInst* SetProfile = nullptr;
+	  // A map from the names of the static variables tracked by the runtime (-dedup-static) to their identifiers
+	  std::map<std::string, int> StaticIds;
+	  // The reports of tracked static variables in the function currently being instrumented, given by their markers
+	  // and the identifier of the variable
+	  std::vector<std::tuple<llvm::Instruction*, llvm::Instruction*, int>> StaticGuards;
+	  // A map from the pointers casted to void* in the function currently being instrumented to their casts
+	  std::map<llvm::Value*, llvm::Value*> VoidCasts;
+	  // A map from the dimensions of variable length arrays in the function currently being instrumented to their sizes
+	  std::map<std::vector<llvm::Value*>, llvm::Value*> ArraySizes;
+	  // The dominator tree of the function currently being instrumented, built on demand. It is dropped when a block of the
+	  // function is split
+	  std::unique_ptr<llvm::DominatorTree> DomTree;
+	  // The directory in which relative files are written. It is empty for the current directory
+	  std::string WorkingDirectory;
+	  // The structural hashes of the debug types in the module. Shallow hashes do not visit the members of composite types
+	  std::map<llvm::DIType*, uint64_t> TypeHashes;
+	  std::map<llvm::DIType*, uint64_t> ShallowTypeHashes;
+	  // The type descriptors built for this module, keyed by structural hash, if they are not shared
+	  std::map<uint64_t, TypeDescriptorEntry> Descriptors;
+	  // A map from the debug types in the Type Table to their indexes
+	  std::map<llvm::DIType*, int> DebugTypeIndexes;
+	  // The type descriptors shared by every instance of the pass, and the lock that guards them
+	  static bool SharedDescriptors;
+	  static std::mutex SharedDescriptorsLock;
+	  static std::map<uint64_t, TypeDescriptorEntry> SharedDescriptorsCache;
 		
 		//-- Methods --//
 		
@@ -71,7 +153,7 @@ class MemoryMonitor : public llvm::ModulePass {
 		/** 
 		 * This method inserts the instructions to open the output file. This method creates the output
 		 * pointer file as a global variable and calls the standard C function "fopen" to open the
-     * file.
+     * file. In the checking mode, the file is opened by WhiroOpenChecker.
 		 * @param Builder is the LLVM IR builder, to insert instructions and get types
 		 */ 
 		void OpenOutputFile(llvm::IRBuilder<> Builder);
@@ -84,6 +166,130 @@ class MemoryMonitor : public llvm::ModulePass {
 		 */
 		void CloseOutputFile(llvm::Value* OutputFilePtr, llvm::IRBuilder<> Builder);
 		
+		/**
+		 * This method inserts the load of the output file shared by all the inspection points of a function.
+		 * @param F is the function being instrumented
+		 * @return the load of the output file
+		 */
+		llvm::Value* LoadOutputFile(llvm::Function& F);
+		
+		/**
+		 * This method returns the earliest point where code computed from some values can be inserted, so it
+		 * runs once instead of at every inspection point (e.g., out of the loops that hold the points).
+		 * @param Operands are the values the code depends on
+		 * @param InsPoint is the instruction before which the code is needed
+		 * @return the instruction before which the code can be inserted, or null if it cannot be hoisted
+		 */
+		llvm::Instruction* GetHoistingPoint(std::vector<llvm::Value*> Operands, llvm::Instruction* InsPoint);
+		
+		/**
+		 * This method returns the dominator tree of a function, built once and shared by its inspection points.
+		 * @param F is the function currently being instrumented
+		 * @return the dominator tree of F
+		 */
+		llvm::DominatorTree& GetDominatorTree(llvm::Function& F);
+		
+		/**
+		 * This method inserts the instructions to enable the indexed output file, which is closed by an
+		 * index of the inspection points.
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void SetIndexedOutput(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method inserts a call to WhiroIndexPoint, which records where the report of an inspection
+		 * point starts in the indexed output file. In the checking mode, it inserts a call to WhiroCheckPoint,
+		 * which looks the point up in the reference.
+		 * @param OutputFilePtr is a pointer to the output file
+		 * @param CallCounter is the call counter of the inspection point
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void IndexInspectionPoint(llvm::Value* OutputFilePtr, llvm::Value* CallCounter, llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method inserts the instructions to enable the snapshot mode, in which inspection points are
+		 * reported by forked children of the program.
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void SetSnapshotMode(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method inserts the instructions to set the number of counters and their names and, if the user
+		 * chooses to, to enable the call profile (-profile). The arguments of the counters are placeholders until
+		 * FinishCallCounters is called.
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 * @return the call that sets the counters
+		 */
+		llvm::CallInst* SetCallCounters(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method sets the number of counters and their names, once every function is instrumented.
+		 * @param SetCounters is the call that sets the counters
+		 */
+		void FinishCallCounters(llvm::CallInst* SetCounters);
+		
+		/**
+		 * This method inserts the instructions to watch the static variables selected by the user (-watch) with
+		 * hardware breakpoints.
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void SetWatchpoints(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method inserts the instructions to inspect the entire heap with a pool of threads.
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void SetParallelHeap(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method inserts the instructions to hash large arrays as trees of chunks, and to write the trees
+		 * to a file if the user chooses to (-hash-tree-file).
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void SetHashTree(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method guards an inspection point with a condition. The blocks holding the inspection point are
+		 * split, so the point runs only if the condition holds.
+		 * @param Before is the instruction that precedes the inspection point
+		 * @param End is the first instruction after the inspection point
+		 * @param Condition inserts the instructions that compute the condition, at the end of the block before
+		 * the inspection point
+		 * @return the first and the last blocks holding the inspection point, or nulls if the inspection point is empty
+		 */
+		std::pair<llvm::BasicBlock*, llvm::BasicBlock*> GuardInspectionPoint(llvm::Instruction* Before, llvm::Instruction* End, std::function<llvm::Value*(llvm::IRBuilder<>&)> Condition);
+		
+		/**
+		 * This method guards an inspection point with a call to WhiroBeginSnapshot, so the point is reported
+		 * only by the child when the program forks.
+		 * @param Marker is the marker at the beginning of the inspection point
+		 * @param EndMarker is the marker at the end of the inspection point
+		 * @param OutputFilePtr is a pointer to the output file
+		 */
+		void SnapshotInspectionPoint(llvm::Instruction* Marker, llvm::Instruction* EndMarker, llvm::Value* OutputFilePtr);
+		
+		/**
+		 * This method guards the report of a static variable with a call to WhiroStaticChanged, so the variable
+		 * is reported only if it changed since the last inspection point.
+		 * @param Marker is the marker at the beginning of the report
+		 * @param EndMarker is the marker at the end of the report
+		 * @param Id is the identifier of the static variable in the runtime
+		 */
+		void GuardStatic(llvm::Instruction* Marker, llvm::Instruction* EndMarker, int Id);
+		
+		/**
+		 * This method inserts the instructions to register the static variables tracked by the runtime (-dedup-static).
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void TrackStatics(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method tells whether a debug type holds pointers, in which case the report of a variable of that type
+		 * depends on memory outside the variable.
+		 * @param DIT is an LLVM debug type
+		 */
+		bool HasPointers(llvm::DIType* DIT);
+		
 		/**
 		 * This method states whether the monitor should create a type descriptor for a given debug type.
 		 * Subroutine types and members/pointers to members to struct fields do not have descriptors
@@ -112,19 +318,46 @@ class MemoryMonitor : public llvm::ModulePass {
 		 */
 		std::string MakeTypeName(llvm::Type* T);
 		
+		/**
+		 * This method computes a structural hash of a debug type. Types with the same hash have the same
+		 * type descriptor. The members of composite types are hashed with shallow hashes, which stop at
+		 * composite types, so recursive types are hashed in a finite number of steps.
+		 * @param DIT is an LLVM debug type
+		 * @param Shallow tells whether the members of composite types are hashed
+		 * @return the structural hash of DIT
+		 */
+		uint64_t HashType(llvm::DIType* DIT, bool Shallow);
+		
+		/**
+		 * This method builds the type descriptor of a debug type.
+		 * @param DIT is an LLVM debug type
+		 * @return the descriptor of DIT, without the indexes of its base types
+		 */
+		TypeDescriptorEntry BuildTypeDescriptor(llvm::DIType* DIT);
+		
+		/**
+		 * This method returns the type descriptor of a debug type. The descriptor is built only once for
+		 * every structural hash, and shared by every instance of the pass if ShareTypeDescriptors was called.
+		 * @param DIT is an LLVM debug type
+		 * @return the descriptor of DIT
+		 */
+		const TypeDescriptorEntry& GetTypeDescriptor(llvm::DIType* DIT);
+		
+		/**
+		 * This method returns the index of a debug type in the Type Table.
+		 * @param DIT is an LLVM debug type
+		 * @param Default is returned if DIT is not in the Type Table
+		 */
+		int GetDebugTypeIndex(llvm::DIType* DIT, int Default);
+		
 		/**
 		 * This method serializes an entry for a given type in the Type Table binary file.
-		 * @param Name is the name of the type
-		 * @param QuantFields is the number of fields defined in the type
-		 * @param Format is the format of the type
-		 * @param Offset is the offset of the type
-		 * @param BaseTypeIndex is the index of the type descriptor of base type, if it exitsts
+		 * @param Descriptor is the type descriptor of the type
+		 * @param DIT is the LLVM debug type, whose base types are resolved in the Type Table
 		 * @param TypeTableFile is a pointer to the Type Table binary file
 		 * @param TypeTableSize holds the size of the Type Table. It is incremented in this method
-		 * @param Fields is an array containing the description of every field in case of the type is a
-		 * product type (C structs)
 		 */
-		void WriteTypeDescriptor(const char* TypeName, int QuantFields, int Format, int Offset, int BaseTypeIndex, FILE* TypeTableFile, int* TypeTableSize, llvm::DINodeArray Fields);
+		void WriteTypeDescriptor(const TypeDescriptorEntry &Descriptor, llvm::DIType* DIT, FILE* TypeTableFile, int* TypeTableSize);
 		
 		/**
 		 * This method creates a type descriptor for a given debug type.
@@ -148,6 +381,65 @@ class MemoryMonitor : public llvm::ModulePass {
 		 */
 		void OpenTypeTable(std::string ProgramName, int Size, llvm::IRBuilder<> Builder);
 		
+		/**
+		 * This method returns the name after which the output files of the program are named. It is the source
+		 * file of the module, unless the program is instrumented in separate compilation with -tu-program.
+		 */
+		std::string GetProgramName();
+		
+		/**
+		 * This method inserts in the constructor of the unit the registration of its Type Table, in separate compilation.
+		 * @param TypeTableName is the name of the Type Table file of the unit
+		 * @param Size is the number of entries in the file
+		 */
+		void RegisterTypeTable(std::string TypeTableName, int Size);
+		
+		/**
+		 * This method returns the value of a type index as passed to the runtime. In separate compilation, the index
+		 * is loaded from the map of the unit, which the runtime fills at startup.
+		 * @param TypeIndex is the index of the type in the Type Table of the module
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		llvm::Value* TypeIndexValue(int TypeIndex, llvm::IRBuilder<> &Builder);
+		
+		/**
+		 * This method inserts the instructions to report heap graphs as structural hashcodes.
+		 * The output file of a reference run is passed to the runtime, if there is one.
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void SetHeapHashing(llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method inserts the load of the counter block of the running thread at the beginning of a function.
+		 * If the thread has no block yet, the runtime allocates it.
+		 * @param F is the function being instrumented
+		 * @return the counter block
+		 */
+		llvm::Value* LoadCounterBlock(llvm::Function& F);
+		
+		/**
+		 * This method returns the declaration of a thread-local variable of the runtime.
+		 * @param Name is the name of the variable
+		 * @param VarType is the type of the variable
+		 */
+		llvm::GlobalVariable* GetThreadLocal(std::string Name, llvm::Type* VarType);
+		
+		/**
+		 * This method inserts the instructions to keep track of the running function, in the watch mode. The function
+		 * sets its identifier when it starts and restores the identifier of its caller when it returns.
+		 * @param F is the function being instrumented, whose counter was the last one created
+		 * @param InsPoint is the instruction before which the identifier of the function is set
+		 */
+		void TrackCurrentFunction(llvm::Function& F, llvm::Instruction* InsPoint);
+		
+		/**
+		 * This method creates a 64-bit counter in the counter blocks and inserts the code to increment it.
+		 * @param CounterName is the name of the counter, as written in the call profile
+		 * @param InsPoint is the instruction before which the counter is incremented
+		 * @return the value of the counter after the increment
+		 */
+		llvm::Value* IncrementCounter(std::string CounterName, llvm::Instruction* InsPoint);
+		
 		/**
 		 * This method creates a counter for a function in the program and inserts the code to increment
 		 * it at the beginning of the function.
@@ -156,6 +448,25 @@ class MemoryMonitor : public llvm::ModulePass {
 		 */
 		llvm::Value* CreateFunctionCounter(llvm::Function* F, llvm::IRBuilder<> Builder);
 		
+		/**
+		 * This method creates a counter for an inspection point inside a function (e.g., at the latch of a loop)
+		 * and inserts the code to increment it every time the point is reached.
+		 * @param CounterName is the name of the counter
+		 * @param InsPoint is the instruction before which the inspection point is created
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 * @return the value of the counter after the increment
+		 */
+		llvm::Value* CreatePointCounter(std::string CounterName, llvm::Instruction* InsPoint, llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method returns the scope reported along with a variable: the name of its function, or the name
+		 * of the function currently being instrumented for static variables. Inspection points inside functions
+		 * append their source line to it, as in "function@line".
+		 * @param Var is the variable being inspected
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		std::string GetScopeName(llvm::DIVariable* Var, llvm::IRBuilder<> Builder);
+		
 		/**
 		 * This method receives a pointer to any valid type in LLVM IR and casts it to a pointer
 		 * to void. In LLVM IR, void is represented by a integer of 8 bits. The function uses the
@@ -172,17 +483,21 @@ class MemoryMonitor : public llvm::ModulePass {
 		 * @param AllocatedType is the type of the newly allocated heap block
 		 * @param Size is the size of the allocated heap block
 		 * @param ArrayStep is the increment the pointer Ptr, so Whiro can visit all data allocated in that block
+		 * @param Bytes is the number of bytes allocated
 		 * @param Builder is the LLVM IR builder, to insert instructions and get types
 		 */
-		void InsertHeapEntry(llvm::Value* HeapPtr, llvm::Type* AllocatedType, llvm::Value* Size, llvm::Value* ArrayStep, llvm::IRBuilder<> Builder);
+		void InsertHeapEntry(llvm::Value* HeapPtr, llvm::Type* AllocatedType, llvm::Value* Size, llvm::Value* ArrayStep, llvm::Value* Bytes, llvm::IRBuilder<> Builder);
 		
 		/**
-		 * This method injects code to update the size of an entry in the Heap Table.
-		 * @param HeapPtr is a pointer to an heap address
-		 * @param NewSize is the size of the heap entry
+		 * This method injects code to update the Heap Table after a reallocation. The runtime receives both the
+		 * old and the new addresses, so it can move the entry if the block was moved.
+		 * @param OldHeapPtr is the heap address passed to realloc
+		 * @param NewHeapPtr is the heap address returned by realloc
+		 * @param AllocatedType is the type of the reallocated heap block
+		 * @param Bytes is the new number of bytes of the block
 		 * @param Builder is the LLVM IR builder, to insert instructions and get types
 		 */
-		void UpdateHeapEntrySize(llvm::Value* HeapPtr, llvm::Value* NewSize, llvm::IRBuilder<> Builder);
+		void ReallocHeapEntry(llvm::Value* OldHeapPtr, llvm::Value* NewHeapPtr, llvm::Type* AllocatedType, llvm::Value* Bytes, llvm::IRBuilder<> Builder);
 		
 		/**
 		 * This method injects code to 'delete' an entry in the Heap Table. Whiro actually marks it as unreachable
@@ -218,8 +533,22 @@ class MemoryMonitor : public llvm::ModulePass {
 		int GetTypeIndex(llvm::Type* T);
 		
 		/**
-		 * This method inserts code to inspect variables of scalar types. We use the standard fprint function to 
-		 * report the values of this kind of variable
+		 * This method inserts a call to the formatter of the runtime that reports a scalar variable. The function
+		 * called depends on the format specifier of the variable.
+		 * @param Scalar is an LLVM scalar debug variable
+		 * @param ValidDef is the SSA definition associated with 'Scalar' that is valid at the inspection point
+		 * @param Format is the format specifier of the variable
+		 * @param OutputFilePtr is a pointer to the output file
+		 * @param CallCounter is the LLVM value corresponding to the function counter
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 * @param Scalarized indicates whether this variable is an array or struct value scalarized by some optimization
+		 * @return false if the type of ValidDef does not match the format specifier, so the variable is not reported
+		 */
+		bool ReportScalar(llvm::DIVariable* Scalar, llvm::Value* ValidDef, std::string Format, llvm::Value* OutputFilePtr, llvm::Value* CallCounter, llvm::IRBuilder<> Builder, bool Scalarized);
+		
+		/**
+		 * This method inserts code to inspect variables of scalar types. They are reported by the formatter of the
+		 * runtime, or by the standard fprint function if the formatter does not handle their type
 		 * @param Scalar is an LLVM scalar debug variable
 		 * @param ValidDef is the SSA definition associated with 'Scalar' that is valid at the inspection point
 		 * @param OutputFilePtr is a pointer to the output file
@@ -274,6 +603,29 @@ class MemoryMonitor : public llvm::ModulePass {
 		 */
 		void InspectArray(llvm::DIVariable* Array, llvm::Value* ValidDef, llvm::DICompositeType* ArrayType, llvm::Value* OutputFilePtr, llvm::Value* CallCounter, llvm::IRBuilder<> Builder);
 		
+		/**
+		 * This method inserts code to inspect arrays whose elements are structs, unions or pointers. The runtime
+		 * visits the elements with the type descriptor of the element type, striding over the array.
+		 * @param Array is an LLVM array debug variable
+		 * @param ValidDef is the SSA definition associated with 'Array' that is valid at the inspection point
+		 * @param ArrayType is the actual type of Array, ignoring qualified types
+		 * @param OutputFilePtr is a pointer to the output file
+		 * @param CallCounter is the LLVM value corresponding to the function counter 
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 */
+		void InspectArrayOfData(llvm::DIVariable* Array, llvm::Value* ValidDef, llvm::DICompositeType* ArrayType, llvm::Value* OutputFilePtr, llvm::Value* CallCounter, llvm::IRBuilder<> Builder);
+		
+		/**
+		 * This method returns the total number of elements of an array variable, in all of its dimensions. If
+		 * the array has variable length, it inserts instructions to compute such number.
+		 * @param Array is an LLVM array debug variable
+		 * @param ArrayType is the actual type of Array, ignoring qualified types
+		 * @param ElementBits is the size of each element of the array, in bits
+		 * @param Builder is the LLVM IR builder, to insert instructions and get types
+		 * @return the LLVM value holding the number of elements, as a 64-bit integer
+		 */
+		llvm::Value* GetArrayLength(llvm::DIVariable* Array, llvm::DICompositeType* ArrayType, uint64_t ElementBits, llvm::IRBuilder<> &Builder);
+		
 		/**
 		 * This method inspect and decide how to report the value of a variable based on its type.
 		 * @param Var is an LLVM  debug variable
@@ -327,12 +679,12 @@ class MemoryMonitor : public llvm::ModulePass {
 		/**
 		 * This method selects which definition of a variable is valid at an inspection point
 		 * @param Trace is the trace with the definitions of a variable
-		 * @param InsBlock is the block with the inspection point
+		 * @param InsPoint is the instruction before which the inspection point is created
 		 * @param ShadowVars is a map of variables that were shadowed in the stack
 		 * @param Builder is the LLVM IR builder, to insert instructions and get types
 		 * @return the valid definition of the variable
 		 */
-		llvm::Value* GetValidDef(std::vector<llvm::DbgVariableIntrinsic*>Trace, llvm::BasicBlock* InsBlock, std::map<std::string, llvm::AllocaInst*>*ShadowVars, llvm::IRBuilder<> Builder);
+		llvm::Value* GetValidDef(std::vector<llvm::DbgVariableIntrinsic*>Trace, llvm::Instruction* InsPoint, std::map<std::string, llvm::AllocaInst*>*ShadowVars, llvm::IRBuilder<> Builder);
 		
 		/**
 		 * This method creates an inspection point in a function. It decides which variables will be inspected based on
@@ -363,6 +715,33 @@ class MemoryMonitor : public llvm::ModulePass {
 		 */
 		llvm::Instruction* GetInsertionPoint(llvm::Function& F);
 		
+		/**
+		 * This method inserts a marker that tells where an inspection point, or a part of it, begins or ends.
+		 * @param InsPoint is the instruction before which the marker is inserted
+		 * @return the marker
+		 */
+		llvm::Instruction* CreatePointMarker(llvm::Instruction* InsPoint);
+		
+		/**
+		 * This method collects the program points inside a function where the user wants inspection points: the
+		 * latches of loops (-loops) and the first instruction of source lines (-lines).
+		 * @param F is the function being instrumented
+		 * @param Points receives each point, given by the instruction before which it is created and its source line
+		 */
+		void CollectInnerPoints(llvm::Function& F, std::vector<std::pair<llvm::Instruction*, unsigned>>*Points);
+		
+		/**
+		 * This method creates an inspection point inside a function. The point has its own counter, and it can
+		 * be reported only every Nth time it is reached (-stride).
+		 * @param F is the function being instrumented
+		 * @param InsPoint is the instruction before which the inspection point is created
+		 * @param Line is the source line of the inspection point
+		 * @param OutputFilePtr is a pointer to the output file
+		 * @param ShadowVars is a map of variables that were shadowed in the stack
+		 * @param Snapshots receives the inspection point, given by its markers
+		 */
+		void CreateInnerInspectionPoint(llvm::Function& F, llvm::Instruction* InsPoint, unsigned Line, llvm::Value* OutputFilePtr, std::map<std::string, llvm::AllocaInst*>*ShadowVars, std::vector<std::pair<llvm::Instruction*, llvm::Instruction*>>*Snapshots);
+		
 		/**
 		 * This method inserts all the instrumentation in a function. It creates the call counter, inserts code to
 		 * update the Heap Table, if the heap is to be inspected, and it injects the code to report the program
@@ -371,6 +750,15 @@ class MemoryMonitor : public llvm::ModulePass {
 		 */
 		void InstrumentFunction(llvm::Function& F);
 		
+		/**
+		 * This method finishes the inspection points of a function: it takes their snapshots, if the snapshot
+		 * mode is on, removes their markers and cleans up the function, if the user asks for it
+		 * @param F is the function being instrumented
+		 * @param OutputFilePtr is a pointer to the output file
+		 * @param Snapshots are the inspection points of F, given by their markers
+		 */
+		void FinishInspectionPoints(llvm::Function& F, llvm::Value* OutputFilePtr, std::vector<std::pair<llvm::Instruction*, llvm::Instruction*>>*Snapshots);
+		
 		/**
 		 * This method instrumentats a function, but only inserts code to update the Heap Table. It is useful when
 		 * the user chooses to inspect only the main routine of the program, but it wants to use the Precise mode
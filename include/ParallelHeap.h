@@ -0,0 +1,30 @@
+#ifndef PARALLEL_HEAP_H
+#define PARALLEL_HEAP_H
+
+//Number of chunks of the Heap Table per worker. More chunks balance the work better
+//when the sizes of the blocks differ a lot
+#define WHIRO_CHUNKS_PER_WORKER 8
+
+/**
+ * This function enables the parallel inspection of the entire heap. The live entries
+ * of the Heap Table are split in chunks, and a pool of workers reports each chunk in a
+ * buffer of its own. The buffers are written in the order of the entries, so the output
+ * does not depend on the number of workers. Each block is reported by itself, i.e.,
+ * pointers within blocks are not followed, as in the Fast mode, even if the program is
+ * instrumented in the Precise mode. The mode seen by the other threads is not changed.
+ * The pool is started by the first inspection of the heap, reused by the next ones, and
+ * stopped at the exit of the program.
+ * @param Workers is the number of threads that inspect the heap, including the thread
+ * of the program
+ */
+void WhiroSetParallelHeap(int Workers);
+
+/**
+ * This function reports all the heap-allocated data using the pool of workers.
+ * @param OutputFile is a pointer to the output file of the program
+ * @param FuncName is the name of the function currently being inspected
+ * @param CallCounter is the current value of the call counter of FuncName
+ */
+void WhiroInspectHeapInParallel(FILE* OutputFile, char* FuncName, long CallCounter);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef REFERENCECHECKER_H
+#define REFERENCECHECKER_H
+
+/**
+ * This function opens the output file of the checking mode. In this mode, the reports of the
+ * program are compared, as they are written, against the indexed output file of a reference run
+ * (produced with -indexed), which is mapped in memory. Reports that match the reference are
+ * dropped, so only the divergences reach the disk. Every inspection point is looked up in the
+ * index of the reference, so a divergence in one point does not affect the next ones. The
+ * checker is safe to use from many threads, but the reports of a point are compared as one
+ * sequence, so threads that report at the same time diverge where their lines interleave.
+ * Closing the stream releases the checker and unmaps the reference.
+ * @param ReferenceName is the name of the indexed output file of the reference run
+ * @param OutputName is the name of the file the divergences are written to
+ * @param Stop tells whether the program stops at the first divergence
+ * @return the stream the program writes its reports to
+ */
+FILE* WhiroOpenChecker(const char* ReferenceName, const char* OutputName, int Stop);
+
+/**
+ * This function starts an inspection point in the checking mode. The reports written since the
+ * previous point are checked, and the report of the new point is looked up in the reference.
+ * @param OutputFile is the stream returned by WhiroOpenChecker
+ * @param Point is the name of the point: its function, followed by @line for points inside functions
+ * @param CallCounter is the call counter of the point
+ */
+void WhiroCheckPoint(FILE* OutputFile, char* Point, long CallCounter);
+
+#endif
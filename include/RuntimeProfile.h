@@ -0,0 +1,61 @@
+#ifndef RUNTIMEPROFILE_H
+#define RUNTIMEPROFILE_H
+
+/**
+ * The sections of the runtime whose cost is measured when it is built with -DWHIRO_PROFILE.
+ * Without that flag, the macros below expand to nothing and the runtime is not changed.
+ * Sections are measured inclusively: the time of the output written while tracking a pointer
+ * counts for both sections. A section entered again before it returns is measured once.
+ */
+typedef enum {
+  WHIRO_SECTION_HEAP_TABLE,
+  WHIRO_SECTION_TRACK_POINTER,
+  WHIRO_SECTION_HASHING,
+  WHIRO_SECTION_INSPECT_DATA,
+  WHIRO_SECTION_ENTIRE_HEAP,
+  WHIRO_SECTION_OUTPUT,
+  WHIRO_QUANT_SECTIONS
+} WhiroSection;
+
+#ifdef WHIRO_PROFILE
+
+/**
+ * This function enters a section of the runtime.
+ * @param Section is the section
+ * @return the time the section was entered at, or 0 if it was already running
+ */
+uint64_t WhiroProfileBegin(int Section);
+
+/**
+ * This function leaves a section of the runtime, adding the time spent in it to its total.
+ * @param Section is the section
+ * @param Start is the value returned by WhiroProfileBegin
+ */
+void WhiroProfileEnd(int Section, uint64_t Start);
+
+/**
+ * These functions write to a file as the standard ones do, and their time is added to the
+ * output section. The runtime calls them wherever it writes to the output file.
+ */
+int WhiroProfiledPrintf(FILE* Stream, const char* Format, ...) __attribute__((format(printf, 2, 3)));
+size_t WhiroProfiledWrite(const void* Data, size_t Size, size_t Count, FILE* Stream);
+
+/**
+ * This function writes the table of the sections to the standard error. It is registered
+ * to run at the exit of the program when the first section is entered.
+ */
+void WhiroDumpRuntimeProfile();
+
+#define WHIRO_PROFILE_BEGIN(Section) uint64_t WhiroProfileStart##Section = WhiroProfileBegin(WHIRO_SECTION_##Section)
+#define WHIRO_PROFILE_END(Section) WhiroProfileEnd(WHIRO_SECTION_##Section, WhiroProfileStart##Section)
+
+#else
+
+#define WHIRO_PROFILE_BEGIN(Section)
+#define WHIRO_PROFILE_END(Section)
+#define WhiroProfiledPrintf fprintf
+#define WhiroProfiledWrite fwrite
+
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SHAREDRUNTIME_H
+#define SHAREDRUNTIME_H
+
+//In separate compilation, the output file of the program. Every unit, in the program or in its shared
+//libraries, writes to this stream, which is opened by the unit that sets up the runtime
+extern FILE* WhiroOutputFile;
+
+/**
+ * This function elects the unit that sets up the runtime, in separate compilation. It is called by the
+ * constructor of every unit, and only the first caller sets the options of the runtime and opens the output
+ * file. The output file is closed at the exit of the program.
+ * @return true for the first unit and false for the others
+ */
+int WhiroClaimRuntime();
+
+#endif
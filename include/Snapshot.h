@@ -0,0 +1,36 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/**
+ * This function enables the snapshot mode. In this mode, every inspection point forks
+ * the program, and the child reports the state from its copy-on-write image while the
+ * parent goes on with the execution. Each child writes to a file of its own, and these
+ * files are appended to the output file in the order of the inspection points, so the
+ * output is the same as the one produced without snapshots.
+ * @param OutputName is the name of the output file of the program
+ * @param MaxChildren is the maximum number of children inspecting the program at once
+ */
+void WhiroSetSnapshotMode(const char* OutputName, int MaxChildren);
+
+/**
+ * This function starts an inspection point. In the snapshot mode it forks the program.
+ * @param OutputFile is a pointer to the output file of the program
+ * @return 1 if the caller must report the state (the child, or the program itself
+ * when the snapshot mode is disabled or the fork fails), or 0 otherwise
+ */
+int WhiroBeginSnapshot(FILE* OutputFile);
+
+/**
+ * This function finishes an inspection point. A child flushes its report and exits.
+ * @param OutputFile is a pointer to the output file of the program
+ */
+void WhiroEndSnapshot(FILE* OutputFile);
+
+/**
+ * This function waits for every child and appends their reports to the output file.
+ * It must be called before closing the output file.
+ * @param OutputFile is a pointer to the output file of the program
+ */
+void WhiroWaitSnapshots(FILE* OutputFile);
+
+#endif
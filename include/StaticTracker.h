@@ -0,0 +1,37 @@
+#ifndef STATICTRACKER_H
+#define STATICTRACKER_H
+
+//Usage mode setting. If it is set, static variables are reported only when their contents change
+extern int TrackStatics;
+
+/**
+ * This function registers a static variable to be tracked. Static variables are identified by
+ * the order they are registered in.
+ * @param Address is the address of the static variable
+ * @param Size is the size of the static variable in bytes
+ */
+void WhiroTrackStatic(void* Address, uint64_t Size);
+
+/**
+ * This function checks which static variables changed since the last inspection point. Only the
+ * variables in pages written since then are hashed. Pages are tracked with the soft-dirty bits of
+ * the kernel. If they are not available, every variable is hashed.
+ */
+void WhiroUpdateStatics();
+
+/**
+ * This function starts the report of the static variables at an inspection point. It checks which
+ * of them changed, unless this was already done for this inspection point (e.g., before forking
+ * a snapshot).
+ */
+void WhiroBeginStatics();
+
+/**
+ * This function tells whether a static variable must be reported at the current inspection point.
+ * @param Id is the identifier of the static variable
+ * @return 1 if the contents of the variable changed since the last inspection point, or if it was
+ * never reported, and 0 otherwise
+ */
+int WhiroStaticChanged(int Id);
+
+#endif
@@ -9,7 +9,9 @@
  * Format is a integer corresponding to the format specifier of the field
  * Offset is the field offset within the type
  * BaseTypeIndex is the index to the type descriptor of the base type of this field.
- * (in case this is a derived type)
+ * (in case this is a derived type). Unions (Format 16) and non-inspectable values
+ * (Format 18) are printed as raw bytes, so it holds their size in bytes instead. A
+ * non-inspectable value of size 0 is not printed
  */
 typedef struct Field{
   char Name[MAX_NAME_LENGTH];
@@ -32,7 +34,8 @@ typedef struct TypeDescriptor{
 
 /** 
  * This method inserts in the program a call instruction to any function
- * @param ProgramName is the name of the program. It is used to open the type table file
+ * @param ProgramName is the name of the program. It is used to open the type table file. If it is NULL,
+ * only the settings are set, since the units registered their Type Tables
  * @param TableSize is the size of the type table
  * @param InsHeapArg is true if the heap is to be inspected
  * @param InsStackArg is true if the values store in the stack are to be inspected
@@ -40,6 +43,15 @@ typedef struct TypeDescriptor{
  */
 void WhiroOpenTypeTable(const char* ProgramName, int TableSize, int InsHeapArg, int InsStackArg, int PreciseArg);
 
+/** 
+ * This method appends the Type Table of a translation unit to the Type Table of the program, in separate
+ * compilation. Entries whose structural hash is already in the program are not appended again
+ * @param FileName is the name of the Type Table file of the unit
+ * @param TableSize is the number of entries in the file
+ * @param Map receives, for every entry of the unit, its index in the Type Table of the program
+ */
+void WhiroRegisterTypeTable(const char* FileName, int TableSize, int* Map);
+
 /** 
  * This method identifies if a given format corresponds to a scalar type
  * @param Format is an integer corresponding to the format specifier of a type
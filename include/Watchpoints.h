@@ -0,0 +1,31 @@
+#ifndef WATCHPOINTS_H
+#define WATCHPOINTS_H
+
+/**
+ * This function enables the watch mode. In this mode, the program is not inspected. Instead,
+ * hardware breakpoints trap every write to the watched variables, and each write is recorded
+ * with the function that made it and the call counter of that function. The records are kept
+ * in a ring buffer and written to a file at the exit of the program.
+ * @param OutputName is the name of the file the writes are reported to
+ * @param Capacity is the number of writes kept. Older writes are overwritten
+ */
+void WhiroSetWatchpoints(const char* OutputName, int Capacity);
+
+/**
+ * This function arms a hardware breakpoint on a static variable. Breakpoints are inherited by
+ * the threads created afterwards. Processors have few of them (4 in x86-64), and they watch
+ * aligned variables of 1, 2, 4 or 8 bytes.
+ * @param Address is the address of the variable
+ * @param Size is the size of the variable in bytes
+ * @param Name is the name of the variable
+ * @param Format is the format of the type of the variable
+ */
+void WhiroWatchStatic(void* Address, uint64_t Size, char* Name, int Format);
+
+/**
+ * This function disarms the breakpoints and writes the recorded writes, from the oldest to the
+ * newest. It is registered to run at the exit of the program.
+ */
+void WhiroDumpWatchpoints();
+
+#endif
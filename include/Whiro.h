@@ -5,11 +5,30 @@
 #include<stdio.h>
 #include<ctype.h>
 #include<string.h>
+#include<stdint.h>
 #include "uthash.h"
 
+//Entry points of the runtime executed at every allocation or inspection point are hinted for
+//inlining. When the runtime is linked with the instrumented program as bitcode and both are
+//optimized together, these calls can be inlined and specialized at each call site
+#define WHIRO_HOT inline __attribute__((hot))
+
 #include "TypeTable.h"
 #include "HeapTable.h"
 #include "CompositeInspector.h"
 #include "ArrayHashCalculator.h"
+#include "HeapHasher.h"
+#include "Snapshot.h"
+#include "ParallelHeap.h"
+#include "CallProfile.h"
+#include "StaticTracker.h"
+#include "Watchpoints.h"
+#include "CheckpointIndex.h"
+#include "CheckpointReader.h"
+#include "ReferenceChecker.h"
+#include "RuntimeProfile.h"
+#include "SharedRuntime.h"
+#include "Formatter.h"
+#include "HashTree.h"
 
 #endif
@@ -1,67 +1,73 @@
 #include "../include/Whiro.h"
 
+//Usage mode settings. If WideHash is set, arrays are hashed with the 64-bit hash of their bytes. If ExactReals is
+//set, floating-point values are hashed by their bits instead of being quantized with FpPrecision
+int WideHash = 0, ExactReals = 0;
+
+//Constants of the 64-bit hash, the ones of wyhash
+static const uint64_t WhiroSecret[4] = {0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL};
+
+//Floating-point elements are quantized in chunks of this many values, which are hashed one after the other
+#define WHIRO_REAL_CHUNK 256
+
 char* WhiroGetArrayIndexAsString(int Index){
-  int QuantDigits = 0, Num = Index;
-  while(Num !=0){
-    QuantDigits++;
-    Num /= 10;
-  }
-  char IndexString[QuantDigits + 3];
-  snprintf(IndexString, QuantDigits + 3, "[%d]", Index);
+  int Length = snprintf(NULL, 0, "[%d]", Index) + 1;
+  char* IndexString = (char*) malloc(Length);
+  snprintf(IndexString, Length, "[%d]", Index);
   return IndexString;
 }
 
-int WhiroComputeHashcode1D(void* Array, int Size, int Format){
+int WhiroComputeHashcode1D(void* Array, size_t Size, int Format){
   //Traverse an array of 1 dimension and compute a hashcode value
   int Hashcode = 1;
-  for(int i = 0; i < Size; i++){
+  for(size_t i = 0; i < Size; i++){
     switch(Format){
       case 1:
-        Hashcode = 31 * Hashcode + (((int)*((double*)Array + i)) == NULL ? 0 : (int)*((double *)Array + i) * FpPrecision);
+        Hashcode = 31 * Hashcode + (int)*((double*)Array + i) * FpPrecision;
         break;
       
       case 2:
-        Hashcode = 31 * Hashcode + (((int)*((float*)Array + i)) == NULL ? 0 : (int)*((float *)Array + i)  * FpPrecision);
+        Hashcode = 31 * Hashcode + (int)*((float*)Array + i) * FpPrecision;
         break;
       
       case 3:
-        Hashcode = 31 * Hashcode + (((short)*((short*)Array + i)) == NULL ? 0 : (short)*((short *)Array + i));
+        Hashcode = 31 * Hashcode + (short)*((short*)Array + i);
         break;
       
       case 4:
-        Hashcode = 31 * Hashcode + (((long)*((long*)Array + i)) == NULL ? 0 : (long)*((long *)Array + i));
+        Hashcode = 31 * Hashcode + (long)*((long*)Array + i);
         break;
         
       case 5:
-        Hashcode = 31 * Hashcode + (((long long)*((long long*)Array + i)) == NULL ? 0 : (long long)*((long long*)Array + i));
+        Hashcode = 31 * Hashcode + (long long)*((long long*)Array + i);
         break;
       
       case 6:
-        Hashcode = 31 * Hashcode + (((int)*((int*)Array + i)) == NULL ? 0 : (int)*((int*)Array + i));
+        Hashcode = 31 * Hashcode + (int)*((int*)Array + i);
         break;
       
       case 7:
-        Hashcode = 31 * Hashcode + (((char)*((char*)Array + i)) == NULL ? 0 : (char)*((char*)Array + i));
+        Hashcode = 31 * Hashcode + (char)*((char*)Array + i);
         break;
       
       case 8:
-        Hashcode = 31 * Hashcode + (((unsigned char)*((unsigned char*)Array + i)) == NULL ? 0 : (unsigned char)*((unsigned char*)Array + i));
+        Hashcode = 31 * Hashcode + (unsigned char)*((unsigned char*)Array + i);
         break;
         
       case 9:
-        Hashcode = 31 * Hashcode + (((unsigned short)*((unsigned short*)Array + i)) == NULL ? 0 : (unsigned short)*((unsigned short *)Array + i));
+        Hashcode = 31 * Hashcode + (unsigned short)*((unsigned short*)Array + i);
         break;
       
       case 10:
-        Hashcode = 31 * Hashcode + (((unsigned long)*((unsigned long*)Array + i)) == NULL ? 0 : (unsigned long)*((unsigned long *)Array + i));
+        Hashcode = 31 * Hashcode + (unsigned long)*((unsigned long*)Array + i);
         break;
         
       case 11:
-        Hashcode = 31 * Hashcode + (((unsigned long long)*((unsigned long long*)Array + i)) == NULL ? 0 : (unsigned long long)*((unsigned long long*)Array + i));
+        Hashcode = 31 * Hashcode + (unsigned long long)*((unsigned long long*)Array + i);
         break;
       
       case 12:
-        Hashcode = 31 * Hashcode + (((unsigned int)*((unsigned int*)Array + i)) == NULL ? 0 : (unsigned int)*((unsigned int*)Array + i));
+        Hashcode = 31 * Hashcode + (unsigned int)*((unsigned int*)Array + i);
         break;
 
     }
@@ -69,10 +75,11 @@ int WhiroComputeHashcode1D(void* Array, int Size, int Format){
   return Hashcode;
 }
 
-int WhiroComputeHashcode(void* Array, int TotalElements, int Step, int Format){
+int WhiroComputeHashcode(void* Array, size_t TotalElements, size_t Step, int Format){
   //Traverse an array with N dimensions and compute a hashcode value for it
+  WHIRO_PROFILE_BEGIN(HASHING);
   int Hashcode = 0;
-  for(int i = 0; i < TotalElements; i += Step){
+  for(size_t i = 0; i < TotalElements; i += Step){
     switch(Format){
       case 1:
         Hashcode += WhiroComputeHashcode1D((double*)Array + i, Step, Format);
@@ -127,5 +134,179 @@ int WhiroComputeHashcode(void* Array, int TotalElements, int Step, int Format){
         break;
     }
   }
+  WHIRO_PROFILE_END(HASHING);
+  return Hashcode;
+}
+
+uint64_t WhiroHashCombine(uint64_t Hashcode, uint64_t Value){
+  //Mix the value into the hashcode and scramble the result with the finalizer of SplitMix64
+  uint64_t Mixed = Hashcode ^ (Value + 0x9e3779b97f4a7c15ULL + (Hashcode << 6) + (Hashcode >> 2));
+  Mixed = (Mixed ^ (Mixed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  Mixed = (Mixed ^ (Mixed >> 27)) * 0x94d049bb133111ebULL;
+  return Mixed ^ (Mixed >> 31);
+}
+
+void WhiroSetArrayHashing(int WideHashArg, int ExactRealsArg){
+  WideHash = WideHashArg;
+  ExactReals = ExactRealsArg;
+}
+
+static inline uint64_t WhiroQuantizeValue(double Value){
+  //Floating-point values are compared with the same precision Whiro uses to print them
+  if (Value != Value)
+    return 0x7ff8000000000000ULL;
+
+  double Scaled = Value * FpPrecision;
+  if (Scaled >= 9.2e18 || Scaled <= -9.2e18){
+    uint64_t Bits;
+    memcpy(&Bits, &Value, sizeof(double));
+    return Bits;
+  }
+
+  //Halves are rounded away from zero. The sign is copied instead of tested, since it is as random as the data
+  return (uint64_t)(int64_t)(Scaled + __builtin_copysign(0.5, Scaled));
+}
+
+uint64_t WhiroQuantize(double Value){
+  return WhiroQuantizeValue(Value);
+}
+
+uint64_t WhiroHashReal(double Value){
+  if (!ExactReals)
+    return WhiroQuantize(Value);
+
+  uint64_t Bits;
+  memcpy(&Bits, &Value, sizeof(double));
+  return Bits;
+}
+
+static inline void WhiroMum(uint64_t *A, uint64_t *B){
+  __uint128_t Product = (__uint128_t) *A * *B;
+  *A = (uint64_t) Product;
+  *B = (uint64_t)(Product >> 64);
+}
+
+static inline uint64_t WhiroMix(uint64_t A, uint64_t B){
+  WhiroMum(&A, &B);
+  return A ^ B;
+}
+
+static inline uint64_t WhiroRead64(const unsigned char *Data){
+  uint64_t Value;
+  memcpy(&Value, Data, sizeof(uint64_t));
+  return Value;
+}
+
+static inline uint64_t WhiroRead32(const unsigned char *Data){
+  uint32_t Value;
+  memcpy(&Value, Data, sizeof(uint32_t));
+  return Value;
+}
+
+uint64_t WhiroHashBytes64(const void *Data, size_t Size, uint64_t Seed){
+  //The bytes are consumed 48 at a time by three independent lanes, each one a 64x64->128-bit multiplication
+  //folded into 64 bits, so the hash keeps up with the bandwidth of the memory
+  const unsigned char *Bytes = (const unsigned char*) Data;
+  uint64_t A, B;
+  Seed ^= WhiroMix(Seed ^ WhiroSecret[0], WhiroSecret[1]);
+  if (Size <= 16){
+    if (Size >= 4){
+      size_t Middle = (Size >> 3) << 2;
+      A = (WhiroRead32(Bytes) << 32) | WhiroRead32(Bytes + Middle);
+      B = (WhiroRead32(Bytes + Size - 4) << 32) | WhiroRead32(Bytes + Size - 4 - Middle);
+    }
+    else if (Size > 0){
+      A = ((uint64_t) Bytes[0] << 16) | ((uint64_t) Bytes[Size >> 1] << 8) | Bytes[Size - 1];
+      B = 0;
+    }
+    else
+      A = B = 0;
+  }
+  else{
+    size_t Rest = Size;
+    if (Rest > 48){
+      uint64_t Lane1 = Seed, Lane2 = Seed;
+      do{
+        Seed = WhiroMix(WhiroRead64(Bytes) ^ WhiroSecret[1], WhiroRead64(Bytes + 8) ^ Seed);
+        Lane1 = WhiroMix(WhiroRead64(Bytes + 16) ^ WhiroSecret[2], WhiroRead64(Bytes + 24) ^ Lane1);
+        Lane2 = WhiroMix(WhiroRead64(Bytes + 32) ^ WhiroSecret[3], WhiroRead64(Bytes + 40) ^ Lane2);
+        Bytes += 48;
+        Rest -= 48;
+      } while (Rest > 48);
+      Seed ^= Lane1 ^ Lane2;
+    }
+    while (Rest > 16){
+      Seed = WhiroMix(WhiroRead64(Bytes) ^ WhiroSecret[1], WhiroRead64(Bytes + 8) ^ Seed);
+      Bytes += 16;
+      Rest -= 16;
+    }
+    A = WhiroRead64(Bytes + Rest - 16);
+    B = WhiroRead64(Bytes + Rest - 8);
+  }
+
+  A ^= WhiroSecret[1];
+  B ^= Seed;
+  WhiroMum(&A, &B);
+  return WhiroMix(A ^ WhiroSecret[0] ^ Size, B ^ WhiroSecret[1]);
+}
+
+size_t WhiroScalarSize(int Format){
+  switch (Format){
+    case 1: return sizeof(double);
+    case 2: return sizeof(float);
+    case 3: return sizeof(short);
+    case 4: return sizeof(long);
+    case 5: return sizeof(long long);
+    case 6: return sizeof(int);
+    case 7: return sizeof(char);
+    case 8: return sizeof(unsigned char);
+    case 9: return sizeof(unsigned short);
+    case 10: return sizeof(unsigned long);
+    case 11: return sizeof(unsigned long long);
+    case 12: return sizeof(unsigned int);
+    default: return 0;
+  }
+}
+
+uint64_t WhiroHashScalars64(void* Array, size_t QuantElements, int Format, uint64_t Seed){
+  //Integers, and reals hashed by their bits, are hashed as the raw bytes of the elements, in a single pass
+  if ((Format != 1 && Format != 2) || ExactReals)
+    return WhiroHashBytes64(Array, QuantElements * WhiroScalarSize(Format), Seed);
+
+  //Quantized reals are converted in chunks, and each chunk is hashed with the hashcode of the previous one as seed
+  uint64_t Chunk[WHIRO_REAL_CHUNK];
+  for (size_t i = 0; i < QuantElements; i += WHIRO_REAL_CHUNK){
+    size_t Quant = (QuantElements - i < WHIRO_REAL_CHUNK) ? QuantElements - i : WHIRO_REAL_CHUNK;
+    for (size_t j = 0; j < Quant; j++)
+      Chunk[j] = WhiroQuantizeValue(Format == 1 ? ((double*) Array)[i + j] : ((float*) Array)[i + j]);
+    Seed = WhiroHashBytes64(Chunk, Quant * sizeof(uint64_t), Seed);
+  }
+  return Seed;
+}
+
+uint64_t WhiroComputeHashcode64(void* Array, size_t TotalElements, int Format){
+  //Large arrays may be hashed as trees, whose root is their hashcode
+  if (WhiroUsesHashTree(TotalElements))
+    return WhiroComputeHashTree(Array, TotalElements, Format, NULL, NULL, 0);
+
+  WHIRO_PROFILE_BEGIN(HASHING);
+  uint64_t Hashcode = WhiroHashScalars64(Array, TotalElements, Format, WhiroHashBytes64(&Format, sizeof(int), TotalElements));
+  WHIRO_PROFILE_END(HASHING);
   return Hashcode;
 }
+
+uint64_t WhiroHashArray(void* Array, size_t TotalElements, size_t Step, int Format){
+  if (WideHash)
+    return WhiroComputeHashcode64(Array, TotalElements, Format);
+  return (uint32_t) WhiroComputeHashcode(Array, TotalElements, Step, Format);
+}
+
+void WhiroReportArrayHashcode(FILE* OutputFile, const char* Name, const char* FuncName, long CallCounter, const char* Tag, void* Array, size_t TotalElements, size_t Step, int Format){
+  //The trees of reported arrays are written to the file of trees, so their differences can be localized later
+  if (WideHash && WhiroUsesHashTree(TotalElements))
+    WhiroReportU64(OutputFile, Name, FuncName, CallCounter, Tag, WhiroComputeHashTree(Array, TotalElements, Format, Name, FuncName, CallCounter));
+  else if (WideHash)
+    WhiroReportU64(OutputFile, Name, FuncName, CallCounter, Tag, WhiroComputeHashcode64(Array, TotalElements, Format));
+  else
+    WhiroReportI64(OutputFile, Name, FuncName, CallCounter, Tag, WhiroComputeHashcode(Array, TotalElements, Step, Format));
+}
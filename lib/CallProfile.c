@@ -0,0 +1,202 @@
+#include "../include/Whiro.h"
+#include<pthread.h>
+
+__thread uint64_t *WhiroCounters = NULL;
+__thread int WhiroCurrentFunction = -1;
+
+/**
+ * This structure holds a counter block of a thread. Blocks are kept in a list so the profile
+ * can sum them, and they are never freed, since threads may exit before the profile is written
+ * Next is the block allocated before this one
+ * Base is the identifier of the first counter of the block
+ * Quant is the number of counters in the block
+ * Counters are the counters of the thread
+ */
+typedef struct CounterBlock {
+  struct CounterBlock* Next;
+  int Base;
+  int Quant;
+  uint64_t Counters[];
+} CounterBlock;
+
+/**
+ * This structure describes a translation unit registered in separate compilation. Units are never
+ * freed, so the watch handler can walk them while other units are registered
+ * Next is the unit registered before this one
+ * Index is the position of the unit in the per-thread arrays of unit blocks
+ * Base is the identifier of the first counter of the unit
+ * Quant is the number of counters in the unit
+ */
+typedef struct CounterUnit {
+  struct CounterUnit* Next;
+  int Index;
+  int Base;
+  int Quant;
+} CounterUnit;
+
+static int QuantCounters = 0;
+static const char **CounterNames = NULL;
+//Capacity of CounterNames when the runtime owns it. It is zero while the names are unset or belong to a module
+static int QuantNames = 0;
+static CounterBlock *CounterBlocks = NULL;
+static pthread_mutex_t CounterBlocksLock = PTHREAD_MUTEX_INITIALIZER;
+
+//In separate compilation, every thread has a block for each unit it runs, so the units loaded after the program
+//started, e.g., with dlopen, get blocks of their own. UnitBlocks maps the index of each unit to the block of the thread
+static CounterUnit *CounterUnits = NULL;
+static int QuantUnits = 0;
+static __thread uint64_t **UnitBlocks = NULL;
+static __thread int QuantUnitBlocks = 0;
+
+//Call profile settings
+static char *ProfileName = NULL;
+
+void WhiroSetCounters(int Quant, const char** Names){
+  QuantCounters = Quant;
+  CounterNames = Names;
+  QuantNames = 0;
+}
+
+void WhiroRegisterCounters(int Quant, const char** Names, int* Base, int* Unit){
+  pthread_mutex_lock(&CounterBlocksLock);
+  //The names of the units are copied to an array of the runtime, which grows as units are registered. Programs
+  //instrumented as a whole set their names with WhiroSetCounters instead. Those names belong to the module, so
+  //they are copied to the heap the first time the array grows
+  if(QuantCounters + Quant > QuantNames){
+    int Capacity = 2 * (QuantCounters + Quant);
+    if(QuantNames == 0){
+      const char **Owned = (const char**) malloc(sizeof(const char*) * Capacity);
+      if(QuantCounters > 0)
+        memcpy(Owned, CounterNames, sizeof(const char*) * QuantCounters);
+      CounterNames = Owned;
+    }
+    else
+      CounterNames = (const char**) realloc(CounterNames, sizeof(const char*) * Capacity);
+    QuantNames = Capacity;
+  }
+  memcpy(CounterNames + QuantCounters, Names, sizeof(const char*) * Quant);
+
+  CounterUnit *NewUnit = (CounterUnit*) malloc(sizeof(CounterUnit));
+  NewUnit->Next = CounterUnits;
+  NewUnit->Index = QuantUnits++;
+  NewUnit->Base = QuantCounters;
+  NewUnit->Quant = Quant;
+  __atomic_store_n(&CounterUnits, NewUnit, __ATOMIC_RELEASE);
+  *Base = NewUnit->Base;
+  *Unit = NewUnit->Index;
+  QuantCounters += Quant;
+  pthread_mutex_unlock(&CounterBlocksLock);
+}
+
+const char* WhiroGetCounterName(int Id){
+  pthread_mutex_lock(&CounterBlocksLock);
+  const char* Name = (Id >= 0 && Id < QuantCounters) ? CounterNames[Id] : "unknown";
+  pthread_mutex_unlock(&CounterBlocksLock);
+  return Name;
+}
+
+static CounterBlock* WhiroNewCounterBlock(int Base, int Quant){
+  CounterBlock *Block = (CounterBlock*) calloc(1, sizeof(CounterBlock) + sizeof(uint64_t) * Quant);
+  if(Block == NULL){
+    printf("Error allocating the counters of a thread\n");
+    exit(1);
+  }
+  Block->Base = Base;
+  Block->Quant = Quant;
+  pthread_mutex_lock(&CounterBlocksLock);
+  Block->Next = CounterBlocks;
+  CounterBlocks = Block;
+  pthread_mutex_unlock(&CounterBlocksLock);
+  return Block;
+}
+
+uint64_t* WhiroGetCounterBlock(){
+  WhiroCounters = WhiroNewCounterBlock(0, QuantCounters)->Counters;
+  return WhiroCounters;
+}
+
+uint64_t* WhiroGetUnitCounterBlock(int Unit){
+  CounterUnit *Registered = __atomic_load_n(&CounterUnits, __ATOMIC_ACQUIRE);
+  while(Registered->Index != Unit)
+    Registered = Registered->Next;
+
+  //The array of the thread grows to hold the units registered since it was allocated. The new array is published
+  //before the old one is freed, so the watch handler, which may interrupt this thread, reads either of them
+  if(Unit >= QuantUnitBlocks){
+    int Capacity = __atomic_load_n(&QuantUnits, __ATOMIC_RELAXED);
+    uint64_t **Blocks = (uint64_t**) calloc(Capacity, sizeof(uint64_t*));
+    if(QuantUnitBlocks > 0)
+      memcpy(Blocks, UnitBlocks, sizeof(uint64_t*) * QuantUnitBlocks);
+    uint64_t **Old = UnitBlocks;
+    __atomic_store_n(&UnitBlocks, Blocks, __ATOMIC_RELEASE);
+    __atomic_store_n(&QuantUnitBlocks, Capacity, __ATOMIC_RELEASE);
+    free(Old);
+  }
+  if(UnitBlocks[Unit] == NULL)
+    __atomic_store_n(&UnitBlocks[Unit], WhiroNewCounterBlock(Registered->Base, Registered->Quant)->Counters, __ATOMIC_RELEASE);
+  return UnitBlocks[Unit];
+}
+
+uint64_t WhiroReadCounter(int Id){
+  if(Id < 0)
+    return 0;
+  if(WhiroCounters != NULL)
+    return WhiroCounters[Id];
+
+  for(CounterUnit *Unit = __atomic_load_n(&CounterUnits, __ATOMIC_ACQUIRE); Unit != NULL; Unit = Unit->Next){
+    if(Id < Unit->Base || Id >= Unit->Base + Unit->Quant)
+      continue;
+    uint64_t **Blocks = __atomic_load_n(&UnitBlocks, __ATOMIC_ACQUIRE);
+    if(Unit->Index >= __atomic_load_n(&QuantUnitBlocks, __ATOMIC_ACQUIRE) || Blocks[Unit->Index] == NULL)
+      return 0;
+    return Blocks[Unit->Index][Id - Unit->Base];
+  }
+  return 0;
+}
+
+void WhiroSetCallProfile(const char* OutputName){
+  ProfileName = strdup(OutputName);
+  atexit(WhiroDumpCallProfile);
+}
+
+typedef struct {
+  const char* Name;
+  uint64_t Count;
+} ProfileEntry;
+
+static int WhiroCompareProfileEntries(const void *A, const void *B){
+  uint64_t CountA = ((ProfileEntry*) A)->Count, CountB = ((ProfileEntry*) B)->Count;
+  if (CountA != CountB)
+    return CountA < CountB ? 1 : -1;
+  return strcmp(((ProfileEntry*) A)->Name, ((ProfileEntry*) B)->Name);
+}
+
+void WhiroDumpCallProfile(){
+  if (ProfileName == NULL)
+    return;
+
+  FILE* Profile = fopen(ProfileName, "w");
+  if (Profile == NULL){
+    printf("Error opening profile file %s\n", ProfileName);
+    return;
+  }
+
+  //Threads still running may update their counters while they are summed. The profile is only a hint
+  pthread_mutex_lock(&CounterBlocksLock);
+  ProfileEntry *Entries = (ProfileEntry*) calloc(QuantCounters, sizeof(ProfileEntry));
+  for (int i = 0; i < QuantCounters; i++)
+    Entries[i].Name = CounterNames[i];
+
+  for (CounterBlock *Block = CounterBlocks; Block != NULL; Block = Block->Next){
+    for (int i = 0; i < Block->Quant; i++)
+      Entries[Block->Base + i].Count += Block->Counters[i];
+  }
+  pthread_mutex_unlock(&CounterBlocksLock);
+
+  qsort(Entries, QuantCounters, sizeof(ProfileEntry), WhiroCompareProfileEntries);
+  for (int i = 0; i < QuantCounters; i++)
+    fprintf(Profile, "%s %lu\n", Entries[i].Name, Entries[i].Count);
+
+  free(Entries);
+  fclose(Profile);
+}
@@ -0,0 +1,275 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "../include/Whiro.h"
+#include<pthread.h>
+
+//Usage mode setting. If it is set, the inspection points are indexed
+int IndexOutput = 0;
+
+/**
+ * This structure maps the name of an inspection point to its index
+ * Name is the name of the point
+ * Id is the index of the point
+ * hh is the member to make this entry "hashable"
+ */
+typedef struct {
+  char* Name;
+  uint32_t Id;
+  UT_hash_handle hh;
+} IndexedPoint;
+
+static IndexedPoint *PointTable = NULL;
+static char **PointNames = NULL;
+static uint32_t QuantPoints = 0;
+
+//Only the entries of the open block are kept
+static WhiroCheckpointEntry *Entries = NULL;
+static WhiroCheckpointRange *Ranges = NULL;
+static uint32_t QuantEntries = 0;
+static uint32_t EntriesCapacity = 0;
+static uint32_t BlockPoints = 64;
+
+//The header of the open block, and what is needed to write the trailer
+static WhiroCheckpointBlock OpenBlock;
+static uint64_t QuantBlocks = 0;
+static uint64_t IndexedEntries = 0;
+static uint64_t LastBlock = 0;
+//Points are numbered when they start, but named in the index of the block where their first report is written
+static uint32_t NamedPoints = 0;
+
+/**
+ * This structure holds the report of the last inspection point of a thread, which is written to the
+ * file as a whole when the thread reaches its next point
+ * Buffer holds the text of the report
+ * Point and Counter identify the inspection point
+ * Pending tells whether the thread is inside an inspection point
+ * Next is the report of the thread that indexed its first point before this one
+ */
+typedef struct ThreadReport {
+  char* Buffer;
+  size_t Length;
+  size_t Capacity;
+  uint32_t Point;
+  uint64_t Counter;
+  int Pending;
+  struct ThreadReport* Next;
+} ThreadReport;
+
+static __thread ThreadReport *CurrentReport = NULL;
+static ThreadReport *Reports = NULL;
+
+//The program writes to a stream that keeps the reports of each thread apart, and the reports are written to
+//IndexedFile whole, so the reports of threads that run at the same time do not interleave
+static FILE *IndexedFile = NULL;
+static uint64_t FileOffset = 0;
+
+//Threads may report points at the same time
+static pthread_mutex_t IndexLock = PTHREAD_MUTEX_INITIALIZER;
+
+void WhiroSetIndexedOutput(int BlockSize){
+  IndexOutput = 1;
+  if (BlockSize > 0)
+    BlockPoints = BlockSize;
+}
+
+static uint32_t WhiroGetPointId(char* Point){
+  IndexedPoint *Entry;
+  HASH_FIND_STR(PointTable, Point, Entry);
+  if (Entry)
+    return Entry->Id;
+
+  Entry = (IndexedPoint*) malloc(sizeof(IndexedPoint));
+  Entry->Name = strdup(Point);
+  Entry->Id = QuantPoints++;
+  HASH_ADD_KEYPTR(hh, PointTable, Entry->Name, strlen(Entry->Name), Entry);
+  PointNames = (char**) realloc(PointNames, sizeof(char*) * QuantPoints);
+  PointNames[Entry->Id] = Entry->Name;
+  return Entry->Id;
+}
+
+static int WhiroCompareEntries(const void *A, const void *B){
+  const WhiroCheckpointEntry *EntryA = (const WhiroCheckpointEntry*) A;
+  const WhiroCheckpointEntry *EntryB = (const WhiroCheckpointEntry*) B;
+  if (EntryA->Point != EntryB->Point)
+    return (EntryA->Point < EntryB->Point) ? -1 : 1;
+  if (EntryA->Counter != EntryB->Counter)
+    return (EntryA->Counter < EntryB->Counter) ? -1 : 1;
+  //Points reported many times with the same counter, as in different threads, keep the order of the file
+  return (EntryA->Start < EntryB->Start) ? -1 : (EntryA->Start > EntryB->Start);
+}
+
+static void WhiroWriteIndexed(const void* Data, size_t Size){
+  WhiroProfiledWrite(Data, 1, Size, IndexedFile);
+  FileOffset += Size;
+}
+
+static void WhiroCloseBlock(){
+  if (QuantEntries == 0)
+    return;
+
+  qsort(Entries, QuantEntries, sizeof(WhiroCheckpointEntry), WhiroCompareEntries);
+
+  //The entries of each point are described by a range, so readers find a point without reading every entry
+  uint32_t QuantRanges = 0;
+  for (uint32_t i = 0; i < QuantEntries; i++){
+    if (i == 0 || Entries[i].Point != Entries[i - 1].Point){
+      Ranges[QuantRanges].Point = Entries[i].Point;
+      Ranges[QuantRanges].First = i;
+      Ranges[QuantRanges].MinCounter = Entries[i].Counter;
+      QuantRanges++;
+    }
+    Ranges[QuantRanges - 1].MaxCounter = Entries[i].Counter;
+  }
+
+  OpenBlock.FirstPoint = NamedPoints;
+  OpenBlock.QuantNames = QuantPoints - NamedPoints;
+  OpenBlock.QuantRanges = QuantRanges;
+  OpenBlock.QuantEntries = QuantEntries;
+  LastBlock = FileOffset;
+  WhiroWriteIndexed(&OpenBlock, sizeof(WhiroCheckpointBlock));
+  for (uint32_t i = OpenBlock.FirstPoint; i < QuantPoints; i++){
+    uint32_t Length = strlen(PointNames[i]);
+    WhiroWriteIndexed(&Length, sizeof(uint32_t));
+    WhiroWriteIndexed(PointNames[i], Length);
+  }
+  NamedPoints = QuantPoints;
+  WhiroWriteIndexed(Ranges, sizeof(WhiroCheckpointRange) * QuantRanges);
+  WhiroWriteIndexed(Entries, sizeof(WhiroCheckpointEntry) * QuantEntries);
+
+  QuantBlocks++;
+  IndexedEntries += QuantEntries;
+  QuantEntries = 0;
+}
+
+static void WhiroWriteReport(ThreadReport* Report){
+  if (!Report->Pending)
+    return;
+  Report->Pending = 0;
+
+  //A block is closed when it is full, or when offsets inside it would not fit in 32 bits
+  if (QuantEntries == BlockPoints || (QuantEntries > 0 && FileOffset + Report->Length - OpenBlock.Offset > INT32_MAX))
+    WhiroCloseBlock();
+
+  if (QuantEntries == 0){
+    memcpy(OpenBlock.Magic, WHIRO_CHECKPOINT_BLOCK_MAGIC, sizeof(OpenBlock.Magic));
+    OpenBlock.Block = QuantBlocks;
+    OpenBlock.Offset = FileOffset;
+    OpenBlock.Previous = LastBlock;
+  }
+  if (QuantEntries == EntriesCapacity){
+    EntriesCapacity = EntriesCapacity ? 2 * EntriesCapacity : 64;
+    Entries = (WhiroCheckpointEntry*) realloc(Entries, sizeof(WhiroCheckpointEntry) * EntriesCapacity);
+    Ranges = (WhiroCheckpointRange*) realloc(Ranges, sizeof(WhiroCheckpointRange) * EntriesCapacity);
+  }
+  WhiroCheckpointEntry *Entry = &Entries[QuantEntries++];
+  Entry->Point = Report->Point;
+  Entry->Block = QuantBlocks;
+  Entry->Counter = Report->Counter;
+  Entry->Start = FileOffset - OpenBlock.Offset;
+  Entry->Length = Report->Length;
+  WhiroWriteIndexed(Report->Buffer, Report->Length);
+  Report->Length = 0;
+}
+
+static ThreadReport* WhiroGetThreadReport(){
+  if (CurrentReport == NULL){
+    CurrentReport = (ThreadReport*) calloc(1, sizeof(ThreadReport));
+    pthread_mutex_lock(&IndexLock);
+    CurrentReport->Next = Reports;
+    Reports = CurrentReport;
+    pthread_mutex_unlock(&IndexLock);
+  }
+  return CurrentReport;
+}
+
+static ssize_t WhiroIndexedWrite(void* Cookie, const char* Buffer, size_t Size){
+  (void) Cookie;
+  //The stream is unbuffered, so this runs in the thread that wrote. What a thread writes inside an inspection point
+  //is kept until its next point, and what it writes outside points goes straight to the file
+  ThreadReport* Report = WhiroGetThreadReport();
+  pthread_mutex_lock(&IndexLock);
+  if (!Report->Pending)
+    WhiroWriteIndexed(Buffer, Size);
+  else{
+    if (Report->Length + Size > Report->Capacity){
+      Report->Capacity = 2 * (Report->Length + Size);
+      Report->Buffer = (char*) realloc(Report->Buffer, Report->Capacity);
+    }
+    memcpy(Report->Buffer + Report->Length, Buffer, Size);
+    Report->Length += Size;
+  }
+  pthread_mutex_unlock(&IndexLock);
+  return Size;
+}
+
+static int WhiroIndexedClose(void* Cookie){
+  (void) Cookie;
+  //The index is written by WhiroWriteIndex before the program closes the stream. Reports written after it have no entry
+  pthread_mutex_lock(&IndexLock);
+  while (Reports != NULL){
+    ThreadReport* Report = Reports;
+    WhiroWriteIndexed(Report->Buffer, Report->Length);
+    Reports = Report->Next;
+    free(Report->Buffer);
+    free(Report);
+  }
+  CurrentReport = NULL;
+  int Status = fclose(IndexedFile);
+  IndexedFile = NULL;
+  pthread_mutex_unlock(&IndexLock);
+  return Status;
+}
+
+FILE* WhiroOpenIndexedOutput(const char* FileName){
+  IndexedFile = fopen(FileName, "w");
+  if (IndexedFile == NULL)
+    return NULL;
+
+  cookie_io_functions_t Functions = {NULL, WhiroIndexedWrite, NULL, WhiroIndexedClose};
+  FILE* OutputFile = fopencookie(NULL, "w", Functions);
+  if (OutputFile)
+    setvbuf(OutputFile, NULL, _IONBF, 0);
+  return OutputFile;
+}
+
+void WhiroIndexPoint(FILE* OutputFile, char* Point, long CallCounter){
+  (void) OutputFile;
+  if (!IndexOutput || IndexedFile == NULL)
+    return;
+
+  //The report of the previous point of this thread is complete, so it is written as a whole
+  ThreadReport* Report = WhiroGetThreadReport();
+  pthread_mutex_lock(&IndexLock);
+  WhiroWriteReport(Report);
+  Report->Point = WhiroGetPointId(Point);
+  Report->Counter = CallCounter;
+  Report->Pending = 1;
+  pthread_mutex_unlock(&IndexLock);
+}
+
+void WhiroWriteIndex(FILE* OutputFile){
+  (void) OutputFile;
+  if (!IndexOutput || IndexedFile == NULL)
+    return;
+
+  //The last report of every thread, including the threads that already exited, is written before the last block closes
+  pthread_mutex_lock(&IndexLock);
+  for (ThreadReport* Report = Reports; Report != NULL; Report = Report->Next)
+    WhiroWriteReport(Report);
+  WhiroCloseBlock();
+
+  WhiroCheckpointTrailer Trailer;
+  memset(&Trailer, 0, sizeof(WhiroCheckpointTrailer));
+  memcpy(Trailer.Magic, WHIRO_CHECKPOINT_MAGIC, sizeof(Trailer.Magic));
+  Trailer.Version = WHIRO_CHECKPOINT_VERSION;
+  Trailer.QuantPoints = QuantPoints;
+  Trailer.QuantEntries = IndexedEntries;
+  Trailer.QuantBlocks = QuantBlocks;
+  Trailer.LastBlock = LastBlock;
+  WhiroWriteIndexed(&Trailer, sizeof(WhiroCheckpointTrailer));
+
+  //The trailer is written once, even if the program closes the output file again
+  IndexOutput = 0;
+  pthread_mutex_unlock(&IndexLock);
+}
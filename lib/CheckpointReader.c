@@ -0,0 +1,311 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include<stdlib.h>
+#include<string.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include "../include/CheckpointReader.h"
+
+static WhiroCheckpointPoint* WhiroAddCheckpointPoint(WhiroCheckpoint* Checkpoint, char* Name, uint32_t Length){
+  Checkpoint->Points = (WhiroCheckpointPoint*) realloc(Checkpoint->Points, sizeof(WhiroCheckpointPoint) * (Checkpoint->QuantPoints + 1));
+  WhiroCheckpointPoint* Point = &Checkpoint->Points[Checkpoint->QuantPoints];
+  memset(Point, 0, sizeof(WhiroCheckpointPoint));
+  Point->Name = Name;
+  Point->Monotonic = 1;
+
+  //The array of points moves as it grows, so the names are mapped to the index of their point
+  WhiroCheckpointName* Entry = (WhiroCheckpointName*) malloc(sizeof(WhiroCheckpointName));
+  Entry->Name = Name;
+  Entry->Id = Checkpoint->QuantPoints++;
+  HASH_ADD_KEYPTR(hh, Checkpoint->Names, Entry->Name, Length, Entry);
+  return Point;
+}
+
+static void WhiroAddCheckpointSpan(WhiroCheckpointPoint* Point, WhiroCheckpointSpan* Span){
+  if (Point->QuantSpans == Point->SpansCapacity){
+    Point->SpansCapacity = Point->SpansCapacity ? 2 * Point->SpansCapacity : 16;
+    Point->Spans = (WhiroCheckpointSpan*) realloc(Point->Spans, sizeof(WhiroCheckpointSpan) * Point->SpansCapacity);
+  }
+  if (Point->QuantSpans > 0 && Span->Range.MinCounter < Point->Spans[Point->QuantSpans - 1].Range.MaxCounter)
+    Point->Monotonic = 0;
+  Point->Spans[Point->QuantSpans++] = *Span;
+}
+
+/**
+ * This function loads the names and the ranges of the next block of an indexed output file. The
+ * tables of the index are not aligned in the file, so they are copied out of the mapping.
+ * @param Checkpoint is the opened file
+ * @param Position is where the index of the block starts
+ * @param Reports is where the reports of the block must start, or UINT64_MAX if it is not known
+ * @param End receives where the index of the block ends
+ * @return 1 if the block was loaded, or 0 if there is no valid block index at Position
+ */
+static int WhiroLoadCheckpointBlock(WhiroCheckpoint* Checkpoint, uint64_t Position, uint64_t Reports, uint64_t* End){
+  WhiroCheckpointBlock Block;
+  if (Position > Checkpoint->Size || Checkpoint->Size - Position < sizeof(WhiroCheckpointBlock))
+    return 0;
+  memcpy(&Block, Checkpoint->Data + Position, sizeof(WhiroCheckpointBlock));
+  if (memcmp(Block.Magic, WHIRO_CHECKPOINT_BLOCK_MAGIC, sizeof(Block.Magic)) != 0 || Block.Block != Checkpoint->QuantBlocks
+      || Block.FirstPoint != Checkpoint->QuantPoints || Block.Offset > Position || (Reports != UINT64_MAX && Block.Offset != Reports))
+    return 0;
+
+  uint64_t Cursor = Position + sizeof(WhiroCheckpointBlock);
+  for (uint32_t i = 0; i < Block.QuantNames; i++){
+    uint32_t Length;
+    if (Checkpoint->Size - Cursor < sizeof(uint32_t))
+      return 0;
+    memcpy(&Length, Checkpoint->Data + Cursor, sizeof(uint32_t));
+    Cursor += sizeof(uint32_t);
+    if (Checkpoint->Size - Cursor < Length)
+      return 0;
+    WhiroAddCheckpointPoint(Checkpoint, strndup(Checkpoint->Data + Cursor, Length), Length);
+    Cursor += Length;
+  }
+
+  uint64_t Entries = Cursor + (uint64_t) Block.QuantRanges * sizeof(WhiroCheckpointRange);
+  if (Entries > Checkpoint->Size || Checkpoint->Size - Entries < (uint64_t) Block.QuantEntries * sizeof(WhiroCheckpointEntry))
+    return 0;
+  if (Checkpoint->QuantBlocks == Checkpoint->BlocksCapacity){
+    Checkpoint->BlocksCapacity = Checkpoint->BlocksCapacity ? 2 * Checkpoint->BlocksCapacity : 1024;
+    Checkpoint->Blocks = (uint64_t*) realloc(Checkpoint->Blocks, sizeof(uint64_t) * Checkpoint->BlocksCapacity);
+    Checkpoint->Entries = (uint64_t*) realloc(Checkpoint->Entries, sizeof(uint64_t) * Checkpoint->BlocksCapacity);
+  }
+  Checkpoint->Blocks[Checkpoint->QuantBlocks] = Block.Offset;
+  Checkpoint->Entries[Checkpoint->QuantBlocks] = Entries;
+  *End = Entries + (uint64_t) Block.QuantEntries * sizeof(WhiroCheckpointEntry);
+
+  //The entries of a range end where the next range begins
+  WhiroCheckpointRange Range, Next;
+  for (uint32_t i = 0; i < Block.QuantRanges; i++){
+    WhiroCheckpointSpan Span;
+    memcpy(&Range, Checkpoint->Data + Cursor + i * sizeof(WhiroCheckpointRange), sizeof(WhiroCheckpointRange));
+    if (i + 1 < Block.QuantRanges)
+      memcpy(&Next, Checkpoint->Data + Cursor + (i + 1) * sizeof(WhiroCheckpointRange), sizeof(WhiroCheckpointRange));
+    Span.Range = Range;
+    Span.Block = Block.Block;
+    Span.Quant = ((i + 1 < Block.QuantRanges) ? Next.First : Block.QuantEntries) - Range.First;
+    if (Range.Point < Checkpoint->QuantPoints && Range.First <= Block.QuantEntries && Span.Quant <= Block.QuantEntries - Range.First)
+      WhiroAddCheckpointSpan(&Checkpoint->Points[Range.Point], &Span);
+  }
+  Checkpoint->QuantBlocks++;
+  return 1;
+}
+
+static void WhiroForgetCheckpointBlocks(WhiroCheckpoint* Checkpoint){
+  WhiroCheckpointName *Entry, *Next;
+  HASH_ITER(hh, Checkpoint->Names, Entry, Next){
+    HASH_DEL(Checkpoint->Names, Entry);
+    free(Entry);
+  }
+  for (uint32_t i = 0; i < Checkpoint->QuantPoints; i++){
+    free(Checkpoint->Points[i].Name);
+    free(Checkpoint->Points[i].Spans);
+  }
+  Checkpoint->QuantPoints = 0;
+  Checkpoint->QuantBlocks = 0;
+}
+
+/**
+ * This function loads the blocks listed by the trailer of an indexed output file.
+ * @param Checkpoint is the opened file
+ * @param Trailer is the trailer of the file
+ * @return 1 if every block was loaded, or 0 if the index is corrupted
+ */
+static int WhiroLoadCheckpointIndex(WhiroCheckpoint* Checkpoint, WhiroCheckpointTrailer* Trailer){
+  //The index of every block takes at least a WhiroCheckpointBlock, which bounds the blocks a trailer may count
+  if (Trailer->QuantBlocks == 0 || Trailer->QuantBlocks > (Checkpoint->Size - sizeof(WhiroCheckpointTrailer)) / sizeof(WhiroCheckpointBlock))
+    return 0;
+  uint64_t *Positions = (uint64_t*) malloc(sizeof(uint64_t) * Trailer->QuantBlocks);
+  if (Positions == NULL)
+    return 0;
+
+  //The index of each block tells where the index of the previous one is, so the blocks are found from the last one
+  uint64_t Position = Trailer->LastBlock, End = UINT64_MAX;
+  int Loaded = 1;
+  for (uint64_t i = Trailer->QuantBlocks; Loaded && i-- > 0;){
+    WhiroCheckpointBlock Block;
+    Positions[i] = Position;
+    Loaded = Position <= Checkpoint->Size && Checkpoint->Size - Position >= sizeof(WhiroCheckpointBlock);
+    if (Loaded){
+      memcpy(&Block, Checkpoint->Data + Position, sizeof(WhiroCheckpointBlock));
+      Position = Block.Previous;
+    }
+  }
+  for (uint64_t i = 0; Loaded && i < Trailer->QuantBlocks; i++)
+    Loaded = WhiroLoadCheckpointBlock(Checkpoint, Positions[i], End, &End);
+  free(Positions);
+  return Loaded;
+}
+
+WhiroCheckpoint* WhiroOpenCheckpoint(const char* FileName){
+  //Files smaller than a trailer hold no index, not even the index of a block
+  int Descriptor = open(FileName, O_RDONLY);
+  struct stat Status;
+  const char* Data = MAP_FAILED;
+  if (Descriptor >= 0 && fstat(Descriptor, &Status) == 0 && (size_t) Status.st_size >= sizeof(WhiroCheckpointTrailer))
+    Data = (const char*) mmap(NULL, Status.st_size, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+  if (Descriptor >= 0)
+    close(Descriptor);
+  if (Data == MAP_FAILED){
+    printf("Error opening checkpoint file %s\n", FileName);
+    return NULL;
+  }
+
+  WhiroCheckpoint* Checkpoint = (WhiroCheckpoint*) calloc(1, sizeof(WhiroCheckpoint));
+  Checkpoint->Data = Data;
+  Checkpoint->Size = Status.st_size;
+  WhiroCheckpointTrailer Trailer;
+  int Closed = 0;
+  memcpy(&Trailer, Data + Checkpoint->Size - sizeof(WhiroCheckpointTrailer), sizeof(WhiroCheckpointTrailer));
+  if (memcmp(Trailer.Magic, WHIRO_CHECKPOINT_MAGIC, sizeof(Trailer.Magic)) == 0){
+    if (Trailer.Version != WHIRO_CHECKPOINT_VERSION){
+      printf("%s was written by another version of Whiro\n", FileName);
+      WhiroCloseCheckpoint(Checkpoint);
+      return NULL;
+    }
+    if (WhiroLoadCheckpointIndex(Checkpoint, &Trailer))
+      return Checkpoint;
+    printf("The index of %s is corrupted. Its blocks are searched\n", FileName);
+    WhiroForgetCheckpointBlocks(Checkpoint);
+    Closed = 1;
+  }
+
+  //A program that did not close its output file leaves no trailer, but the index of every closed block is there
+  const char* Found;
+  uint64_t Position = 0, End = UINT64_MAX;
+  size_t MagicLength = strlen(WHIRO_CHECKPOINT_BLOCK_MAGIC);
+  while (Position < Checkpoint->Size && (Found = memmem(Data + Position, Checkpoint->Size - Position, WHIRO_CHECKPOINT_BLOCK_MAGIC, MagicLength))){
+    Position = Found - Data;
+    if (WhiroLoadCheckpointBlock(Checkpoint, Position, End, &End))
+      Position = End;
+    else
+      Position++;
+  }
+  if (Checkpoint->QuantBlocks == 0){
+    printf("%s is not an indexed output file\n", FileName);
+    WhiroCloseCheckpoint(Checkpoint);
+    return NULL;
+  }
+  if (!Closed)
+    printf("%s was not closed. ", FileName);
+  printf("Only its first %lu blocks are read\n", Checkpoint->QuantBlocks);
+  return Checkpoint;
+}
+
+void WhiroCloseCheckpoint(WhiroCheckpoint* Checkpoint){
+  WhiroForgetCheckpointBlocks(Checkpoint);
+  free(Checkpoint->Points);
+  free(Checkpoint->Blocks);
+  free(Checkpoint->Entries);
+  munmap((void*) Checkpoint->Data, Checkpoint->Size);
+  free(Checkpoint);
+}
+
+long WhiroFindCheckpointPoint(WhiroCheckpoint* Checkpoint, const char* Point){
+  WhiroCheckpointName* Entry;
+  HASH_FIND_STR(Checkpoint->Names, Point, Entry);
+  return Entry ? (long) Entry->Id : -1;
+}
+
+static void WhiroReadCheckpointEntry(WhiroCheckpoint* Checkpoint, uint64_t Block, uint64_t Index, WhiroCheckpointEntry* Entry){
+  memcpy(Entry, Checkpoint->Data + Checkpoint->Entries[Block] + Index * sizeof(WhiroCheckpointEntry), sizeof(WhiroCheckpointEntry));
+}
+
+static uint64_t WhiroFindCheckpointEntry(WhiroCheckpoint* Checkpoint, WhiroCheckpointSpan* Span, uint64_t Counter){
+  //The entries of a point in a block are sorted by call counter, so this is a lower bound search
+  uint64_t Low = Span->Range.First, High = Span->Range.First + Span->Quant;
+  WhiroCheckpointEntry Entry;
+  while (Low < High){
+    uint64_t Middle = Low + (High - Low) / 2;
+    WhiroReadCheckpointEntry(Checkpoint, Span->Block, Middle, &Entry);
+    if (Entry.Counter < Counter)
+      Low = Middle + 1;
+    else
+      High = Middle;
+  }
+  return Low;
+}
+
+static uint64_t WhiroFirstCheckpointSpan(WhiroCheckpointPoint* Point, uint64_t Counter){
+  //When the call counters of the point grow along the file, the first block that may hold the counter is binary
+  //searched. Otherwise, as with points reported by many threads, every block of the point is looked at
+  uint64_t Low = 0, High = Point->QuantSpans;
+  while (Point->Monotonic && Low < High){
+    uint64_t Middle = Low + (High - Low) / 2;
+    if (Point->Spans[Middle].Range.MaxCounter < Counter)
+      Low = Middle + 1;
+    else
+      High = Middle;
+  }
+  return Low;
+}
+
+static int WhiroIsValidReport(WhiroCheckpoint* Checkpoint, WhiroCheckpointEntry* Entry){
+  return Entry->Block < Checkpoint->QuantBlocks && Checkpoint->Blocks[Entry->Block] + Entry->Start + Entry->Length <= Checkpoint->Size;
+}
+
+int WhiroFindCheckpointReport(WhiroCheckpoint* Checkpoint, long Id, uint64_t Counter, WhiroCheckpointEntry* Entry){
+  WhiroCheckpointPoint* Point = &Checkpoint->Points[Id];
+  for (uint64_t i = WhiroFirstCheckpointSpan(Point, Counter); i < Point->QuantSpans; i++){
+    WhiroCheckpointSpan* Span = &Point->Spans[i];
+    if (Point->Monotonic && Span->Range.MinCounter > Counter)
+      break;
+    if (Span->Range.MinCounter > Counter || Span->Range.MaxCounter < Counter)
+      continue;
+    uint64_t First = WhiroFindCheckpointEntry(Checkpoint, Span, Counter);
+    if (First == Span->Range.First + Span->Quant)
+      continue;
+    WhiroReadCheckpointEntry(Checkpoint, Span->Block, First, Entry);
+    if (Entry->Counter == Counter)
+      return WhiroIsValidReport(Checkpoint, Entry);
+  }
+  return 0;
+}
+
+long WhiroPrintCheckpoint(WhiroCheckpoint* Checkpoint, const char* Point, uint64_t Counter, FILE* Output){
+  long Id = WhiroFindCheckpointPoint(Checkpoint, Point);
+  if (Id < 0)
+    return 0;
+
+  long Reports = 0;
+  WhiroCheckpointEntry Entry;
+  WhiroCheckpointPoint* Indexed = &Checkpoint->Points[Id];
+  for (uint64_t i = WhiroFirstCheckpointSpan(Indexed, Counter); i < Indexed->QuantSpans; i++){
+    WhiroCheckpointSpan* Span = &Indexed->Spans[i];
+    if (Indexed->Monotonic && Span->Range.MinCounter > Counter)
+      break;
+    if (Span->Range.MinCounter > Counter || Span->Range.MaxCounter < Counter)
+      continue;
+    uint64_t End = Span->Range.First + Span->Quant;
+    for (uint64_t j = WhiroFindCheckpointEntry(Checkpoint, Span, Counter); j < End; j++){
+      WhiroReadCheckpointEntry(Checkpoint, Span->Block, j, &Entry);
+      if (Entry.Counter != Counter)
+        break;
+      if (!WhiroIsValidReport(Checkpoint, &Entry))
+        continue;
+      fwrite(Checkpoint->Data + Checkpoint->Blocks[Entry.Block] + Entry.Start, 1, Entry.Length, Output);
+      Reports++;
+    }
+  }
+  return Reports;
+}
+
+void WhiroListCheckpoint(WhiroCheckpoint* Checkpoint, FILE* Output){
+  for (uint32_t i = 0; i < Checkpoint->QuantPoints; i++){
+    WhiroCheckpointPoint* Point = &Checkpoint->Points[i];
+    if (Point->QuantSpans == 0)
+      continue;
+    uint64_t Reports = 0, First = UINT64_MAX, Last = 0;
+    for (uint64_t j = 0; j < Point->QuantSpans; j++){
+      Reports += Point->Spans[j].Quant;
+      if (Point->Spans[j].Range.MinCounter < First)
+        First = Point->Spans[j].Range.MinCounter;
+      if (Point->Spans[j].Range.MaxCounter > Last)
+        Last = Point->Spans[j].Range.MaxCounter;
+    }
+    fprintf(Output, "%s %lu [%lu, %lu]\n", Point->Name, Reports, First, Last);
+  }
+}
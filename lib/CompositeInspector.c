@@ -4,137 +4,309 @@ extern TypeDescriptor * TypeTable;
 extern HeapEntry * HeapTable;
 //Usage mode settings
 int MemFilter, InsHeap, InsStack, Precise;
+extern int HashHeap;
 
 //Executable and Linkable Format (ELF) program segments
 extern char etext, edata, end;
 
-void WhiroInspectData(FILE *OutputFile, void *Data, TypeDescriptor *DataType, char *Name, char *FuncName, int CallCounter){
-  char *DataNameFull = NULL;
-  for (int i = 0; i < DataType->QuantFields; i++){
-    //We use the DataNameFull to append the names of the data while reporting
-    DataNameFull = (char*) malloc(strlen(Name) + strlen(DataType->Fields[i].Name) + 2);
-    strcpy(DataNameFull, Name);
-    if (DataType->Fields[i].Name[0] != '\0')
-      strcat(DataNameFull, "-");
-    strcat(DataNameFull, DataType->Fields[i].Name);
-
-    switch (DataType->Fields[i].Format){
-      case 1:
-        fprintf(OutputFile, "%s %s %d : %.2lf\n", DataNameFull, FuncName, CallCounter, *(double*)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 2:
-        fprintf(OutputFile, "%s %s %d : %.2f\n", DataNameFull, FuncName, CallCounter, *(float*)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 3:
-        fprintf(OutputFile, "%s %s %d : %hi\n", DataNameFull, FuncName, CallCounter, *(short*)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 4:
-        fprintf(OutputFile, "%s %s %d : %ld\n", DataNameFull, FuncName, CallCounter, *(long*)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 5:
-        fprintf(OutputFile, "%s %s %d : %lld\n", DataNameFull, FuncName, CallCounter, *(long long *)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 6:
-        fprintf(OutputFile, "%s %s %d : %d\n", DataNameFull, FuncName, CallCounter, *(int*)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 7:
-       	//We check if the character is printable. If it is not, we print is as '@'.
-       	//That is the same approach Linux does when printing binary files
-        if (isprint(*(char*)(Data + DataType->Fields[i].Offset)))
-          fprintf(OutputFile, "%s %s %d : %c\n", DataNameFull, FuncName, CallCounter, *(char*)(Data + DataType->Fields[i].Offset));
-        else
-          fprintf(OutputFile, "%s %s %d : @\n", DataNameFull, FuncName, CallCounter);
-        break;
-
-      case 8:
-       	//We check if the character is printable. If it is not, we print is as '@'.
-       	//That is the same approach Linux does when printing binary files
-        if (isprint(*(unsigned char *)(Data + DataType->Fields[i].Offset)))
-          fprintf(OutputFile, "%s %s %d : %u\n", DataNameFull, FuncName, CallCounter, *(unsigned char *)(Data + DataType->Fields[i].Offset));
-        else
-          fprintf(OutputFile, "%s %s %d : @\n", DataNameFull, FuncName, CallCounter);
-        break;
-
-      case 9:
-        fprintf(OutputFile, "%s %s %d : %hu\n", DataNameFull, FuncName, CallCounter, *(unsigned short *)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 10:
-        fprintf(OutputFile, "%s %s %d : %lu\n", DataNameFull, FuncName, CallCounter, *(unsigned long *)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 11:
-        fprintf(OutputFile, "%s %s %d : %llu\n", DataNameFull, FuncName, CallCounter, *(unsigned long long *)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 12:
-        fprintf(OutputFile, "%s %s %d : %u\n", DataNameFull, FuncName, CallCounter, *(unsigned int *)(Data + DataType->Fields[i].Offset));
-        break;
-
-      case 13:{
-        if (Precise){
-          void **Next = (Data + DataType->Fields[i].Offset);
-          WhiroTrackPointer(OutputFile, *Next, DataType->Fields[i].BaseTypeIndex, DataNameFull, FuncName, CallCounter);
-        }
-        else
-          fprintf(OutputFile, "%s %s %d : pointer to %s\n", Name, FuncName, CallCounter, TypeTable[DataType->Fields[i].BaseTypeIndex].Name);
-          break;
-        }
-
-      case 14:
-        fprintf(OutputFile, "%s %s %d : void\n", DataNameFull, FuncName, CallCounter);
-        break;
-
-      case 15:{
-        TypeDescriptor ElementType = TypeTable[DataType->Fields[i].BaseTypeIndex];
-        int Hashcode = WhiroComputeHashcode((Data + DataType->Fields[i].Offset), ElementType.Fields[0].Offset, ElementType.Fields[0].Offset, ElementType.Fields[0].Format);
-        fprintf(OutputFile, "%s %s %d : %d\n", DataNameFull, FuncName, CallCounter, Hashcode);
-        break;
-      }
+//Work-list used to traverse the memory graph without recursion. It grows on demand and is reused by every
+//inspection point, so the traversal does not allocate memory per visited node. Each thread has its own, so
+//the heap can be inspected by many threads at once
+static __thread InspectionFrame *WorkList = NULL;
+static __thread size_t WorkListSize = 0, WorkListCapacity = 0;
+
+//Name of the data currently being reported. Each frame in the work-list stores the length of its own name,
+//which is always a prefix of the names of the frames above it
+static __thread char *NameBuffer = NULL;
+static __thread size_t NameCapacity = 0;
+
+//Mode of the inspections made by this thread. Threads that inspect data on behalf of the program set their own
+//mode, so they never change the mode seen by the other threads
+static __thread int ThreadMode = WHIRO_MODE_PROGRAM;
+
+int WhiroSetThreadMode(int Mode){
+  int Previous = ThreadMode;
+  ThreadMode = Mode;
+  return Previous;
+}
+
+int WhiroIsPrecise(){
+  return (ThreadMode == WHIRO_MODE_PROGRAM) ? Precise : ThreadMode;
+}
+
+void WhiroReleaseInspectionBuffers(){
+  free(WorkList);
+  free(NameBuffer);
+  WorkList = NULL;
+  NameBuffer = NULL;
+  WorkListSize = WorkListCapacity = NameCapacity = 0;
+  WhiroReleaseLineBuffer();
+}
+
+static void WhiroReserveName(size_t Length){
+  if (Length + 1 <= NameCapacity)
+    return;
+
+  size_t NewCapacity = NameCapacity ? NameCapacity : 4096;
+  while (NewCapacity < Length + 1)
+    NewCapacity *= 2;
+  NameBuffer = (char*) realloc(NameBuffer, NewCapacity);
+  NameCapacity = NewCapacity;
+}
+
+char* WhiroInspectionName(size_t Length){
+  WhiroReserveName(Length);
+  NameBuffer[Length] = '\0';
+  return NameBuffer;
+}
+
+size_t WhiroSetInspectionName(const char *Name){
+  size_t Length = strlen(Name);
+  WhiroReserveName(Length);
+  memcpy(NameBuffer, Name, Length + 1);
+  return Length;
+}
+
+size_t WhiroAppendInspectionName(size_t Length, const char *FieldName){
+  //Fields without a name (e.g., the single field of a scalar type) are reported with the name of their parent
+  if (FieldName[0] == '\0')
+    return Length;
+
+  size_t FieldLength = strlen(FieldName);
+  WhiroReserveName(Length + FieldLength + 1);
+  NameBuffer[Length] = '-';
+  memcpy(NameBuffer + Length + 1, FieldName, FieldLength + 1);
+  return Length + FieldLength + 1;
+}
+
+size_t WhiroAppendInspectionIndex(size_t Length, size_t Index){
+  //An index of 64 bits has at most 20 digits, plus the brackets
+  WhiroReserveName(Length + 23);
+  return Length + snprintf(NameBuffer + Length, 23, "[%zu]", Index);
+}
+
+void WhiroPushFrame(void *Data, TypeDescriptor *Type, size_t Count, size_t NameLength, int Kind){
+  if (WorkListSize == WorkListCapacity){
+    WorkListCapacity = WorkListCapacity ? WorkListCapacity * 2 : 1024;
+    WorkList = (InspectionFrame*) realloc(WorkList, sizeof(InspectionFrame) * WorkListCapacity);
+  }
+
+  InspectionFrame *Frame = &WorkList[WorkListSize++];
+  Frame->Data = Data;
+  Frame->Type = Type;
+  Frame->Next = 0;
+  Frame->Count = Count;
+  Frame->Stride = 0;
+  Frame->NameLength = NameLength;
+  Frame->Kind = Kind;
+}
+
+void WhiroPushArrayFrame(void *Data, TypeDescriptor *ElementType, size_t Count, size_t Stride, size_t NameLength){
+  if (Count == 0)
+    return;
+
+  //Arrays of pointers keep their own kind of frame, which is shared with the Fast mode
+  if (ElementType->QuantFields == 1 && ElementType->Fields[0].Format == 13){
+    WhiroPushFrame(Data, ElementType, Count, NameLength, WHIRO_FRAME_POINTERS);
+    return;
+  }
+
+  WhiroPushFrame(Data, ElementType, Count, NameLength, WHIRO_FRAME_ELEMENTS);
+  WorkList[WorkListSize - 1].Stride = Stride;
+}
+
+static void WhiroInspectField(FILE *OutputFile, void *Data, Field *DataField, size_t NameLength, char *FuncName, long CallCounter){
+  //The full name of the field is appended to the name of its parent while reporting
+  size_t FullNameLength = WhiroAppendInspectionName(NameLength, DataField->Name);
+  char *DataNameFull = WhiroInspectionName(FullNameLength);
+
+  switch (DataField->Format){
+    case 1:
+      WhiroReportF64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(double*)(Data + DataField->Offset));
+      break;
+
+    case 2:
+      WhiroReportF64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(float*)(Data + DataField->Offset));
+      break;
 
-      case 16:
-        WhiroInspectUnion(OutputFile, (char*) Data, DataType->Fields[i].Offset, Name, FuncName, CallCounter);
-        break;
+    case 3:
+      WhiroReportI64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(short*)(Data + DataField->Offset));
+      break;
 
-      case 17:{
-        TypeDescriptor StructType = TypeTable[DataType->Fields[i].BaseTypeIndex];
-        WhiroInspectData(OutputFile, (Data + DataType->Fields[i].Offset), &StructType, Name, FuncName, CallCounter);
-        break;
+    case 4:
+      WhiroReportI64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(long*)(Data + DataField->Offset));
+      break;
+
+    case 5:
+      WhiroReportI64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(long long *)(Data + DataField->Offset));
+      break;
+
+    case 6:
+      WhiroReportI64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(int*)(Data + DataField->Offset));
+      break;
+
+    case 7:
+     	//We check if the character is printable. If it is not, we print is as '@'.
+     	//That is the same approach Linux does when printing binary files
+      if (isprint(*(char*)(Data + DataField->Offset)))
+        WhiroReportChar(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(char*)(Data + DataField->Offset));
+      else
+        WhiroReportChar(OutputFile, DataNameFull, FuncName, CallCounter, " : ", '@');
+      break;
+
+    case 8:
+     	//We check if the character is printable. If it is not, we print is as '@'.
+     	//That is the same approach Linux does when printing binary files
+      if (isprint(*(unsigned char *)(Data + DataField->Offset)))
+        WhiroReportU64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(unsigned char *)(Data + DataField->Offset));
+      else
+        WhiroReportChar(OutputFile, DataNameFull, FuncName, CallCounter, " : ", '@');
+      break;
+
+    case 9:
+      WhiroReportU64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(unsigned short *)(Data + DataField->Offset));
+      break;
+
+    case 10:
+      WhiroReportU64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(unsigned long *)(Data + DataField->Offset));
+      break;
+
+    case 11:
+      WhiroReportU64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(unsigned long long *)(Data + DataField->Offset));
+      break;
+
+    case 12:
+      WhiroReportU64(OutputFile, DataNameFull, FuncName, CallCounter, " : ", *(unsigned int *)(Data + DataField->Offset));
+      break;
+
+    case 13:{
+      if (WhiroIsPrecise()){
+        //The pointed data is scheduled in the work-list instead of being inspected recursively
+        void **Next = (Data + DataField->Offset);
+        WhiroVisitPointer(OutputFile, *Next, DataField->BaseTypeIndex, FullNameLength, FuncName, CallCounter);
       }
+      else
+        WhiroProfiledPrintf(OutputFile, "%s %s %ld : pointer to %s\n", WhiroInspectionName(NameLength), FuncName, CallCounter, TypeTable[DataField->BaseTypeIndex].Name);
+      break;
+    }
+
+    case 14:
+      WhiroProfiledPrintf(OutputFile, "%s %s %ld : void\n", DataNameFull, FuncName, CallCounter);
+      break;
+
+    case 15:{
+      //The descriptor of the array holds its number of elements, and the index of the descriptor of its elements
+      Field *ArrayField = &TypeTable[DataField->BaseTypeIndex].Fields[0];
+      int ElementFormat = TypeTable[ArrayField->BaseTypeIndex].Fields[0].Format;
+      if (WhiroIsScalarType(ElementFormat))
+        WhiroReportArrayHashcode(OutputFile, DataNameFull, FuncName, CallCounter, " : ", Data + DataField->Offset, ArrayField->Offset, ArrayField->Offset, ElementFormat);
+      else
+        WhiroProfiledPrintf(OutputFile, "%s %s %ld : non-inspectable value\n", DataNameFull, FuncName, CallCounter);
+      break;
+    }
+
+    case 16:
+      //The size of a union is kept in the base type index of its field
+      WhiroInspectUnion(OutputFile, (char*)(Data + DataField->Offset), DataField->BaseTypeIndex, DataNameFull, FuncName, CallCounter);
+      break;
 
-      case 18:
-        fprintf(OutputFile, "%s %s %d : non-inspectable value\n", DataNameFull, FuncName, CallCounter);
-        break;
+    case 17:
+      WhiroPushFrame((Data + DataField->Offset), &TypeTable[DataField->BaseTypeIndex], 0, NameLength, WHIRO_FRAME_FIELDS);
+      break;
+
+    case 18:
+      //Values whose raw bytes can be compared across runs have their size in the base type index
+      if (DataField->BaseTypeIndex > 0)
+        WhiroReportBytes(OutputFile, DataNameFull, FuncName, CallCounter, " : ", Data + DataField->Offset, DataField->BaseTypeIndex);
+      else
+        WhiroProfiledPrintf(OutputFile, "%s %s %ld : non-inspectable value\n", DataNameFull, FuncName, CallCounter);
+      break;
+
+    default:
+      printf("Unkown Format %d (Inspect Data)\n", DataField->Format);
+      break;
+  }
+}
 
-      default:
-        printf("Unkown Format %d (Inspect Data)\n", DataType->Fields[i].Format);
-        break;
+int WhiroNextWorkItem(InspectionFrame *Current, size_t *Index){
+  while (WorkListSize > 0){
+    InspectionFrame *Frame = &WorkList[WorkListSize - 1];
+    size_t Next = Frame->Next++;
+    size_t Count = (Frame->Kind == WHIRO_FRAME_FIELDS) ? (size_t) Frame->Type->QuantFields : Frame->Count;
+    if (Next >= Count){
+      WorkListSize--;
+      continue;
     }
 
-    free(DataNameFull);
-    DataNameFull = NULL;
+    //Copy the frame before visiting the element, since visiting might push new frames and move the work-list.
+    //If this is the last element of the frame, we pop it right away, so long chains of pointers (e.g., linked
+    //lists) use a constant number of frames
+    *Current = *Frame;
+    *Index = Next;
+    if (Next + 1 == Count)
+      WorkListSize--;
+    return 1;
   }
+  return 0;
 }
 
-void WhiroInspectPointer(FILE *OutputFile, void *Ptr, int TypeIndex, char *Name, char *FuncName, int CallCounter){
-  if (Precise){
+void WhiroTraverseWorkList(FILE *OutputFile, char *FuncName, long CallCounter){
+  InspectionFrame Current;
+  size_t Index;
+  while (WhiroNextWorkItem(&Current, &Index)){
+    if (Current.Kind == WHIRO_FRAME_FIELDS)
+      WhiroInspectField(OutputFile, Current.Data, &Current.Type->Fields[Index], Current.NameLength, FuncName, CallCounter);
+    else if (Current.Kind == WHIRO_FRAME_ELEMENTS){
+      //Every element is inspected with the type descriptor of the elements, named after its index. Its frame
+      //is above the frame of the array, so it is reported entirely before the next element
+      size_t ElementNameLength = WhiroAppendInspectionIndex(Current.NameLength, Index);
+      WhiroPushFrame(Current.Data + Index * Current.Stride, Current.Type, 0, ElementNameLength, WHIRO_FRAME_FIELDS);
+    }
+    else{
+      //Every element of an array of pointers is reported as a pointer, named after its index
+      size_t ElementNameLength = WhiroAppendInspectionIndex(Current.NameLength, Index);
+      int BaseTypeIndex = Current.Type->Fields[0].BaseTypeIndex;
+      void *Element = ((void**) Current.Data)[Index];
+      if (WhiroIsPrecise())
+        WhiroVisitPointer(OutputFile, Element, BaseTypeIndex, ElementNameLength, FuncName, CallCounter);
+      else
+        WhiroProfiledPrintf(OutputFile, "%s %s %ld : pointer to %s\n", WhiroInspectionName(ElementNameLength), FuncName, CallCounter, TypeTable[BaseTypeIndex].Name);
+    }
+  }
+}
+
+void WhiroInspectData(FILE *OutputFile, void *Data, TypeDescriptor *DataType, char *Name, char *FuncName, long CallCounter){
+  WHIRO_PROFILE_BEGIN(INSPECT_DATA);
+  WhiroPushFrame(Data, DataType, 0, WhiroSetInspectionName(Name), WHIRO_FRAME_FIELDS);
+  WhiroTraverseWorkList(OutputFile, FuncName, CallCounter);
+  WHIRO_PROFILE_END(INSPECT_DATA);
+}
+
+void WhiroInspectPointer(FILE *OutputFile, void *Ptr, int TypeIndex, char *Name, char *FuncName, long CallCounter){
+  if (WhiroIsPrecise()){
+    if (HashHeap){
+      WhiroReportPointerHash(OutputFile, Ptr, TypeIndex, Name, FuncName, CallCounter);
+      return;
+    }
+
     WhiroTrackPointer(OutputFile, Ptr, TypeIndex, Name, FuncName, CallCounter);
    	//After we traverse the table, set all of its nodes as unvisited.
     WhiroSetAllHeapUnivisited();
     return;
   }
   else{
-    fprintf(OutputFile, "%s %s %d : pointer to %s\n", Name, FuncName, CallCounter, TypeTable[TypeIndex].Name);
+    WhiroProfiledPrintf(OutputFile, "%s %s %ld : pointer to %s\n", Name, FuncName, CallCounter, TypeTable[TypeIndex].Name);
   }
 }
 
-void WhiroTrackPointer(FILE *OutputFile, void *Ptr, int TypeIndex, char *Name, char *FuncName, int CallCounter){
+void WhiroTrackPointer(FILE *OutputFile, void *Ptr, int TypeIndex, char *Name, char *FuncName, long CallCounter){
+  WHIRO_PROFILE_BEGIN(TRACK_POINTER);
+  WhiroVisitPointer(OutputFile, Ptr, TypeIndex, WhiroSetInspectionName(Name), FuncName, CallCounter);
+  WhiroTraverseWorkList(OutputFile, FuncName, CallCounter);
+  WHIRO_PROFILE_END(TRACK_POINTER);
+}
+
+void WhiroVisitPointer(FILE *OutputFile, void *Ptr, int TypeIndex, size_t NameLength, char *FuncName, long CallCounter){
   HeapEntry * Entry;
   HASH_FIND(hh, HeapTable, &Ptr, sizeof(void*), Entry);
   //If this pointer is pointing to the heap, we inspect if the user chose to inspect the heap
@@ -142,7 +314,7 @@ void WhiroTrackPointer(FILE *OutputFile, void *Ptr, int TypeIndex, char *Name, c
     if (MemFilter && !InsHeap)
       return;
 
-    WhiroInspectHeapData(OutputFile, Entry, Name, FuncName, CallCounter, 1);
+    WhiroVisitHeapData(OutputFile, Entry, NameLength, FuncName, CallCounter);
   }
   else if (Ptr){
     //If this pointer is not null and is not pointing to a heap address, then we assume it is pointing to the stack
@@ -155,21 +327,36 @@ void WhiroTrackPointer(FILE *OutputFile, void *Ptr, int TypeIndex, char *Name, c
     if ((char*) Ptr<&etext)
       return;
 
-    WhiroInspectData(OutputFile, Ptr, &TypeTable[TypeIndex], Name, FuncName, CallCounter);
+    WhiroPushFrame(Ptr, &TypeTable[TypeIndex], 0, NameLength, WHIRO_FRAME_FIELDS);
   }
   else
     //Print the pointer as NULL if it is equal to zero
-    fprintf(OutputFile, "%s %s %d : NULL\n", Name, FuncName, CallCounter);
+    WhiroProfiledPrintf(OutputFile, "%s %s %ld : NULL\n", WhiroInspectionName(NameLength), FuncName, CallCounter);
+}
+
+void WhiroInspectUnion(FILE *OutputFile, char *Union, size_t Size, char *Name, char *FuncName, long CallCounter){
+  WhiroReportBytes(OutputFile, Name, FuncName, CallCounter, " : ", Union, Size);
 }
 
-void WhiroInspectUnion(FILE *OutputFile, char *Union, size_t Size, char *Name, char *FuncName, int CallCounter){
-  fprintf(OutputFile, "%s %s %d : ", Name, FuncName, CallCounter);
-  for (size_t i = 0; i < Size; i++){
-    fprintf(OutputFile, "%d", (int) Union[i]);
+void WhiroInspectArrayOfData(FILE *OutputFile, void *Array, size_t Count, size_t ElementSize, int TypeIndex, char *Name, char *FuncName, long CallCounter){
+  //With heap hashing, the whole array is reported as one hashcode instead of one line per field of every element
+  if (HashHeap){
+    WhiroReportArrayHash(OutputFile, Array, Count, ElementSize, TypeIndex, Name, FuncName, CallCounter);
+    return;
   }
-  fprintf(OutputFile, "\n");
+
+  WhiroInspectArrayElements(OutputFile, Array, Count, ElementSize, TypeIndex, Name, FuncName, CallCounter);
+}
+
+void WhiroInspectArrayElements(FILE *OutputFile, void *Array, size_t Count, size_t ElementSize, int TypeIndex, char *Name, char *FuncName, long CallCounter){
+  WHIRO_PROFILE_BEGIN(INSPECT_DATA);
+  WhiroPushArrayFrame(Array, &TypeTable[TypeIndex], Count, ElementSize, WhiroSetInspectionName(Name));
+  WhiroTraverseWorkList(OutputFile, FuncName, CallCounter);
+  //Pointers in the elements might have visited heap blocks, which are reported again by the next inspection point
+  WhiroSetAllHeapUnivisited();
+  WHIRO_PROFILE_END(INSPECT_DATA);
 }
 
-void WhiroInspectStruct(FILE *OutputFile, void *Struct, int TypeIndex, char *Name, char *FuncName, int CallCounter){
+void WhiroInspectStruct(FILE *OutputFile, void *Struct, int TypeIndex, char *Name, char *FuncName, long CallCounter){
   WhiroInspectData(OutputFile, Struct, &TypeTable[TypeIndex], Name, FuncName, CallCounter);
 }
@@ -0,0 +1,196 @@
+#include "../include/Whiro.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//Values of 2^52 or more are formatted by the C library. The largest double has 309 integer digits
+#define WHIRO_MAX_VALUE_LENGTH 320
+
+//Pairs of decimal digits, so integers are converted two digits at a time
+static const char DigitPairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+//Hexadecimal digits, indexed by the value of a nibble
+static const char HexDigits[17] = "0123456789abcdef";
+
+//Usage mode setting. If it is set, raw bytes are printed as signed decimals, as older versions of Whiro did
+int DecimalBytes = 0;
+
+//Each thread builds its lines in a buffer of its own, which grows on demand and is written to the output file at once
+static __thread char *LineBuffer = NULL;
+static __thread size_t LineCapacity = 0;
+
+void WhiroReleaseLineBuffer(){
+  free(LineBuffer);
+  LineBuffer = NULL;
+  LineCapacity = 0;
+}
+
+static size_t WhiroFormatUnsigned(char *Buffer, uint64_t Value){
+  //The digits are produced from the last one, in a scratch buffer as long as the largest integer
+  char Digits[20];
+  char *End = Digits + 20, *Digit = End;
+  while (Value >= 100){
+    Digit -= 2;
+    memcpy(Digit, DigitPairs + (Value % 100) * 2, 2);
+    Value /= 100;
+  }
+  if (Value >= 10){
+    Digit -= 2;
+    memcpy(Digit, DigitPairs + Value * 2, 2);
+  }
+  else
+    *--Digit = (char)('0' + Value);
+
+  size_t Length = End - Digit;
+  memcpy(Buffer, Digit, Length);
+  return Length;
+}
+
+static size_t WhiroFormatSigned(char *Buffer, int64_t Value){
+  if (Value < 0){
+    Buffer[0] = '-';
+    return 1 + WhiroFormatUnsigned(Buffer + 1, 0 - (uint64_t) Value);
+  }
+  return WhiroFormatUnsigned(Buffer, (uint64_t) Value);
+}
+
+static size_t WhiroFormatFixed(char *Buffer, double Value){
+  uint64_t Bits;
+  memcpy(&Bits, &Value, sizeof(double));
+  int Exponent = (int)((Bits >> 52) & 0x7FF);
+  uint64_t Mantissa = Bits & ((1ULL << 52) - 1);
+  //Infinities, NaNs and values of 2^52 or more are rare, so they are left to the C library
+  if (Exponent >= 1075)
+    return snprintf(Buffer, WHIRO_MAX_VALUE_LENGTH, "%.2f", Value);
+
+  //The value is Mantissa * 2^-Shift. Its hundredths are computed exactly, and they are rounded to the
+  //nearest with ties to even, as the C library rounds the exact binary value
+  size_t Length = 0;
+  if (Bits >> 63)
+    Buffer[Length++] = '-';
+  if (Exponent > 0)
+    Mantissa |= 1ULL << 52;
+  int Shift = 1075 - (Exponent > 0 ? Exponent : 1);
+  uint64_t Scaled = Mantissa * 100;
+  uint64_t Hundredths = 0;
+  //With a shift of 64 or more, the value is below 2^-11 and it rounds to zero
+  if (Shift < 64){
+    uint64_t Rest = Scaled & ((1ULL << Shift) - 1), Half = 1ULL << (Shift - 1);
+    Hundredths = Scaled >> Shift;
+    if (Rest > Half || (Rest == Half && (Hundredths & 1)))
+      Hundredths++;
+  }
+
+  Length += WhiroFormatUnsigned(Buffer + Length, Hundredths / 100);
+  Buffer[Length++] = '.';
+  memcpy(Buffer + Length, DigitPairs + (Hundredths % 100) * 2, 2);
+  return Length + 2;
+}
+
+static size_t WhiroFormatHex(char *Buffer, const unsigned char *Bytes, size_t Size){
+  size_t i = 0;
+#if defined(__SSE2__)
+  //Sixteen bytes are encoded at once. Each nibble becomes '0' plus its value, and the nibbles above 9 are
+  //moved from the characters after '9' to 'a'. SSE2 has no byte shuffle to look the digits up in HexDigits,
+  //so the gap is added with a compare, which every x86-64 processor supports
+  const __m128i Mask = _mm_set1_epi8(0x0F), Nine = _mm_set1_epi8(9);
+  const __m128i Zero = _mm_set1_epi8('0'), Gap = _mm_set1_epi8('a' - '9' - 1);
+  for (; i + 16 <= Size; i += 16){
+    __m128i Data = _mm_loadu_si128((const __m128i*)(Bytes + i));
+    __m128i High = _mm_and_si128(_mm_srli_epi16(Data, 4), Mask);
+    __m128i Low = _mm_and_si128(Data, Mask);
+    High = _mm_add_epi8(_mm_add_epi8(High, Zero), _mm_and_si128(_mm_cmpgt_epi8(High, Nine), Gap));
+    Low = _mm_add_epi8(_mm_add_epi8(Low, Zero), _mm_and_si128(_mm_cmpgt_epi8(Low, Nine), Gap));
+    _mm_storeu_si128((__m128i*)(Buffer + 2 * i), _mm_unpacklo_epi8(High, Low));
+    _mm_storeu_si128((__m128i*)(Buffer + 2 * i + 16), _mm_unpackhi_epi8(High, Low));
+  }
+#endif
+  for (; i < Size; i++){
+    Buffer[2 * i] = HexDigits[Bytes[i] >> 4];
+    Buffer[2 * i + 1] = HexDigits[Bytes[i] & 0x0F];
+  }
+  return 2 * Size;
+}
+
+static size_t WhiroFormatDecimalBytes(char *Buffer, const unsigned char *Bytes, size_t Size){
+  //Every byte is printed as a char, without separators, as "%d" printed them
+  size_t Length = 0;
+  for (size_t i = 0; i < Size; i++)
+    Length += WhiroFormatSigned(Buffer + Length, (char) Bytes[i]);
+  return Length;
+}
+
+static char* WhiroBeginLine(const char *Name, const char *Scope, long CallCounter, const char *Tag, size_t ValueLength){
+  size_t NameLength = strlen(Name), ScopeLength = strlen(Scope), TagLength = strlen(Tag);
+  //Two spaces, the call counter, the value and the line break
+  size_t Length = NameLength + ScopeLength + TagLength + 24 + ValueLength;
+  if (Length > LineCapacity){
+    LineCapacity = LineCapacity ? LineCapacity : 1024;
+    while (LineCapacity < Length)
+      LineCapacity *= 2;
+    LineBuffer = (char*) realloc(LineBuffer, LineCapacity);
+  }
+
+  char *Line = LineBuffer;
+  memcpy(Line, Name, NameLength);
+  Line += NameLength;
+  *Line++ = ' ';
+  memcpy(Line, Scope, ScopeLength);
+  Line += ScopeLength;
+  *Line++ = ' ';
+  Line += WhiroFormatSigned(Line, CallCounter);
+  memcpy(Line, Tag, TagLength);
+  return Line + TagLength;
+}
+
+static void WhiroEndLine(FILE *OutputFile, char *End){
+  *End++ = '\n';
+  WhiroProfiledWrite(LineBuffer, sizeof(char), End - LineBuffer, OutputFile);
+}
+
+void WhiroReportI64(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, int64_t Value){
+  char *Line = WhiroBeginLine(Name, Scope, CallCounter, Tag, WHIRO_MAX_VALUE_LENGTH);
+  WhiroEndLine(OutputFile, Line + WhiroFormatSigned(Line, Value));
+}
+
+void WhiroReportU64(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, uint64_t Value){
+  char *Line = WhiroBeginLine(Name, Scope, CallCounter, Tag, WHIRO_MAX_VALUE_LENGTH);
+  WhiroEndLine(OutputFile, Line + WhiroFormatUnsigned(Line, Value));
+}
+
+void WhiroReportF64(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, double Value){
+  char *Line = WhiroBeginLine(Name, Scope, CallCounter, Tag, WHIRO_MAX_VALUE_LENGTH);
+  WhiroEndLine(OutputFile, Line + WhiroFormatFixed(Line, Value));
+}
+
+void WhiroReportChar(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, char Value){
+  char *Line = WhiroBeginLine(Name, Scope, CallCounter, Tag, WHIRO_MAX_VALUE_LENGTH);
+  *Line = Value;
+  WhiroEndLine(OutputFile, Line + 1);
+}
+
+void WhiroSetDecimalBytes(){
+  DecimalBytes = 1;
+}
+
+void WhiroReportBytes(FILE* OutputFile, const char* Name, const char* Scope, long CallCounter, const char* Tag, const void* Bytes, size_t Size){
+  //A byte takes two hexadecimal digits, or up to four characters as a decimal (e.g., "-128")
+  if (DecimalBytes){
+    char *Line = WhiroBeginLine(Name, Scope, CallCounter, Tag, 4 * Size);
+    WhiroEndLine(OutputFile, Line + WhiroFormatDecimalBytes(Line, (const unsigned char*) Bytes, Size));
+    return;
+  }
+
+  char *Line = WhiroBeginLine(Name, Scope, CallCounter, Tag, 2 * Size);
+  WhiroEndLine(OutputFile, Line + WhiroFormatHex(Line, (const unsigned char*) Bytes, Size));
+}
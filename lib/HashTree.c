@@ -0,0 +1,162 @@
+#include "../include/Whiro.h"
+#include<pthread.h>
+
+//Usage mode settings. If TreeThreshold is greater than zero, arrays of at least that many elements are hashed
+//as trees of chunks of TreeChunk elements, and the leaves of very large arrays are hashed by TreeWorkers threads
+size_t TreeThreshold = 0, TreeChunk = WHIRO_TREE_CHUNK;
+int TreeWorkers = 0;
+
+//The trees of the reported arrays are written to this file, if the user chooses to. Workers of the heap may
+//report arrays at the same time, so each record is written at once
+static FILE *TreeFile = NULL;
+static pthread_mutex_t TreeFileLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * This structure describes the hashing of the leaves of a tree, shared by the workers
+ * Seed is mixed with the index of each leaf, so equal chunks in different places are hashed apart
+ * Leaves are the hashcodes of the leaves
+ * NextBatch is the next batch of leaves to be taken by a worker
+ */
+typedef struct {
+  unsigned char* Array;
+  size_t TotalElements;
+  size_t ElementSize;
+  int Format;
+  uint64_t Seed;
+  uint64_t* Leaves;
+  size_t QuantLeaves;
+  size_t NextBatch;
+} TreeHashing;
+
+void WhiroSetHashTree(size_t Threshold, size_t ChunkElements, int Workers, const char* TreeFileName){
+  TreeThreshold = Threshold;
+  TreeChunk = ChunkElements ? ChunkElements : WHIRO_TREE_CHUNK;
+  TreeWorkers = Workers;
+  if (TreeFileName == NULL || TreeFile != NULL)
+    return;
+
+  TreeFile = fopen(TreeFileName, "wb");
+  if (TreeFile == NULL){
+    printf("Error opening tree file %s\n", TreeFileName);
+    return;
+  }
+  fwrite(WHIRO_TREE_MAGIC, 1, 8, TreeFile);
+  atexit(WhiroCloseTreeFile);
+}
+
+int WhiroUsesHashTree(size_t TotalElements){
+  return TreeThreshold > 0 && TotalElements >= TreeThreshold;
+}
+
+static void WhiroHashLeaves(TreeHashing *Hashing){
+  size_t Batch;
+  while ((Batch = __atomic_fetch_add(&Hashing->NextBatch, 1, __ATOMIC_RELAXED)) * WHIRO_TREE_BATCH < Hashing->QuantLeaves){
+    size_t First = Batch * WHIRO_TREE_BATCH;
+    size_t Last = First + WHIRO_TREE_BATCH;
+    if (Last > Hashing->QuantLeaves)
+      Last = Hashing->QuantLeaves;
+    for (size_t i = First; i < Last; i++){
+      size_t Begin = i * TreeChunk;
+      size_t Quant = (Hashing->TotalElements - Begin < TreeChunk) ? Hashing->TotalElements - Begin : TreeChunk;
+      Hashing->Leaves[i] = WhiroHashScalars64(Hashing->Array + Begin * Hashing->ElementSize, Quant, Hashing->Format, WhiroHashCombine(Hashing->Seed, i));
+    }
+  }
+}
+
+static void* WhiroTreeWorker(void *Hashing){
+  WhiroHashLeaves((TreeHashing*) Hashing);
+  return NULL;
+}
+
+static void WhiroWriteTree(const char* Name, const char* FuncName, long CallCounter, TreeHashing *Hashing, uint32_t QuantLevels, size_t QuantNodes){
+  WhiroTreeRecord Record;
+  memset(&Record, 0, sizeof(WhiroTreeRecord));
+  Record.NameLength = strlen(Name);
+  Record.ScopeLength = strlen(FuncName);
+  Record.CallCounter = CallCounter;
+  Record.TotalElements = Hashing->TotalElements;
+  Record.ChunkElements = TreeChunk;
+  Record.ElementSize = Hashing->ElementSize;
+  Record.Format = Hashing->Format;
+  Record.Fanout = WHIRO_TREE_FANOUT;
+  Record.QuantLevels = QuantLevels;
+  Record.QuantNodes = QuantNodes;
+
+  pthread_mutex_lock(&TreeFileLock);
+  fwrite(&Record, sizeof(WhiroTreeRecord), 1, TreeFile);
+  fwrite(Name, 1, Record.NameLength, TreeFile);
+  fwrite(FuncName, 1, Record.ScopeLength, TreeFile);
+  fwrite(Hashing->Leaves, sizeof(uint64_t), QuantNodes, TreeFile);
+  pthread_mutex_unlock(&TreeFileLock);
+}
+
+uint64_t WhiroComputeHashTree(void* Array, size_t TotalElements, int Format, const char* Name, const char* FuncName, long CallCounter){
+  WHIRO_PROFILE_BEGIN(HASHING);
+  TreeHashing Hashing;
+  Hashing.Array = (unsigned char*) Array;
+  Hashing.TotalElements = TotalElements;
+  Hashing.ElementSize = WhiroScalarSize(Format);
+  Hashing.Format = Format;
+  Hashing.Seed = WhiroHashBytes64(&Format, sizeof(int), TotalElements);
+  Hashing.QuantLeaves = TotalElements ? (TotalElements + TreeChunk - 1) / TreeChunk : 1;
+  Hashing.NextBatch = 0;
+
+  //Every level of the tree is stored after the one below it, so the tree is written as a single block
+  size_t QuantNodes = 0;
+  uint32_t QuantLevels = 0;
+  for (size_t Width = Hashing.QuantLeaves; ; Width = (Width + WHIRO_TREE_FANOUT - 1) / WHIRO_TREE_FANOUT){
+    QuantNodes += Width;
+    QuantLevels++;
+    if (Width == 1)
+      break;
+  }
+  Hashing.Leaves = (uint64_t*) malloc(sizeof(uint64_t) * QuantNodes);
+
+  //The thread of the program is one of the workers, and no worker is started without a batch to take. If a thread
+  //cannot be created, the others do its work
+  size_t QuantBatches = (Hashing.QuantLeaves + WHIRO_TREE_BATCH - 1) / WHIRO_TREE_BATCH;
+  size_t Workers = (TotalElements * Hashing.ElementSize >= WHIRO_TREE_PARALLEL_BYTES && TreeWorkers > 1) ? (size_t) TreeWorkers : 1;
+  if (Workers > QuantBatches)
+    Workers = QuantBatches;
+  size_t QuantThreads = 0;
+  pthread_t *Threads = (Workers > 1) ? (pthread_t*) malloc(sizeof(pthread_t) * (Workers - 1)) : NULL;
+  for (size_t i = 1; Threads != NULL && i < Workers; i++){
+    if (pthread_create(&Threads[QuantThreads], NULL, WhiroTreeWorker, &Hashing) == 0)
+      QuantThreads++;
+  }
+  WhiroHashLeaves(&Hashing);
+  for (size_t i = 0; i < QuantThreads; i++)
+    pthread_join(Threads[i], NULL);
+  free(Threads);
+
+  //The upper levels hash only the hashcodes of the level below, so they are cheap enough for a single thread
+  uint64_t *Level = Hashing.Leaves;
+  size_t Width = Hashing.QuantLeaves;
+  for (uint32_t Height = 1; Height < QuantLevels; Height++){
+    uint64_t *Parents = Level + Width;
+    size_t QuantParents = (Width + WHIRO_TREE_FANOUT - 1) / WHIRO_TREE_FANOUT;
+    uint64_t Seed = WhiroHashCombine(Hashing.Seed, Height);
+    for (size_t i = 0; i < QuantParents; i++){
+      size_t First = i * WHIRO_TREE_FANOUT;
+      size_t QuantChildren = (Width - First < WHIRO_TREE_FANOUT) ? Width - First : WHIRO_TREE_FANOUT;
+      Parents[i] = WhiroHashBytes64(Level + First, QuantChildren * sizeof(uint64_t), Seed);
+    }
+    Level = Parents;
+    Width = QuantParents;
+  }
+  uint64_t Root = Level[0];
+
+  if (Name != NULL && TreeFile != NULL)
+    WhiroWriteTree(Name, FuncName, CallCounter, &Hashing, QuantLevels, QuantNodes);
+  free(Hashing.Leaves);
+  WHIRO_PROFILE_END(HASHING);
+  return Root;
+}
+
+void WhiroCloseTreeFile(){
+  pthread_mutex_lock(&TreeFileLock);
+  if (TreeFile != NULL)
+    fclose(TreeFile);
+  TreeFile = NULL;
+  pthread_mutex_unlock(&TreeFileLock);
+}
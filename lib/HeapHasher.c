@@ -0,0 +1,318 @@
+#include "../include/Whiro.h"
+
+extern TypeDescriptor * TypeTable;
+extern HeapEntry * HeapTable;
+extern unsigned WhiroVisitEpoch;
+extern int MemFilter, InsHeap;
+
+//Usage mode setting. If it is set, heap graphs are reported as structural hashcodes
+int HashHeap = 0;
+
+//Tags mixed into the hashcode to tell apart the different kinds of values in a heap graph
+#define WHIRO_HASH_SEED 0x5748495230ULL
+#define WHIRO_TAG_NULL 1
+#define WHIRO_TAG_NEW_BLOCK 2
+#define WHIRO_TAG_VISITED_BLOCK 3
+#define WHIRO_TAG_FREED_BLOCK 4
+#define WHIRO_TAG_NON_HEAP 5
+#define WHIRO_TAG_ARRAY 6
+
+/**
+ * This structure holds the hashcode of a root reported by a reference run
+ * Key is the "name function counter" prefix of the line in the reference output
+ * Hashcode is the hashcode reported for that root
+ * hh is the member to make this entry "hashable"
+ */
+typedef struct {
+  char* Key;
+  uint64_t Hashcode;
+  UT_hash_handle hh;
+} ReferenceHash;
+
+static ReferenceHash *ReferenceHashes = NULL;
+static int HasReference = 0;
+
+//Blocks are numbered in the order they are discovered, so the hashcode does not depend on their addresses
+static size_t NextOrder = 0;
+
+//Roots of the entire heap, collected before being reported
+typedef struct {
+  HeapEntry* Entry;
+  uint64_t Hashcode;
+} HeapRoot;
+
+static HeapRoot *Roots = NULL;
+static size_t RootsCapacity = 0;
+
+void WhiroSetHeapHashing(const char* ReferenceFile){
+  HashHeap = 1;
+  if (ReferenceFile == NULL || ReferenceFile[0] == '\0')
+    return;
+
+  FILE* Reference = fopen(ReferenceFile, "r");
+  if (Reference == NULL){
+    printf("Error opening reference file %s\n", ReferenceFile);
+    return;
+  }
+
+  HasReference = 1;
+  char *Line = NULL;
+  size_t LineCapacity = 0;
+  while (getline(&Line, &LineCapacity, Reference) != -1){
+    //Only lines holding a hashcode are kept. Lines dumped by the reference itself are ignored
+    char *Separator = strstr(Line, " : ");
+    if (Separator == NULL)
+      continue;
+
+    char *End;
+    uint64_t Hashcode = strtoull(Separator + 3, &End, 10);
+    if (End == Separator + 3 || (*End != '\n' && *End != '\0'))
+      continue;
+
+    size_t KeyLength = Separator - Line;
+    ReferenceHash *Entry;
+    HASH_FIND(hh, ReferenceHashes, Line, KeyLength, Entry);
+    if (Entry == NULL){
+      Entry = (ReferenceHash*) malloc(sizeof(ReferenceHash));
+      Entry->Key = strndup(Line, KeyLength);
+      HASH_ADD_KEYPTR(hh, ReferenceHashes, Entry->Key, KeyLength, Entry);
+    }
+    Entry->Hashcode = Hashcode;
+  }
+
+  free(Line);
+  fclose(Reference);
+}
+
+static uint64_t WhiroHashBlock(uint64_t Hashcode, HeapEntry *Entry){
+  //A block visited before is identified by the order it was discovered in
+  if (Entry->Visited == WhiroVisitEpoch)
+    return WhiroHashCombine(WhiroHashCombine(Hashcode, WHIRO_TAG_VISITED_BLOCK), Entry->Order);
+
+  Entry->Visited = WhiroVisitEpoch;
+  Entry->Order = NextOrder++;
+  if (Entry->Free == 1)
+    return WhiroHashCombine(Hashcode, WHIRO_TAG_FREED_BLOCK);
+
+  TypeDescriptor *Type = &TypeTable[Entry->Data->TypeIndex];
+  Hashcode = WhiroHashCombine(WhiroHashCombine(Hashcode, WHIRO_TAG_NEW_BLOCK), Entry->Data->Size);
+  if (Entry->Data->Size > 1){
+    if (Type->QuantFields == 1 && WhiroIsScalarType(Type->Fields[0].Format)){
+      uint64_t ArrayHashcode = WhiroHashArray(Entry->Key, Entry->Data->Size, Entry->Data->ArrayStep, Type->Fields[0].Format);
+      Hashcode = WhiroHashCombine(Hashcode, ArrayHashcode);
+    }
+    else
+      WhiroPushArrayFrame(Entry->Key, Type, Entry->Data->Size, Entry->Data->Bytes / Entry->Data->Size, 0);
+  }
+  else
+    WhiroPushFrame(Entry->Key, Type, 0, 0, WHIRO_FRAME_FIELDS);
+
+  return Hashcode;
+}
+
+static uint64_t WhiroHashPointer(uint64_t Hashcode, void *Ptr){
+  if (Ptr == NULL)
+    return WhiroHashCombine(Hashcode, WHIRO_TAG_NULL);
+
+  //Only the heap graph is hashed. Pointers to other segments are not followed
+  HeapEntry *Entry;
+  HASH_FIND(hh, HeapTable, &Ptr, sizeof(void*), Entry);
+  if (Entry == NULL)
+    return WhiroHashCombine(Hashcode, WHIRO_TAG_NON_HEAP);
+
+  return WhiroHashBlock(Hashcode, Entry);
+}
+
+static uint64_t WhiroHashField(uint64_t Hashcode, void *Data, Field *DataField){
+  void *Value = Data + DataField->Offset;
+  Hashcode = WhiroHashCombine(Hashcode, DataField->Format);
+  switch (DataField->Format){
+    case 1:
+      return WhiroHashCombine(Hashcode, WhiroHashReal(*(double*)Value));
+
+    case 2:
+      return WhiroHashCombine(Hashcode, WhiroHashReal(*(float*)Value));
+
+    case 3:
+      return WhiroHashCombine(Hashcode, *(short*)Value);
+
+    case 4:
+      return WhiroHashCombine(Hashcode, *(long*)Value);
+
+    case 5:
+      return WhiroHashCombine(Hashcode, *(long long*)Value);
+
+    case 6:
+      return WhiroHashCombine(Hashcode, *(int*)Value);
+
+    case 7:
+      return WhiroHashCombine(Hashcode, *(char*)Value);
+
+    case 8:
+      return WhiroHashCombine(Hashcode, *(unsigned char*)Value);
+
+    case 9:
+      return WhiroHashCombine(Hashcode, *(unsigned short*)Value);
+
+    case 10:
+      return WhiroHashCombine(Hashcode, *(unsigned long*)Value);
+
+    case 11:
+      return WhiroHashCombine(Hashcode, *(unsigned long long*)Value);
+
+    case 12:
+      return WhiroHashCombine(Hashcode, *(unsigned int*)Value);
+
+    case 13:
+      return WhiroHashPointer(Hashcode, *(void**)Value);
+
+    case 15:{
+      //The descriptor of the array holds its number of elements, and the index of the descriptor of its elements
+      Field *ArrayField = &TypeTable[DataField->BaseTypeIndex].Fields[0];
+      int ElementFormat = TypeTable[ArrayField->BaseTypeIndex].Fields[0].Format;
+      if (!WhiroIsScalarType(ElementFormat))
+        return Hashcode;
+      uint64_t ArrayHashcode = WhiroHashArray(Value, ArrayField->Offset, ArrayField->Offset, ElementFormat);
+      return WhiroHashCombine(WhiroHashCombine(Hashcode, WHIRO_TAG_ARRAY), ArrayHashcode);
+    }
+
+    case 16:
+    case 18:
+      //Unions and raw values are hashed with the same bytes Whiro prints for them. Their size is kept in the
+      //base type index of the field
+      for (int i = 0; i < DataField->BaseTypeIndex; i++)
+        Hashcode = WhiroHashCombine(Hashcode, ((unsigned char*) Value)[i]);
+      return Hashcode;
+
+    case 17:
+      WhiroPushFrame(Value, &TypeTable[DataField->BaseTypeIndex], 0, 0, WHIRO_FRAME_FIELDS);
+      return Hashcode;
+
+    default:
+      return Hashcode;
+  }
+}
+
+static uint64_t WhiroHashElement(uint64_t Hashcode, void *Element, TypeDescriptor *Type){
+  //The fields of an element are mixed in place, instead of pushing a frame per element, so an array of
+  //structs is hashed in a single pass over its memory. Nested structs and pointers still push frames, which
+  //are hashed before the next element
+  for (int i = 0; i < Type->QuantFields; i++)
+    Hashcode = WhiroHashField(Hashcode, Element, &Type->Fields[i]);
+  return Hashcode;
+}
+
+static uint64_t WhiroHashWorkList(uint64_t Hashcode){
+  InspectionFrame Current;
+  size_t Index;
+  while (WhiroNextWorkItem(&Current, &Index)){
+    if (Current.Kind == WHIRO_FRAME_FIELDS)
+      Hashcode = WhiroHashField(Hashcode, Current.Data, &Current.Type->Fields[Index]);
+    else if (Current.Kind == WHIRO_FRAME_ELEMENTS)
+      Hashcode = WhiroHashElement(Hashcode, Current.Data + Index * Current.Stride, Current.Type);
+    else
+      Hashcode = WhiroHashPointer(Hashcode, ((void**) Current.Data)[Index]);
+  }
+  return Hashcode;
+}
+
+uint64_t WhiroHashHeapGraph(HeapEntry *Entry){
+  WHIRO_PROFILE_BEGIN(HASHING);
+  uint64_t Hashcode = WhiroHashWorkList(WhiroHashBlock(WHIRO_HASH_SEED, Entry));
+  WHIRO_PROFILE_END(HASHING);
+  return Hashcode;
+}
+
+static int WhiroMatchesReference(char *Name, char *FuncName, long CallCounter, uint64_t Hashcode){
+  if (!HasReference)
+    return 1;
+
+  size_t KeyLength = snprintf(NULL, 0, "%s %s %ld", Name, FuncName, CallCounter);
+  char Key[KeyLength + 1];
+  snprintf(Key, KeyLength + 1, "%s %s %ld", Name, FuncName, CallCounter);
+  ReferenceHash *Entry;
+  HASH_FIND(hh, ReferenceHashes, Key, KeyLength, Entry);
+  return Entry && Entry->Hashcode == Hashcode;
+}
+
+static void WhiroDumpHeapGraph(FILE *OutputFile, HeapEntry *Entry, char *Name, char *FuncName, long CallCounter){
+  //Roots that diverge from the reference are reported field by field, following every pointer
+  int PreciseMode = WhiroSetThreadMode(1);
+  WhiroSetAllHeapUnivisited();
+  WhiroInspectHeapData(OutputFile, Entry, Name, FuncName, CallCounter);
+  WhiroSetThreadMode(PreciseMode);
+}
+
+void WhiroReportPointerHash(FILE *OutputFile, void *Ptr, int TypeIndex, char *Name, char *FuncName, long CallCounter){
+  HeapEntry *Entry = NULL;
+  if (Ptr)
+    HASH_FIND(hh, HeapTable, &Ptr, sizeof(void*), Entry);
+
+  //Pointers outside the heap are inspected as usual
+  if (Entry == NULL || (MemFilter && !InsHeap)){
+    WhiroTrackPointer(OutputFile, Ptr, TypeIndex, Name, FuncName, CallCounter);
+    WhiroSetAllHeapUnivisited();
+    return;
+  }
+
+  WhiroSetAllHeapUnivisited();
+  NextOrder = 0;
+  uint64_t Hashcode = WhiroHashHeapGraph(Entry);
+  WhiroReportU64(OutputFile, Name, FuncName, CallCounter, " : ", Hashcode);
+  if (!WhiroMatchesReference(Name, FuncName, CallCounter, Hashcode))
+    WhiroDumpHeapGraph(OutputFile, Entry, Name, FuncName, CallCounter);
+
+  WhiroSetAllHeapUnivisited();
+}
+
+void WhiroReportArrayHash(FILE *OutputFile, void *Array, size_t Count, size_t ElementSize, int TypeIndex, char *Name, char *FuncName, long CallCounter){
+  WhiroSetAllHeapUnivisited();
+  NextOrder = 0;
+  WHIRO_PROFILE_BEGIN(HASHING);
+  uint64_t Hashcode = WhiroHashCombine(WhiroHashCombine(WHIRO_HASH_SEED, WHIRO_TAG_ARRAY), Count);
+  WhiroPushArrayFrame(Array, &TypeTable[TypeIndex], Count, ElementSize, 0);
+  Hashcode = WhiroHashWorkList(Hashcode);
+  WHIRO_PROFILE_END(HASHING);
+
+  WhiroReportU64(OutputFile, Name, FuncName, CallCounter, " : ", Hashcode);
+  if (!WhiroMatchesReference(Name, FuncName, CallCounter, Hashcode)){
+    //Arrays that diverge from the reference are reported element by element, following every pointer
+    int PreciseMode = WhiroSetThreadMode(1);
+    WhiroSetAllHeapUnivisited();
+    WhiroInspectArrayElements(OutputFile, Array, Count, ElementSize, TypeIndex, Name, FuncName, CallCounter);
+    WhiroSetThreadMode(PreciseMode);
+  }
+
+  WhiroSetAllHeapUnivisited();
+}
+
+void WhiroReportHeapHash(FILE *OutputFile, char *FuncName, long CallCounter){
+  //Hash every root first. Dumping a divergent root would change the visited blocks
+  size_t QuantRoots = 0;
+  HeapEntry *Entry;
+  WhiroSetAllHeapUnivisited();
+  NextOrder = 0;
+  for (Entry = HeapTable; Entry != NULL; Entry = Entry->hh.next){
+    if (Entry->Free == 1 || Entry->Visited == WhiroVisitEpoch)
+      continue;
+
+    if (QuantRoots == RootsCapacity){
+      RootsCapacity = RootsCapacity ? 2 * RootsCapacity : 64;
+      Roots = (HeapRoot*) realloc(Roots, sizeof(HeapRoot) * RootsCapacity);
+    }
+    Roots[QuantRoots].Entry = Entry;
+    Roots[QuantRoots].Hashcode = WhiroHashHeapGraph(Entry);
+    QuantRoots++;
+  }
+
+  for (size_t i = 0; i < QuantRoots; i++){
+    int NameLength = snprintf(NULL, 0, "Heap Data[%zu]", i);
+    char Name[NameLength + 1];
+    snprintf(Name, NameLength + 1, "Heap Data[%zu]", i);
+    WhiroReportU64(OutputFile, Name, FuncName, CallCounter, " : ", Roots[i].Hashcode);
+    if (!WhiroMatchesReference(Name, FuncName, CallCounter, Roots[i].Hashcode))
+      WhiroDumpHeapGraph(OutputFile, Roots[i].Entry, Name, FuncName, CallCounter);
+  }
+
+  WhiroSetAllHeapUnivisited();
+}
@@ -2,6 +2,9 @@
 
 HeapEntry *HeapTable = NULL;
 extern TypeDescriptor * TypeTable;
+extern int HashHeap, HeapWorkers;
+//Entries whose Visited field is equal to this epoch were visited in the current traversal
+unsigned WhiroVisitEpoch = 1;
 
 void WhiroPrintTable(){
   HeapEntry * Entry;
@@ -11,38 +14,65 @@ void WhiroPrintTable(){
   printf("\n");
 }
 
-void WhiroInsertHeapEntry(void *Block, int Size, int ArrayStep, int TypeIndex){
+WHIRO_HOT void WhiroInsertHeapEntry(void *Block, size_t Size, size_t ArrayStep, size_t Bytes, int TypeIndex){
+  WHIRO_PROFILE_BEGIN(HEAP_TABLE);
   HeapEntry * Entry;
  	//Insert a new entry in the Heap Table
  	//If we do not find an entry in the table for this pointers, we create one.
+  //Otherwise, the address is being reused and we only refresh its data.
   HASH_FIND(hh, HeapTable, &Block, sizeof(void*), Entry);
   if (Entry == NULL){
     Entry = (HeapEntry*) malloc(sizeof(HeapEntry));
     Entry->Key = Block;
+    Entry->Data = NULL;
+    HASH_ADD(hh, HeapTable, Key, sizeof(void*), Entry);
   }
 
-  Entry->Data = (HeapData*) malloc(sizeof(HeapData));
+  if (Entry->Data == NULL)
+    Entry->Data = (HeapData*) malloc(sizeof(HeapData));
   Entry->Data->TypeIndex = TypeIndex;
   Entry->Data->Size = Size;
   Entry->Data->ArrayStep = ArrayStep;
+  Entry->Data->Bytes = Bytes;
   Entry->Visited = Entry->Free = 0;
-  HASH_ADD(hh, HeapTable, Key, sizeof(void*), Entry);
+  WHIRO_PROFILE_END(HEAP_TABLE);
 }
 
-void WhiroUpdateHeapEntrySize(void *Block, int NewSize){
-  //Update the size of an entry in the Heap Table
-  HeapEntry * Entry;
-  HASH_FIND(hh, HeapTable, &Block, sizeof(void*), Entry);
-  if (Entry){
-    if (Entry->Data){
-      Entry->Data->Size = NewSize;
-      Entry->Data->ArrayStep = NewSize;
-    }
+void WhiroReallocHeapEntry(void *OldBlock, void *NewBlock, size_t Bytes, size_t ElementSize, int TypeIndex){
+  WHIRO_PROFILE_BEGIN(HEAP_TABLE);
+  HeapEntry * Entry = NULL;
+  if (OldBlock)
+    HASH_FIND(hh, HeapTable, &OldBlock, sizeof(void*), Entry);
+
+  if (NewBlock == NULL){
+    //realloc(Block, 0) may release the block. Any other failure keeps the old block valid
+    if (Bytes == 0 && OldBlock)
+      WhiroDeleteHeapEntry(OldBlock);
+    WHIRO_PROFILE_END(HEAP_TABLE);
+    return;
   }
+
+  //The old entry knows the type of the block better than the call site of realloc
+  if (Entry && Entry->Data){
+    TypeIndex = Entry->Data->TypeIndex;
+    if (Entry->Data->Size > 0)
+      ElementSize = Entry->Data->Bytes / Entry->Data->Size;
+  }
+
+  size_t Size = (ElementSize > 0) ? Bytes / ElementSize : Bytes;
+  //If the block moved, the old address is no longer valid
+  if (Entry && OldBlock != NewBlock)
+    WhiroDeleteHeapEntry(OldBlock);
+
+  //A negative type index means the monitor could not type this block
+  if (TypeIndex >= 0)
+    WhiroInsertHeapEntry(NewBlock, Size, Size, Bytes, TypeIndex);
+  WHIRO_PROFILE_END(HEAP_TABLE);
 }
 
-void WhiroDeleteHeapEntry(void *Block){
+WHIRO_HOT void WhiroDeleteHeapEntry(void *Block){
   //Set a heap entry as unreachable data
+  WHIRO_PROFILE_BEGIN(HEAP_TABLE);
   HeapEntry * Entry;
   HASH_FIND(hh, HeapTable, &Block, sizeof(void*), Entry);
   if (Entry){
@@ -50,69 +80,88 @@ void WhiroDeleteHeapEntry(void *Block){
     free(Entry->Data);
     Entry->Data = NULL;
   }
+  WHIRO_PROFILE_END(HEAP_TABLE);
+}
+
+void WhiroInspectHeapData(FILE *OutputFile, HeapEntry *Entry, char *PtrName, char *FuncName, long CallCounter){
+  WhiroVisitHeapData(OutputFile, Entry, WhiroSetInspectionName(PtrName), FuncName, CallCounter);
+  WhiroTraverseWorkList(OutputFile, FuncName, CallCounter);
 }
 
-void WhiroInspectHeapData(FILE *OutputFile, HeapEntry *Entry, char *PtrName, char *FuncName, int CallCounter, int FollowPtr){
+void WhiroVisitHeapData(FILE *OutputFile, HeapEntry *Entry, size_t NameLength, char *FuncName, long CallCounter){
   //If this entry was already visited, do not print it again.
   //Otherwise, set is as visited.
-  if (Entry->Visited == 1)
+  if (Entry->Visited == WhiroVisitEpoch)
     return;
   else
-    Entry->Visited = 1;
+    Entry->Visited = WhiroVisitEpoch;
 
  	//If this is unreachable data, Whiro does not inspect it. 
   if (Entry->Free == 1){
-    fprintf(OutputFile, "%s %s %d : freed\n", PtrName, FuncName, CallCounter);
+    WhiroProfiledPrintf(OutputFile, "%s %s %ld : freed\n", WhiroInspectionName(NameLength), FuncName, CallCounter);
     return;
   }
 
   if (Entry->Data->Size > 1){
-    WhiroInspectHeapArray(OutputFile, Entry, PtrName, FuncName, CallCounter);
+    WhiroVisitHeapArray(OutputFile, Entry, NameLength, FuncName, CallCounter);
     return;
   }
   else
-    WhiroInspectData(OutputFile, Entry->Key, &TypeTable[Entry->Data->TypeIndex], PtrName, FuncName, CallCounter);
+    WhiroPushFrame(Entry->Key, &TypeTable[Entry->Data->TypeIndex], 0, NameLength, WHIRO_FRAME_FIELDS);
 }
 
-void WhiroInspectHeapArray(FILE *OutputFile, HeapEntry *Entry, char *PtrName, char *FuncName, int CallCounter){
+void WhiroVisitHeapArray(FILE *OutputFile, HeapEntry *Entry, size_t NameLength, char *FuncName, long CallCounter){
   //Inspect an array allocated in the heap
-  TypeDescriptor Type = TypeTable[Entry->Data->TypeIndex];
-  if (WhiroIsScalarType(Type.Fields[0].Format)){
+  TypeDescriptor *Type = &TypeTable[Entry->Data->TypeIndex];
+  if (Type->QuantFields == 1 && WhiroIsScalarType(Type->Fields[0].Format)){
     //If it is a scalar, compute a hashcode value
-    int Hashcode = WhiroComputeHashcode(Entry->Key, Entry->Data->Size, Entry->Data->ArrayStep, Type.Fields[0].Format);
-    fprintf(OutputFile, "%s %s %d: %d\n", PtrName, FuncName, CallCounter, Hashcode);
+    WhiroReportArrayHashcode(OutputFile, WhiroInspectionName(NameLength), FuncName, CallCounter, ": ", Entry->Key, Entry->Data->Size, Entry->Data->ArrayStep, Type->Fields[0].Format);
   }
-  else if (Type.Fields[0].Format == 13){
+  else if (Type->QuantFields == 1 && Type->Fields[0].Format == 13){
     //If it is an array of pointers, inspect each position
-    for (int i = 0; i < Entry->Data->Size; i++){
-      void **Next = (Entry->Key + i);
-      char *DataName = WhiroGetArrayIndexAsString(i);
-      char *DataFullName = (char*) malloc(strlen(PtrName) + strlen(DataName) + 1);
-      strcpy(DataFullName, PtrName);
-      strcat(DataFullName, DataName);
-      WhiroInspectPointer(OutputFile, *Next, Type.Fields[0].BaseTypeIndex, DataFullName, FuncName, CallCounter);
-      free(DataFullName);
+    if (WhiroIsPrecise())
+      WhiroPushFrame(Entry->Key, Type, Entry->Data->Size, NameLength, WHIRO_FRAME_POINTERS);
+    else{
+      for (size_t i = 0; i < Entry->Data->Size; i++)
+        WhiroProfiledPrintf(OutputFile, "%s %s %ld : pointer to %s\n", WhiroInspectionName(WhiroAppendInspectionIndex(NameLength, i)), FuncName, CallCounter, TypeTable[Type->Fields[0].BaseTypeIndex].Name);
     }
   }
-  else{
-    //Inspect non-scalar array
-    printf("Do not inspect non-scalar array<<<<<<<<<<<>>>>>>>>>>>\n");
-  }
+  else
+    //Arrays of structs and unions are inspected element by element, with the size of each element as stride
+    WhiroPushArrayFrame(Entry->Key, Type, Entry->Data->Size, Entry->Data->Bytes / Entry->Data->Size, NameLength);
 }
 
-void WhiroInspectEntireHeap(FILE *OutputFile, char *FuncName, int CallCounter){
+void WhiroInspectEntireHeap(FILE *OutputFile, char *FuncName, long CallCounter){
   //Report all the heap-allocated data
-  HeapEntry * Entry;
-  for (Entry = HeapTable; Entry != NULL; Entry = Entry->hh.next){
-    if (Entry->Free == 0)
-      WhiroInspectHeapData(OutputFile, Entry, "Heap Data", FuncName, CallCounter, 0);
+  WHIRO_PROFILE_BEGIN(ENTIRE_HEAP);
+  if (HashHeap){
+    WhiroReportHeapHash(OutputFile, FuncName, CallCounter);
+    WHIRO_PROFILE_END(ENTIRE_HEAP);
+    return;
+  }
+
+  if (HeapWorkers > 0)
+    WhiroInspectHeapInParallel(OutputFile, FuncName, CallCounter);
+  else{
+    HeapEntry * Entry;
+    for (Entry = HeapTable; Entry != NULL; Entry = Entry->hh.next){
+      if (Entry->Free == 0)
+        WhiroInspectHeapData(OutputFile, Entry, "Heap Data", FuncName, CallCounter);
+    }
   }
 
   WhiroSetAllHeapUnivisited();
+  WHIRO_PROFILE_END(ENTIRE_HEAP);
 }
 
 void WhiroSetAllHeapUnivisited(){
-  HeapEntry * Entry;
-  for (Entry = HeapTable; Entry != NULL; Entry = Entry->hh.next)
-    Entry->Visited = 0;
+  //Starting a new epoch sets every entry as unvisited. Only when the epoch wraps around
+  //we need to reset the entries
+  WhiroVisitEpoch++;
+  if (WhiroVisitEpoch == 0){
+    HeapEntry * Entry;
+    for (Entry = HeapTable; Entry != NULL; Entry = Entry->hh.next)
+      Entry->Visited = 0;
+    WhiroVisitEpoch = 1;
+  }
 }
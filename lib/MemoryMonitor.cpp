@@ -36,11 +36,20 @@
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/CFG.h" //To iterate over the predecessors of a basic block
 #include "llvm/IR/Dominators.h" //To use the dominance tree of a program
+#include "llvm/Transforms/Utils/BasicBlockUtils.h" //To split basic blocks
+#include "llvm/Transforms/Utils/ModuleUtils.h" //To register translation units at startup
+#include "llvm/IR/MDBuilder.h" //To weight the branches that allocate counter blocks
+#include "llvm/Analysis/LoopInfo.h" //To find the latches of loops
 #include "llvm/IR/DebugInfo.h" //To get Metadata about a Module
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CommandLine.h" //To use command line flags
 #include "llvm/Support/Debug.h" //To use LLVM_DEBUG macro with fine grained debug
 #include "llvm/ADT/Statistic.h" // For the STATISTIC macro.
+#include "llvm/Support/FileSystem.h"
+
+#include <functional> //To pass the conditions that guard inspection points
+#include <mutex> //To share type descriptors between instances of the pass
+#include <memory> //To keep the dominator tree of the function being instrumented
 
 #include "../include/MemoryMonitor.h"
 
@@ -60,6 +69,61 @@ cl::opt<bool> InsStatic ("stc", cl::init(false), cl::desc("Inspect only the stat
 cl::opt<bool> TrackPtr ("pr", cl::init(false), cl::desc("Enables precise mode"));
 //This flag tells the pass to inspect the entire heap at the inspection points
 cl::opt<bool> InsFullHeap ("fp", cl::init(false), cl::desc("Inspect the entire heap"));
+//This option sets the number of threads that inspect the entire heap
+cl::opt<unsigned> HeapWorkers ("fp-workers", cl::init(0), cl::desc("Number of threads that inspect the entire heap"), cl::value_desc("number"));
+//This flag tells the pass to report heap graphs as structural hashcodes instead of field by field
+cl::opt<bool> HashHeap ("hh", cl::init(false), cl::desc("Report heap graphs as structural hashcodes"));
+//This option names the output of a reference run. Heap graphs whose hashcode differs from it are also dumped
+cl::opt<std::string> HashReference ("hh-ref", cl::init(""), cl::desc("Output file of a reference run to compare heap hashcodes against"), cl::value_desc("filename"));
+
+//This flag tells the pass to hash arrays of scalars with a 64-bit hash of their bytes
+cl::opt<bool> WideHash ("hash64", cl::init(false), cl::desc("Hash arrays with a 64-bit hash of their bytes"));
+//This flag tells the pass to hash floating-point values by their bits instead of quantizing them
+cl::opt<bool> ExactRealHash ("hash-exact-fp", cl::init(false), cl::desc("Hash floating-point values by their bits instead of their printed precision"));
+//This option tells the pass to hash arrays of at least this many elements as trees of chunks, with the 64-bit hash
+cl::opt<unsigned> HashTree ("hash-tree", cl::init(0), cl::desc("Hash arrays of at least this many elements as trees of chunks"), cl::value_desc("elements"));
+//This option sets the number of elements hashed by each leaf of a hash tree
+cl::opt<unsigned> HashTreeChunk ("hash-tree-chunk", cl::init(4096), cl::desc("Number of elements in each chunk of a hash tree"), cl::value_desc("elements"));
+//This option sets the number of threads that hash the chunks of very large arrays
+cl::opt<unsigned> HashTreeWorkers ("hash-tree-workers", cl::init(0), cl::desc("Number of threads that hash the chunks of very large arrays"), cl::value_desc("number"));
+//This flag tells the pass to write the hash trees of the reported arrays to a file, to be compared by whiro-tree-diff
+cl::opt<bool> HashTreeFile ("hash-tree-file", cl::init(false), cl::desc("Write the hash trees of the reported arrays to a file"));
+//This flag tells the pass to report unions and raw values as decimal bytes, as older versions of Whiro did
+cl::opt<bool> DecimalBytes ("decimal-bytes", cl::init(false), cl::desc("Report unions and raw values as decimal bytes instead of hexadecimal"));
+
+//This flag tells the pass to create inspection points at the latches of loops
+cl::opt<bool> InsLoops ("loops", cl::init(false), cl::desc("Create inspection points at the latches of loops"));
+//This option lists source lines where inspection points are created, as file:line
+cl::list<std::string> InsLines ("lines", cl::CommaSeparated, cl::desc("Create inspection points at source lines"), cl::value_desc("file:line,..."));
+//This option tells the pass to report loop and line inspection points only every Nth time they are reached
+cl::opt<unsigned> Stride ("stride", cl::init(1), cl::desc("Report loop and line inspection points every Nth time they are reached"), cl::value_desc("number"));
+//This flag tells the pass not to create inspection points at the return of functions
+cl::opt<bool> NoReturnPoints ("nr", cl::init(false), cl::desc("Do not create inspection points at the return of functions"));
+//This flag tells the pass to report static variables only when their contents change
+cl::opt<bool> DedupStatic ("dedup-static", cl::init(false), cl::desc("Report static variables only when they change"));
+//This option lists the static variables watched with hardware breakpoints. In this mode, the program is not inspected
+cl::list<std::string> WatchVars ("watch", cl::CommaSeparated, cl::desc("Watch static variables with hardware breakpoints instead of inspecting the program"), cl::value_desc("var,..."));
+//This option sets how many writes to watched variables are kept
+cl::opt<unsigned> WatchBuffer ("watch-buffer", cl::init(65536), cl::desc("Number of writes to watched variables kept by the runtime"), cl::value_desc("number"));
+//This flag tells the pass to write how many times each function and inspection point was reached
+cl::opt<bool> CallProfile ("profile", cl::init(false), cl::desc("Write a profile with the number of calls of every function"));
+//This flag tells the pass to write an index of the inspection points at the end of the output file
+cl::opt<bool> Indexed ("indexed", cl::init(false), cl::desc("Write an indexed output file, with random access by inspection point"));
+//This option sets how many inspection points are grouped in a block of the indexed output file
+cl::opt<unsigned> IndexBlock ("index-block", cl::init(64), cl::desc("Number of inspection points in each block of the indexed output file"), cl::value_desc("number"));
+//This option gives the indexed output file of a reference run, against which the reports are checked as they are written
+cl::opt<std::string> CheckReference ("ref", cl::init(""), cl::desc("Check the reports against the indexed output file of a reference run"), cl::value_desc("file"));
+//This flag tells the pass to stop the program at the first divergence from the reference
+cl::opt<bool> CheckStop ("ref-stop", cl::init(false), cl::desc("Stop the program at the first divergence from the reference"));
+//This flag tells the pass to fork the program at inspection points, so the state is reported by a child process
+cl::opt<bool> ForkSnapshot ("fork", cl::init(false), cl::desc("Report the program state from forked snapshots"));
+//This option bounds the number of snapshots inspecting the program at once
+cl::opt<unsigned> ForkLimit ("fork-max", cl::init(4), cl::desc("Maximum number of concurrent snapshots"), cl::value_desc("number"));
+//This flag tells the pass to instrument a single translation unit, whose Type Table and counters are merged with the
+//ones of the other units when the program starts
+cl::opt<bool> SeparateUnit ("tu", cl::init(false), cl::desc("Instrument a translation unit of the program, which may have no main function"));
+//This option names the output files of a program instrumented in separate compilation
+cl::opt<std::string> UnitProgram ("tu-program", cl::init(""), cl::desc("Name of the output files in separate compilation (default: the unit that sets up the runtime)"), cl::value_desc("name"));
 
 STATISTIC(TotalVars, "Number of variables inspected");
 STATISTIC(ExtendedVars, "Number of extended live ranges");
@@ -117,10 +181,17 @@ void MemoryMonitor::OpenOutputFile(IRBuilder<> Builder){
   IO_marker->setBody(Elements, false);  
 
   //Get the basename of the file
-  std::string ProgramName = this->M->getSourceFileName();
+  std::string ProgramName = GetProgramName();
   
-  GlobalVariable* IO_FILE_Definition = new GlobalVariable(*(this->M), IO_FILE_Ptr, false, GlobalValue::CommonLinkage, Constant::getNullValue(PointerType::getUnqual(IO_FILE)), ProgramName + "_Output");
-  IO_FILE_Definition->setDSOLocal(true);
+  //In separate compilation, the output file is a variable of the runtime, shared by the units of the program and
+  //of its shared libraries
+  GlobalVariable* IO_FILE_Definition = nullptr;
+  if(SeparateUnit)
+    IO_FILE_Definition = new GlobalVariable(*(this->M), IO_FILE_Ptr, false, GlobalValue::ExternalLinkage, nullptr, "WhiroOutputFile");
+  else{
+    IO_FILE_Definition = new GlobalVariable(*(this->M), IO_FILE_Ptr, false, GlobalValue::CommonLinkage, Constant::getNullValue(PointerType::getUnqual(IO_FILE)), ProgramName + "_Output");
+    IO_FILE_Definition->setDSOLocal(true);
+  }
   this->OutputFile = IO_FILE_Definition;
   this->OutputFileType = IO_FILE_Ptr;
   
@@ -129,17 +200,362 @@ void MemoryMonitor::OpenOutputFile(IRBuilder<> Builder){
   std::vector<Value*> Args;
   ArgsType.push_back(Builder.getInt8PtrTy());
   ArgsType.push_back(Builder.getInt8PtrTy());
+  
+  //In the checking mode, the reports go to a stream that compares them against the reference, and only the
+  //divergences are written to a file
+  if(!CheckReference.empty()){
+    ArgsType.push_back(Builder.getInt32Ty());
+    Args.push_back(Builder.CreateGlobalStringPtr(StringRef(CheckReference), "str"));
+    Args.push_back(Builder.CreateGlobalStringPtr(StringRef(ProgramName + "_Divergence"), "str"));
+    Args.push_back(ConstantInt::get(Builder.getInt32Ty(), CheckStop));
+    this->OutputFileStore = Builder.CreateStore(InsertFunctionCall("WhiroOpenChecker", IO_FILE_Ptr, ArgsType, Args, Builder, false), this->OutputFile);
+    return;
+  }
 
-  Args.push_back(Builder.CreateGlobalStringPtr( StringRef(ProgramName + "_Output"), "str"));
+  //The indexed output file is not a plain text file, so it has a name of its own. The program writes to a stream
+  //that keeps the reports of each thread apart until they are indexed
+  if(Indexed){
+    ArgsType.pop_back();
+    Args.push_back(Builder.CreateGlobalStringPtr(StringRef(ProgramName + "_Checkpoint"), "str"));
+    this->OutputFileStore = Builder.CreateStore(InsertFunctionCall("WhiroOpenIndexedOutput", IO_FILE_Ptr, ArgsType, Args, Builder, false), this->OutputFile);
+    return;
+  }
+  Args.push_back(Builder.CreateGlobalStringPtr(StringRef(ProgramName + "_Output"), "str"));
   Args.push_back(Builder.CreateGlobalStringPtr(StringRef("w"), "str"));
-  Builder.CreateStore(InsertFunctionCall("fopen", IO_FILE_Ptr, ArgsType, Args, Builder, false), this->OutputFile);
+  this->OutputFileStore = Builder.CreateStore(InsertFunctionCall("fopen", IO_FILE_Ptr, ArgsType, Args, Builder, false), this->OutputFile);
+}
+
+Value* MemoryMonitor::LoadOutputFile(Function& F){
+  //The output file is loaded once per function and shared by all of its inspection points. In main, it is loaded
+  //right after being opened. In other functions, it is loaded after the allocas of the entry block
+  Instruction* InsPoint = nullptr;
+  if(this->OutputFileStore && this->OutputFileStore->getFunction() == &F)
+    InsPoint = this->OutputFileStore->getNextNode();
+  else{
+    InsPoint = &*F.getEntryBlock().getFirstInsertionPt();
+    while(isa<AllocaInst>(InsPoint))
+      InsPoint = InsPoint->getNextNode();
+  }
+  
+  IRBuilder<> Builder(InsPoint);
+  return Builder.CreateLoad(this->OutputFile);
+}
+
+Instruction* MemoryMonitor::GetHoistingPoint(std::vector<Value*> Operands, Instruction* InsPoint){
+  //Code that depends only on values defined outside the function goes to the entry block. Otherwise, it goes right
+  //after the last definition among the operands, provided that definition is dominated by all the others.
+  //If there is no such point, the code cannot be hoisted and we return null
+  Function* F = InsPoint->getFunction();
+  DominatorTree& DT = GetDominatorTree(*F);
+  Instruction* Last = nullptr;
+  for(Value* Operand : Operands){
+    Instruction* Def = dyn_cast<Instruction>(Operand);
+    if(!Def)
+      continue;
+    if(!Last || DT.dominates(Last, Def))
+      Last = Def;
+    else if(!DT.dominates(Def, Last))
+      return nullptr;
+  }
+  
+  if(!Last){
+    Instruction* EntryPoint = &*F->getEntryBlock().getFirstInsertionPt();
+    while(isa<AllocaInst>(EntryPoint))
+      EntryPoint = EntryPoint->getNextNode();
+    return EntryPoint;
+  }
+  if(isa<PHINode>(Last))
+    return &*Last->getParent()->getFirstInsertionPt();
+  if(Last->isTerminator())
+    return nullptr;
+  return Last->getNextNode();
+}
+
+DominatorTree& MemoryMonitor::GetDominatorTree(Function& F){
+  //Instructions inserted in existing blocks do not change the tree, so it is rebuilt only after the blocks change
+  if(!this->DomTree || this->DomTree->getRoot()->getParent() != &F)
+    this->DomTree.reset(new DominatorTree(F));
+  return *this->DomTree;
+}
+
+std::string MemoryMonitor::GetProgramName(){
+  if(SeparateUnit && !UnitProgram.empty())
+    return UnitProgram;
+  return this->M->getSourceFileName();
 }
 
 void MemoryMonitor::CloseOutputFile(Value* OutputFilePtr, IRBuilder<> Builder){
+  //In separate compilation, the runtime closes the output file at the exit of the program
+  if(SeparateUnit)
+    return;
+  
+  //Snapshots still running must be merged into the output file before it is closed
+  if(ForkSnapshot){
+    std::vector<Type*> ArgsType;
+    std::vector<Value*> Args;
+    ArgsType.push_back(this->OutputFileType);
+    Args.push_back(OutputFilePtr);
+    InsertFunctionCall("WhiroWaitSnapshots", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  }
+  
+  //The index goes after the last report
+  if(Indexed){
+    std::vector<Type*> ArgsType;
+    std::vector<Value*> Args;
+    ArgsType.push_back(this->OutputFileType);
+    Args.push_back(OutputFilePtr);
+    InsertFunctionCall("WhiroWriteIndex", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  }
+  
   FunctionCallee FcloseCall = M->getOrInsertFunction("fclose", Builder.getInt32Ty(), this->OutputFileType);
   Builder.CreateCall(FcloseCall, OutputFilePtr);
 }
 
+void MemoryMonitor::SetIndexedOutput(IRBuilder<> Builder){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(Builder.getInt32Ty());
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), IndexBlock));
+  InsertFunctionCall("WhiroSetIndexedOutput", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
+void MemoryMonitor::IndexInspectionPoint(Value* OutputFilePtr, Value* CallCounter, IRBuilder<> Builder){
+  //Points are indexed by their function and call counter. Points inside functions are told apart by their source line.
+  //In the checking mode, the point is looked up in the index of the reference instead
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(this->OutputFileType);
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt64Ty());
+  Args.push_back(OutputFilePtr);
+  Args.push_back(Builder.CreateGlobalStringPtr(Builder.GetInsertBlock()->getParent()->getName().str() + this->PointTag, "str"));
+  Args.push_back(CallCounter);
+  InsertFunctionCall(CheckReference.empty() ? "WhiroIndexPoint" : "WhiroCheckPoint", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
+void MemoryMonitor::SetSnapshotMode(IRBuilder<> Builder){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt32Ty());
+  
+  Args.push_back(Builder.CreateGlobalStringPtr(StringRef(GetProgramName() + "_Output"), "str"));
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), ForkLimit));
+  InsertFunctionCall("WhiroSetSnapshotMode", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
+std::pair<BasicBlock*, BasicBlock*> MemoryMonitor::GuardInspectionPoint(Instruction* Before, Instruction* End, std::function<Value*(IRBuilder<>&)> Condition){
+  //The inspection point is made of the instructions between Before and End. If there are none, there is nothing to guard
+  Instruction* Begin = Before->getNextNode();
+  if(Begin == End)
+    return std::make_pair(nullptr, nullptr);
+  
+  //Split the blocks so the inspection point runs only if the condition holds. The inspection point may span many
+  //blocks, if parts of it are already guarded
+  BasicBlock* Head = Before->getParent();
+  this->DomTree.reset();
+  BasicBlock* Inspection = SplitBlock(Head, Begin);
+  BasicBlock* Last = End->getParent();
+  BasicBlock* Tail = SplitBlock(Last, End);
+  
+  IRBuilder<> Builder(Head->getTerminator());
+  Builder.CreateCondBr(Condition(Builder), Inspection, Tail);
+  Head->getTerminator()->eraseFromParent();
+  return std::make_pair(Inspection, Last);
+}
+
+void MemoryMonitor::SnapshotInspectionPoint(Instruction* Marker, Instruction* EndMarker, Value* OutputFilePtr){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(this->OutputFileType);
+  Args.push_back(OutputFilePtr);
+  
+  //The inspection point runs only if WhiroBeginSnapshot says so
+  std::pair<BasicBlock*, BasicBlock*> Inspection = GuardInspectionPoint(Marker, EndMarker, [&](IRBuilder<>& Builder){
+    Value* Report = InsertFunctionCall("WhiroBeginSnapshot", Builder.getInt32Ty(), ArgsType, Args, Builder, false);
+    return Builder.CreateICmpNE(Report, Builder.getInt32(0));
+  });
+  if(!Inspection.first)
+    return;
+  
+  IRBuilder<> Builder(Inspection.second->getTerminator());
+  InsertFunctionCall("WhiroEndSnapshot", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
+void MemoryMonitor::GuardStatic(Instruction* Marker, Instruction* EndMarker, int Id){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(Type::getInt32Ty(this->M->getContext()));
+  Args.push_back(ConstantInt::get(Type::getInt32Ty(this->M->getContext()), Id));
+  
+  //The static variable is reported only if it changed since the last inspection point
+  GuardInspectionPoint(Marker, EndMarker, [&](IRBuilder<>& Builder){
+    Value* Changed = InsertFunctionCall("WhiroStaticChanged", Builder.getInt32Ty(), ArgsType, Args, Builder, false);
+    return Builder.CreateICmpNE(Changed, Builder.getInt32(0));
+  });
+}
+
+void MemoryMonitor::TrackStatics(IRBuilder<> Builder){
+  //Only static variables whose report does not depend on other memory, i.e., variables without pointers, are tracked
+  const DataLayout &DL = this->M->getDataLayout();
+  for(auto &g : this->StaticMap){
+    DIVariable* Var = g.second.first;
+    GlobalVariable* G = dyn_cast<GlobalVariable>(g.second.second);
+    if(!G || HasPointers(Var->getType()))
+      continue;
+    
+    std::vector<Type*> ArgsType;
+    std::vector<Value*> Args;
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    ArgsType.push_back(Builder.getInt64Ty());
+    Args.push_back(CastPointerToVoid(G, Builder));
+    Args.push_back(ConstantInt::get(Builder.getInt64Ty(), DL.getTypeAllocSize(G->getValueType())));
+    InsertFunctionCall("WhiroTrackStatic", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+    
+    int Id = this->StaticIds.size();
+    this->StaticIds[g.first] = Id;
+  }
+}
+
+bool MemoryMonitor::HasPointers(DIType* DIT){
+  if(!DIT)
+    return false;
+  
+  if(DIDerivedType* DIDT = dyn_cast<DIDerivedType>(DIT)){
+    if(DIDT->getTag() == dwarf::DW_TAG_pointer_type || DIDT->getTag() == dwarf::DW_TAG_reference_type)
+      return true;
+    return HasPointers(DIDT->getBaseType());
+  }
+  
+  if(DICompositeType* DICT = dyn_cast<DICompositeType>(DIT)){
+    if(DICT->getTag() == dwarf::DW_TAG_array_type)
+      return HasPointers(DICT->getBaseType());
+    for(auto Element : DICT->getElements()){
+      if(DIType* Member = dyn_cast<DIType>(Element)){
+        if(HasPointers(Member))
+          return true;
+      }
+    }
+    return false;
+  }
+  
+  return isa<DISubroutineType>(DIT);
+}
+
+CallInst* MemoryMonitor::SetCallCounters(IRBuilder<> Builder){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(Builder.getInt32Ty());
+  ArgsType.push_back(Builder.getInt8PtrTy()->getPointerTo());
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), 0));
+  Args.push_back(ConstantPointerNull::get(Builder.getInt8PtrTy()->getPointerTo()));
+  CallInst* SetCounters = nullptr;
+  //In separate compilation, the counters of each unit are appended to the counters of the program when the unit is
+  //loaded, and the runtime tells where they begin and the index of the unit, with which its blocks are allocated
+  if(SeparateUnit){
+    IRBuilder<> UnitBuilder(this->UnitConstructor->getEntryBlock().getTerminator());
+    this->CounterBase = new GlobalVariable(*(this->M), Builder.getInt32Ty(), false, GlobalValue::InternalLinkage, ConstantInt::get(Builder.getInt32Ty(), 0), "WhiroCounterBase");
+    this->CounterUnit = new GlobalVariable(*(this->M), Builder.getInt32Ty(), false, GlobalValue::InternalLinkage, ConstantInt::get(Builder.getInt32Ty(), 0), "WhiroCounterUnit");
+    ArgsType.push_back(Builder.getInt32Ty()->getPointerTo());
+    ArgsType.push_back(Builder.getInt32Ty()->getPointerTo());
+    Args.push_back(this->CounterBase);
+    Args.push_back(this->CounterUnit);
+    SetCounters = InsertFunctionCall("WhiroRegisterCounters", Builder.getVoidTy(), ArgsType, Args, UnitBuilder, false);
+  }
+  else
+    SetCounters = InsertFunctionCall("WhiroSetCounters", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  
+  //The profile is written next to the output file
+  if(CallProfile){
+    ArgsType.clear();
+    Args.clear();
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    Args.push_back(Builder.CreateGlobalStringPtr(StringRef(GetProgramName() + "_Profile"), "str"));
+    InsertFunctionCall("WhiroSetCallProfile", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  }
+  return SetCounters;
+}
+
+void MemoryMonitor::FinishCallCounters(CallInst* SetCounters){
+  IRBuilder<> Builder(SetCounters);
+  std::vector<Constant*> Names;
+  for(auto &Name : this->CounterNames)
+    Names.push_back(cast<Constant>(Builder.CreateGlobalStringPtr(Name, "str")));
+  ArrayType* NamesType = ArrayType::get(Builder.getInt8PtrTy(), Names.size());
+  GlobalVariable* NamesTable = new GlobalVariable(*(this->M), NamesType, true, GlobalValue::PrivateLinkage, ConstantArray::get(NamesType, Names), "WhiroCounterNames");
+  
+  SetCounters->setArgOperand(0, ConstantInt::get(Builder.getInt32Ty(), this->CounterNames.size()));
+  SetCounters->setArgOperand(1, ConstantExpr::getPointerCast(NamesTable, Builder.getInt8PtrTy()->getPointerTo()));
+}
+
+void MemoryMonitor::SetWatchpoints(IRBuilder<> Builder){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt32Ty());
+  Args.push_back(Builder.CreateGlobalStringPtr(StringRef(GetProgramName() + "_Watch"), "str"));
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), WatchBuffer));
+  InsertFunctionCall("WhiroSetWatchpoints", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  
+  //Hardware breakpoints watch up to 8 bytes, so only scalars and pointers are watched
+  const DataLayout &DL = this->M->getDataLayout();
+  for(auto &Name : WatchVars){
+    std::map<std::string, std::pair<DIVariable*, Value*>>::iterator it = this->StaticMap.find(Name);
+    if(it == this->StaticMap.end()){
+      errs() << "Whiro could not find the static variable " << Name << " to watch it\n";
+      continue;
+    }
+    
+    DIType* VarType = it->second.first->getType();
+    while(isa<DIDerivedType>(VarType) && (VarType->getTag() == dwarf::DW_TAG_typedef || VarType->getTag() == dwarf::DW_TAG_const_type || VarType->getTag() == dwarf::DW_TAG_volatile_type))
+      VarType = dyn_cast<DIDerivedType>(VarType)->getBaseType();
+    int Format = GetTypeFormat(VarType);
+    GlobalVariable* G = dyn_cast<GlobalVariable>(it->second.second);
+    if(!G || Format < 1 || Format > 13){
+      errs() << "Whiro can only watch scalar and pointer variables. Skipping " << Name << "\n";
+      continue;
+    }
+    
+    ArgsType.clear();
+    Args.clear();
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    ArgsType.push_back(Builder.getInt64Ty());
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    ArgsType.push_back(Builder.getInt32Ty());
+    Args.push_back(CastPointerToVoid(G, Builder));
+    Args.push_back(ConstantInt::get(Builder.getInt64Ty(), DL.getTypeAllocSize(G->getValueType())));
+    Args.push_back(Builder.CreateGlobalStringPtr(Name, "str"));
+    Args.push_back(ConstantInt::get(Builder.getInt32Ty(), Format));
+    InsertFunctionCall("WhiroWatchStatic", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  }
+}
+
+void MemoryMonitor::SetHashTree(IRBuilder<> Builder){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(Builder.getInt64Ty());
+  ArgsType.push_back(Builder.getInt64Ty());
+  ArgsType.push_back(Builder.getInt32Ty());
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  Args.push_back(ConstantInt::get(Builder.getInt64Ty(), HashTree));
+  Args.push_back(ConstantInt::get(Builder.getInt64Ty(), HashTreeChunk));
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), HashTreeWorkers));
+  //The trees are written next to the output file
+  if(HashTreeFile)
+    Args.push_back(Builder.CreateGlobalStringPtr(StringRef(GetProgramName() + "_Trees"), "str"));
+  else
+    Args.push_back(ConstantPointerNull::get(Builder.getInt8PtrTy()));
+  InsertFunctionCall("WhiroSetHashTree", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
+void MemoryMonitor::SetParallelHeap(IRBuilder<> Builder){
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(Builder.getInt32Ty());
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), HeapWorkers));
+  InsertFunctionCall("WhiroSetParallelHeap", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
 bool MemoryMonitor::ShouldProcessType(DIType *DIT){
   if(!DIT)
     return true;
@@ -354,134 +770,279 @@ std::string MemoryMonitor::MakeTypeName(Type* T){
   return TypeName;  
 }
 
-void MemoryMonitor::WriteTypeDescriptor(const char* TypeName, int QuantFields, int Format, int Offset, int BaseTypeIndex, FILE* TypeTableFile, int* TypeTableSize, DINodeArray Fields){
+//The structural hashes identify types across translation units, so they are computed with FNV-1a, whose
+//result does not depend on the process that computes it
+static uint64_t HashBytes(uint64_t Hash, const void* Data, size_t Size){
+  const unsigned char* Bytes = (const unsigned char*) Data;
+  for(size_t i = 0; i < Size; i++){
+    Hash ^= Bytes[i];
+    Hash *= 1099511628211ULL;
+  }
+  return Hash;
+}
+
+static uint64_t HashValue(uint64_t Hash, uint64_t Value){
+  return HashBytes(Hash, &Value, sizeof(Value));
+}
+
+static uint64_t HashValue(uint64_t Hash, StringRef Value){
+  return HashValue(HashBytes(Hash, Value.data(), Value.size()), Value.size());
+}
+
+//Typedefs and qualified types might not carry the size of the type they name, so it is taken from their base type
+static uint64_t GetDebugTypeSize(DIType* DIT){
+  while(DIDerivedType* DIDT = dyn_cast_or_null<DIDerivedType>(DIT)){
+    if(DIDT->getSizeInBits() > 0 || DIDT->getTag() == dwarf::DW_TAG_pointer_type)
+      break;
+    DIT = DIDT->getBaseType();
+  }
+  return DIT ? DIT->getSizeInBits() : 0;
+}
+
+//Arrays of arrays, such as arrays of typedef'd rows, are hashed as a single array of scalars. This returns the innermost
+//array type, whose elements are not arrays
+static DICompositeType* GetInnermostArrayType(DICompositeType* ArrayType){
+  DIType* Base = ArrayType->getBaseType();
+  while(DIDerivedType* DIDT = dyn_cast_or_null<DIDerivedType>(Base)){
+    if(DIDT->getTag() != dwarf::DW_TAG_typedef && DIDT->getTag() != dwarf::DW_TAG_const_type && DIDT->getTag() != dwarf::DW_TAG_volatile_type)
+      break;
+    Base = DIDT->getBaseType();
+  }
+  DICompositeType* Row = dyn_cast_or_null<DICompositeType>(Base);
+  if(Row && Row->getTag() == dwarf::DW_TAG_array_type)
+    return GetInnermostArrayType(Row);
+  return ArrayType;
+}
+
+//Unions and values that are not in the Type Table are reported as raw bytes. Pointers to functions are not, since
+//their addresses change from run to run
+static int GetRawSize(DIType* DIT){
+  for(DIType* Base = DIT; Base; ){
+    if(isa<DISubroutineType>(Base))
+      return 0;
+    DIDerivedType* DIDT = dyn_cast<DIDerivedType>(Base);
+    Base = DIDT ? DIDT->getBaseType() : nullptr;
+  }
+  return (int)(GetDebugTypeSize(DIT) / 8);
+}
+
+uint64_t MemoryMonitor::HashType(DIType* DIT, bool Shallow){
+  const uint64_t Seed = 14695981039346656037ULL;
+  if(!DIT)
+    return HashValue(Seed, StringRef("void"));
+  
+  std::map<DIType*, uint64_t> &Hashes = Shallow ? this->ShallowTypeHashes : this->TypeHashes;
+  std::map<DIType*, uint64_t>::iterator It = Hashes.find(DIT);
+  if(It != Hashes.end())
+    return It->second;
+  
+  uint64_t Hash = HashValue(HashValue(HashValue(HashValue(Seed, DIT->getTag()), DIT->getName()), DIT->getSizeInBits()), DIT->getOffsetInBits());
+  if(DIBasicType* DIBT = dyn_cast<DIBasicType>(DIT))
+    Hash = HashValue(Hash, DIBT->getEncoding());
+  else if(DIDerivedType* DIDT = dyn_cast<DIDerivedType>(DIT))
+    Hash = HashValue(Hash, HashType(DIDT->getBaseType(), Shallow));
+  else if(DICompositeType* DICT = dyn_cast<DICompositeType>(DIT)){
+    Hash = HashValue(Hash, DICT->getElements().size());
+    if(DICT->getTag() == dwarf::DW_TAG_array_type && DICT->getElements().size() > 0){
+      //The descriptor of an array holds its number of elements, if it is constant
+      auto Count = dyn_cast<DISubrange>(DICT->getElements()[0])->getCount();
+      if(Count.is<ConstantInt*>())
+        Hash = HashValue(Hash, Count.get<ConstantInt*>()->getSExtValue());
+      Hash = HashValue(Hash, HashType(DICT->getBaseType(), Shallow));
+    }
+    else if(!Shallow){
+      //The members of a composite type are hashed up to the composite types they reach, so recursive types
+      //are hashed in a finite number of steps
+      for(auto Element : DICT->getElements()){
+        if(DIDerivedType* Member = dyn_cast<DIDerivedType>(Element))
+          Hash = HashValue(HashValue(HashValue(Hash, Member->getName()), Member->getOffsetInBits()), HashType(Member->getBaseType(), true));
+      }
+    }
+  }
+  
+  Hashes[DIT] = Hash;
+  return Hash;
+}
+
+TypeDescriptorEntry MemoryMonitor::BuildTypeDescriptor(DIType* DIT){
+  TypeDescriptorEntry Descriptor;
+  Descriptor.Processed = ShouldProcessType(DIT);
+  if(!Descriptor.Processed)
+    return Descriptor;
+  
+  Descriptor.Name = MakeTypeName(DIT);
+  //If the name of the type is greater than 128 characters, we truncate it
+  if(Descriptor.Name.size() > 128)
+    Descriptor.Name = Descriptor.Name.substr(0, 125) + "...";
+  Descriptor.Format = GetTypeFormat(DIT);
+  Descriptor.QuantFields = 1;
+  Descriptor.Offset = 0;
+  Descriptor.Valid = true;
+  
+  if(DICompositeType* DICT = dyn_cast_or_null<DICompositeType>(DIT)){
+    switch(DICT->getTag()){
+      case dwarf::DW_TAG_array_type:{
+        //The descriptor of an array holds its number of elements, in all of its dimensions
+        Descriptor.Offset = 1;
+        for(auto Subrange : DICT->getElements()){
+          auto Count = dyn_cast<DISubrange>(Subrange)->getCount();
+          if(Count.is<ConstantInt*>())
+            Descriptor.Offset *= Count.get<ConstantInt*>()->getSExtValue();
+        }
+        break;
+      }
+        
+      case dwarf::DW_TAG_structure_type:{
+        DINodeArray Fields = DICT->getElements();
+        Descriptor.QuantFields = (int)Fields.size();
+        for(unsigned i = 0; i < Fields.size(); i++){
+          DIDerivedType* Field = dyn_cast<DIDerivedType>(Fields[i]);
+          std::string FieldName = Field->getName().str();
+          //If the name of the field is greater than 128 characters, we truncate it
+          if(FieldName.size() > 128)
+            FieldName = FieldName.substr(0, 125) + "...";
+          //Fields whose type is not in the Type Table have format 18
+          int FieldFormat = ShouldProcessType(Field->getBaseType()) ? GetTypeFormat(Field->getBaseType()) : 18;
+          Descriptor.Fields.push_back(std::make_tuple(FieldName, FieldFormat, (int)(Field->getOffsetInBits() / 8)));
+        }
+        break;
+      }
+        
+      default:
+        break;
+    }
+  }
+  else if(DIT && !isa<DIBasicType>(DIT) && !isa<DIDerivedType>(DIT)){
+    #define DEBUG_TYPE "tt"
+    LLVM_DEBUG(dbgs() << "Not creating " << Descriptor.Name <<".\n"; DIT->dump(););
+    #undef DEBUG_TYPE 
+    Descriptor.Valid = false;
+  }
+  return Descriptor;
+}
+
+const TypeDescriptorEntry& MemoryMonitor::GetTypeDescriptor(DIType* DIT){
+  uint64_t Hash = HashType(DIT, false);
+  if(!SharedDescriptors){
+    std::map<uint64_t, TypeDescriptorEntry>::iterator It = this->Descriptors.find(Hash);
+    if(It == this->Descriptors.end())
+      It = this->Descriptors.insert(std::make_pair(Hash, BuildTypeDescriptor(DIT))).first;
+    return It->second;
+  }
+  
+  //The shared descriptors are never erased, so the references to them remain valid
+  {
+    std::lock_guard<std::mutex> Guard(SharedDescriptorsLock);
+    std::map<uint64_t, TypeDescriptorEntry>::iterator It = SharedDescriptorsCache.find(Hash);
+    if(It != SharedDescriptorsCache.end())
+      return It->second;
+  }
+  TypeDescriptorEntry Descriptor = BuildTypeDescriptor(DIT);
+  std::lock_guard<std::mutex> Guard(SharedDescriptorsLock);
+  return SharedDescriptorsCache.insert(std::make_pair(Hash, std::move(Descriptor))).first->second;
+}
+
+void MemoryMonitor::ShareTypeDescriptors(){
+  SharedDescriptors = true;
+}
+
+int MemoryMonitor::GetDebugTypeIndex(DIType* DIT, int Default){
+  std::map<DIType*, int>::iterator It = this->DebugTypeIndexes.find(DIT);
+  return It != this->DebugTypeIndexes.end() ? It->second : Default;
+}
+
+void MemoryMonitor::WriteTypeDescriptor(const TypeDescriptorEntry &Descriptor, DIType* DIT, FILE* TypeTableFile, int* TypeTableSize){
   #define DEBUG_TYPE "tt"
-  LLVM_DEBUG(dbgs() << "Creating type table entry " << TypeName <<". Number of Fields = " << QuantFields <<"\n";);
+  LLVM_DEBUG(dbgs() << "Creating type table entry " << Descriptor.Name <<". Number of Fields = " << Descriptor.QuantFields <<"\n";);
   #undef DEBUG_TYPE
-  fwrite(TypeName, sizeof(char), 129, TypeTableFile);
-  fwrite(&QuantFields, sizeof(int), 1, TypeTableFile);
+  //In separate compilation, every entry begins with the structural hash of its type, by which the runtime merges
+  //the Type Tables of the units
+  if(SeparateUnit){
+    uint64_t Hash = HashType(DIT, false);
+    fwrite(&Hash, sizeof(uint64_t), 1, TypeTableFile);
+  }
+  //Names are written in 129 bytes, padded with zeros
+  char Name[129] = {0};
+  strncpy(Name, Descriptor.Name.c_str(), 128);
+  fwrite(Name, sizeof(char), 129, TypeTableFile);
+  fwrite(&Descriptor.QuantFields, sizeof(int), 1, TypeTableFile);
   (*TypeTableSize)++;
   
-  if(Fields.size() > 0){
+  if(Descriptor.Fields.size() > 0){
+    DINodeArray Fields = dyn_cast<DICompositeType>(DIT)->getElements();
     for(unsigned i = 0; i < Fields.size(); i++){
       DIDerivedType* Field = dyn_cast<DIDerivedType>(Fields[i]);
-      std::string FieldName = Field->getName().str();
-      int FieldFormat = GetTypeFormat(Field->getBaseType());
-      int FieldBaseTypeIndex = FieldFormat;
-      if(!ShouldProcessType(Field->getBaseType()))
-        FieldFormat = FieldBaseTypeIndex = 18;
-      else if(DIDerivedType* DIDT = dyn_cast<DIDerivedType>(Field->getBaseType())){
-        //Get the base type index for this type          
-        for(auto &T : this->TypeIndexes){
-          if(std::get<2>(T) == DIDT->getBaseType()){
-            FieldBaseTypeIndex = std::get<1>(T);
-            break;
-          }
+      int FieldFormat = std::get<1>(Descriptor.Fields[i]);
+      int FieldOffset = std::get<2>(Descriptor.Fields[i]);
+      int FieldBaseTypeIndex = -1;
+      //The base types are resolved in the Type Table of this module
+      if(FieldFormat != 18){
+        if(DIDerivedType* DIDT = dyn_cast_or_null<DIDerivedType>(Field->getBaseType()))
+          FieldBaseTypeIndex = GetDebugTypeIndex(DIDT->getBaseType(), -1);
+        else if(DICompositeType* DICT = dyn_cast_or_null<DICompositeType>(Field->getBaseType())){
+          //If a field within an struct type is an array, we use the base type index to access the type descriptor
+          //of that array
+          if(DICT->getTag() == dwarf::DW_TAG_array_type)
+            FieldBaseTypeIndex = GetDebugTypeIndex(Field->getBaseType(), -1);
         }
       }
-      else if(DICompositeType* DICT = dyn_cast<DICompositeType>(Field->getBaseType())){
-        //If a field within an struct type is an array of scalars, we use the base type index to access the 
-        //type descriptor of that array
-        if(DICT->getTag() == dwarf::DW_TAG_array_type && isa<DIBasicType>(DICT->getBaseType())){
-          for(auto &T : this->TypeIndexes){
-            if(std::get<2>(T) == Field->getBaseType()){
-              FieldBaseTypeIndex = std::get<1>(T);
-              break;
-            }
-          }
-        }
+      //Base types that are not in the Type Table are given by the format of the field
+      int Local = FieldBaseTypeIndex >= 0;
+      if(!Local)
+        FieldBaseTypeIndex = FieldFormat;
+      //Unions and non-inspectable values are reported as raw bytes, so they keep their size instead
+      if(FieldFormat == 16 || FieldFormat == 18){
+        FieldBaseTypeIndex = GetRawSize(Field->getBaseType());
+        Local = 0;
       }
       
-      int FieldOffset = (int)(Field->getOffsetInBits() / 8);
-      //If the name of the field is greater than 128 characters, we truncate it
-      if(FieldName.size() > 128)
-        FieldName = FieldName.substr(0, 125) + "...";
-      
       #define DEBUG_TYPE "tt"
-      LLVM_DEBUG(dbgs() << "Field Name: " << FieldName << " Format: " << FieldFormat << " Offset: " << FieldOffset << " Base Type Index: " << FieldBaseTypeIndex << "\n";);
+      LLVM_DEBUG(dbgs() << "Field Name: " << std::get<0>(Descriptor.Fields[i]) << " Format: " << FieldFormat << " Offset: " << FieldOffset << " Base Type Index: " << FieldBaseTypeIndex << "\n";);
       #undef DEBUG_TYPE
-      fwrite(FieldName.c_str(), sizeof(char), 129, TypeTableFile);
+      char FieldName[129] = {0};
+      strncpy(FieldName, std::get<0>(Descriptor.Fields[i]).c_str(), 128);
+      fwrite(FieldName, sizeof(char), 129, TypeTableFile);
       fwrite(&FieldFormat ,sizeof(int), 1, TypeTableFile);
       fwrite(&FieldOffset ,sizeof(int), 1, TypeTableFile);
       fwrite(&FieldBaseTypeIndex ,sizeof(int), 1, TypeTableFile);
+      //In separate compilation, the runtime must know which base types are indexes of this Type Table
+      if(SeparateUnit)
+        fwrite(&Local, sizeof(int), 1, TypeTableFile);
     }
    }
    else{
+     int BaseTypeIndex = -1;
+     //Get the base type index for this type. The base type of an array is the type of its elements
+     if(DIDerivedType* DIDT = dyn_cast_or_null<DIDerivedType>(DIT))
+       BaseTypeIndex = GetDebugTypeIndex(DIDT->getBaseType(), -1);
+     else if(DICompositeType* DICT = dyn_cast_or_null<DICompositeType>(DIT)){
+       if(DICT->getTag() == dwarf::DW_TAG_array_type)
+         BaseTypeIndex = GetDebugTypeIndex(DICT->getBaseType(), -1);
+     }
+     int Local = BaseTypeIndex >= 0;
+     if(!Local)
+       BaseTypeIndex = Descriptor.Format;
+     if(Descriptor.Format == 16 || Descriptor.Format == 18){
+       BaseTypeIndex = GetRawSize(DIT);
+       Local = 0;
+     }
      #define DEBUG_TYPE "tt"
-     LLVM_DEBUG(dbgs() << "Format: " << Format << " Offset: " << Offset << " Base: " << BaseTypeIndex <<"\n";);
+     LLVM_DEBUG(dbgs() << "Format: " << Descriptor.Format << " Offset: " << Descriptor.Offset << " Base: " << BaseTypeIndex <<"\n";);
      #undef DEBUG_TYPE
-     fwrite("", sizeof(char), 129, TypeTableFile);
-     fwrite(&Format, sizeof(int), 1, TypeTableFile);
-     fwrite(&Offset, sizeof(int), 1, TypeTableFile);
+     char Empty[129] = {0};
+     fwrite(Empty, sizeof(char), 129, TypeTableFile);
+     fwrite(&Descriptor.Format, sizeof(int), 1, TypeTableFile);
+     fwrite(&Descriptor.Offset, sizeof(int), 1, TypeTableFile);
      fwrite(&BaseTypeIndex ,sizeof(int), 1, TypeTableFile);
+     if(SeparateUnit)
+       fwrite(&Local, sizeof(int), 1, TypeTableFile);
    }
 }
 
 void MemoryMonitor::CreateTypeDescriptor(DIType* DIT, FILE* TypeTableFile, int* TypeTableSize){
-  DINodeArray Fields;
-  std::string TypeName = MakeTypeName(DIT);
-  int Format = GetTypeFormat(DIT);
-  int BaseTypeIndex = Format;
-  int QuantFields;
-  int Offset;
-  
-  //Void type
-  if(!DIT){
-    QuantFields = 1;
-    Offset = 0;
-  }
-  else if(isa<DIBasicType>(DIT)){
-    QuantFields = 1;
-    Offset = 0;
-  }
-  else if(DIDerivedType* DIDT = dyn_cast<DIDerivedType>(DIT)){
-    //Get the base type index for this type          
-    for(auto &T : this->TypeIndexes){
-      if(std::get<2>(T) == DIDT->getBaseType()){
-        BaseTypeIndex = std::get<1>(T);
-        break;
-      }
-    }
-    QuantFields = 1;
-    Offset = 0;
-  }
-  else if(DICompositeType* DICT = dyn_cast<DICompositeType>(DIT)){
-    switch(DICT->getTag()){
-      case dwarf::DW_TAG_array_type:{
-        //Format = BaseTypeIndex = getTypeFormat(DICT->getBaseType());
-        QuantFields = 1;
-        auto Count = dyn_cast<DISubrange>(DICT->getElements()[0])->getCount();
-        Offset = Count.get<ConstantInt*>()->getSExtValue(); 
-        break;
-      }
-        
-      case dwarf::DW_TAG_structure_type:
-        Fields = DICT->getElements();
-        QuantFields = (int)Fields.size();
-        break;
-        
-      case dwarf::DW_TAG_union_type:
-        QuantFields = 1;
-        Offset = (DICT->getSizeInBits() / 8);
-        break;
-        
-      case dwarf::DW_TAG_enumeration_type:
-        QuantFields = 1;
-        Offset = 0;
-        break;
-      
-      default:
-        break;
-    }
-  }
-  else{
-    #define DEBUG_TYPE "tt"
-    LLVM_DEBUG(dbgs() << "Not creating " << TypeName <<".\n"; DIT->dump(););
-    #undef DEBUG_TYPE 
-    return;
-  }
-  
-  WriteTypeDescriptor(TypeName.c_str(), QuantFields, Format, Offset, BaseTypeIndex, TypeTableFile, TypeTableSize, Fields);
+  const TypeDescriptorEntry &Descriptor = GetTypeDescriptor(DIT);
+  if(Descriptor.Valid)
+    WriteTypeDescriptor(Descriptor, DIT, TypeTableFile, TypeTableSize);
 }
 
 std::pair<std::string, int> MemoryMonitor::CreateTypeTable(){  
@@ -489,22 +1050,23 @@ std::pair<std::string, int> MemoryMonitor::CreateTypeTable(){
   std::size_t ExtensionIndex = TypeTableFileName.rfind('.');
   TypeTableFileName.erase(ExtensionIndex);
   TypeTableFileName += "_TypeTable.bin";
-  FILE* TypeTableFile = fopen(TypeTableFileName.c_str(), "wb");
+  //The program opens the Type Table by the name above. It is written in the directory of the program, if it was given
+  SmallString<128> TypeTablePath(TypeTableFileName);
+  if(!this->WorkingDirectory.empty())
+    sys::fs::make_absolute(this->WorkingDirectory, TypeTablePath);
+  FILE* TypeTableFile = fopen(TypeTablePath.c_str(), "wb");
   
   int TypeIndex = 0;
   
   //First, construct the type indexes
   for(DIType* DIT : this->DbgFinder.types()){
-    
-    if(!ShouldProcessType(DIT))
+    const TypeDescriptorEntry &Descriptor = GetTypeDescriptor(DIT);
+    if(!Descriptor.Processed)
       continue;
-    
-    std::string TypeName = MakeTypeName(DIT);
-    //If the name of the type is greater than 128 characters, we truncate it
-    if(TypeName.size() > 128)
-      TypeName = TypeName.substr(0, 125) + "...";
    
-    this->TypeIndexes.push_back(std::make_tuple(TypeName, TypeIndex, DIT));
+    this->TypeIndexes.push_back(std::make_tuple(Descriptor.Name, TypeIndex, DIT));
+    //The first entry of a debug type is the one its users refer to
+    this->DebugTypeIndexes.insert(std::make_pair(DIT, TypeIndex));
     TypeIndex++;
   }
   
@@ -536,8 +1098,12 @@ void MemoryMonitor::OpenTypeTable(std::string ProgramName, int Size, IRBuilder<>
   ArgsType.push_back(Builder.getInt32Ty());
   ArgsType.push_back(Builder.getInt32Ty());
   
-  Args.push_back(Builder.CreateGlobalStringPtr(StringRef(ProgramName), "str"));
-  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), Size));
+  //In separate compilation, the Type Tables are registered by the units, so main only sets the usage mode
+  if(SeparateUnit)
+    Args.push_back(ConstantPointerNull::get(Builder.getInt8PtrTy()));
+  else
+    Args.push_back(Builder.CreateGlobalStringPtr(StringRef(ProgramName), "str"));
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), SeparateUnit ? 0 : Size));
   ConstantInt* Heap = InsHeap ? ConstantInt::get(Builder.getInt32Ty(), 1) : ConstantInt::get(Builder.getInt32Ty(), 0);
   ConstantInt* Stack = InsStack ? ConstantInt::get(Builder.getInt32Ty(), 1) : ConstantInt::get(Builder.getInt32Ty(), 0);
   ConstantInt* PreciseMode = TrackPtr ? ConstantInt::get(Builder.getInt32Ty(), 1) : ConstantInt::get(Builder.getInt32Ty(), 0);
@@ -547,29 +1113,165 @@ void MemoryMonitor::OpenTypeTable(std::string ProgramName, int Size, IRBuilder<>
   InsertFunctionCall("WhiroOpenTypeTable", Builder.getVoidTy(), ArgsType, Args, Builder, false);
 }
 
-Value* MemoryMonitor::CreateFunctionCounter(Function* F, IRBuilder<> Builder){
-  //The function counter is global.
-  std::string CounterName = F->getName().str() + "_counter";
-  GlobalVariable* Counter = new GlobalVariable(*(this->M), Builder.getInt32Ty(), false, GlobalValue::CommonLinkage, Constant::getNullValue(Builder.getInt32Ty()), CounterName);
-  Counter->setName(CounterName);
-  Counter->setDSOLocal(true);
-  
-  //The increment of that counter is inserted at the beginning of the function.
-  Builder.SetInsertPoint(&F->getEntryBlock(), F->getEntryBlock().getFirstNonPHI()->getIterator());
-  //To store a value in static memory, we first need to load it.
-  Value* CounterLoad = Builder.CreateLoad(Counter, Counter->getName());
-  Value* CounterInc = Builder.CreateNSWAdd(CounterLoad, ConstantInt::get(Builder.getInt32Ty(), 1));
+void MemoryMonitor::RegisterTypeTable(std::string TypeTableName, int Size){
+  //The runtime appends the entries of this unit that are new to the program, and maps the indexes of this unit to
+  //the indexes of the program
+  IRBuilder<> Builder(this->UnitConstructor->getEntryBlock().getTerminator());
+  ArrayType* MapType = ArrayType::get(Builder.getInt32Ty(), std::max<size_t>(this->TypeIndexes.size(), 1));
+  this->TypeMap = new GlobalVariable(*(this->M), MapType, false, GlobalValue::InternalLinkage, Constant::getNullValue(MapType), "WhiroTypeMap");
+  
+  std::vector<Type*>ArgsType;
+  std::vector<Value*>Args;
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt32Ty());
+  ArgsType.push_back(Builder.getInt32Ty()->getPointerTo());
+  Args.push_back(Builder.CreateGlobalStringPtr(StringRef(TypeTableName), "str"));
+  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), Size));
+  Args.push_back(Builder.CreateConstInBoundsGEP2_32(MapType, this->TypeMap, 0, 0));
+  InsertFunctionCall("WhiroRegisterTypeTable", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
+Value* MemoryMonitor::TypeIndexValue(int TypeIndex, IRBuilder<> &Builder){
+  //Negative indexes tell the runtime that the type is unknown, so they are not mapped
+  if(!SeparateUnit || TypeIndex < 0)
+    return ConstantInt::get(Builder.getInt32Ty(), TypeIndex);
+  Value* Entry = Builder.CreateConstInBoundsGEP2_32(this->TypeMap->getValueType(), this->TypeMap, 0, TypeIndex);
+  return Builder.CreateLoad(Entry);
+}
+
+void MemoryMonitor::SetHeapHashing(IRBuilder<> Builder){
+  std::vector<Type*>ArgsType;
+  std::vector<Value*>Args;
+  
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  Args.push_back(Builder.CreateGlobalStringPtr(StringRef(HashReference), "ref"));
+  InsertFunctionCall("WhiroSetHeapHashing", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
+Value* MemoryMonitor::LoadCounterBlock(Function& F){
+  //The counters live in a block of the running thread, indexed by the identifier of each counter. The block is
+  //loaded once at the beginning of the function, after the allocas (in main, after the settings of Whiro)
+  Instruction* InsPoint = this->MainBody;
+  if(!F.getName().equals("main")){
+    InsPoint = &*F.getEntryBlock().getFirstInsertionPt();
+    while(isa<AllocaInst>(InsPoint))
+      InsPoint = InsPoint->getNextNode();
+  }
+  
+  IRBuilder<> Builder(InsPoint);
+  PointerType* BlockType = Builder.getInt64Ty()->getPointerTo();
+  //In separate compilation, every unit has a block of its own in each thread, indexed from its first counter, so
+  //units loaded while the program runs do not need room in the blocks allocated before them
+  GlobalVariable* Counters = nullptr;
+  if(SeparateUnit){
+    Counters = this->M->getGlobalVariable("WhiroUnitCounters", true);
+    if(!Counters)
+      Counters = new GlobalVariable(*(this->M), BlockType, false, GlobalValue::InternalLinkage, ConstantPointerNull::get(BlockType), "WhiroUnitCounters", nullptr, GlobalValue::GeneralDynamicTLSModel);
+  }
+  else
+    Counters = GetThreadLocal("WhiroCounters", BlockType);
+  
+  //The first time a thread reaches an instrumented function, its block is allocated
+  BasicBlock* Head = InsPoint->getParent();
+  Value* Block = Builder.CreateLoad(Counters);
+  MDNode* Unlikely = MDBuilder(this->M->getContext()).createBranchWeights(1, 1000000);
+  this->DomTree.reset();
+  Instruction* Allocation = SplitBlockAndInsertIfThen(Builder.CreateICmpEQ(Block, ConstantPointerNull::get(BlockType)), InsPoint, false, Unlikely);
+  Builder.SetInsertPoint(Allocation);
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  Value* NewBlock = nullptr;
+  if(SeparateUnit){
+    ArgsType.push_back(Builder.getInt32Ty());
+    Args.push_back(Builder.CreateLoad(this->CounterUnit));
+    NewBlock = InsertFunctionCall("WhiroGetUnitCounterBlock", BlockType, ArgsType, Args, Builder, false);
+    Builder.CreateStore(NewBlock, Counters);
+  }
+  else
+    NewBlock = InsertFunctionCall("WhiroGetCounterBlock", BlockType, ArgsType, Args, Builder, false);
+  
+  PHINode* CounterBlock = PHINode::Create(BlockType, 2, "counters", InsPoint);
+  CounterBlock->addIncoming(Block, Head);
+  CounterBlock->addIncoming(NewBlock, Allocation->getParent());
+  return CounterBlock;
+}
+
+GlobalVariable* MemoryMonitor::GetThreadLocal(std::string Name, Type* VarType){
+  //Thread-local variables of the runtime are declared in the program, and defined when the runtime is linked
+  GlobalVariable* ThreadLocal = this->M->getGlobalVariable(Name);
+  if(!ThreadLocal)
+    ThreadLocal = new GlobalVariable(*(this->M), VarType, false, GlobalValue::ExternalLinkage, nullptr, Name, nullptr, GlobalValue::GeneralDynamicTLSModel);
+  return ThreadLocal;
+}
+
+void MemoryMonitor::TrackCurrentFunction(Function& F, Instruction* InsPoint){
+  //The identifier of the running function is the identifier of its counter. The caller's identifier is restored at the return
+  IRBuilder<> Builder(InsPoint);
+  GlobalVariable* CurrentFunction = GetThreadLocal("WhiroCurrentFunction", Builder.getInt32Ty());
+  Value* Caller = Builder.CreateLoad(CurrentFunction);
+  Value* Id = ConstantInt::get(Builder.getInt32Ty(), this->CounterNames.size() - 1);
+  if(SeparateUnit)
+    Id = Builder.CreateAdd(Builder.CreateLoad(this->CounterBase), Id);
+  Builder.CreateStore(Id, CurrentFunction);
+  for(BasicBlock &BB : F){
+    if(isa<ReturnInst>(BB.getTerminator())){
+      Builder.SetInsertPoint(BB.getTerminator());
+      Builder.CreateStore(Caller, CurrentFunction);
+    }
+  }
+}
+
+Value* MemoryMonitor::IncrementCounter(std::string CounterName, Instruction* InsPoint){
+  //Every counter has an identifier, which is its index in the counter blocks
+  unsigned Id = this->CounterNames.size();
+  this->CounterNames.push_back(CounterName);
+  
+  //Threads do not share counter blocks, so the increment needs no synchronization
+  IRBuilder<> Builder(InsPoint);
+  Value* Counter = Builder.CreateInBoundsGEP(Builder.getInt64Ty(), this->CurrentCounters, ConstantInt::get(Builder.getInt64Ty(), Id));
+  Value* CounterInc = Builder.CreateAdd(Builder.CreateLoad(Counter, CounterName), ConstantInt::get(Builder.getInt64Ty(), 1));
   Builder.CreateStore(CounterInc, Counter);
   return CounterInc;
-  
+}
+
+Value* MemoryMonitor::CreatePointCounter(std::string CounterName, Instruction* InsPoint, IRBuilder<> Builder){
+  //Inspection points inside functions have counters of their own
+  return IncrementCounter(CounterName, InsPoint);
+}
+
+std::string MemoryMonitor::GetScopeName(DIVariable* Var, IRBuilder<> Builder){
+  std::string Scope = (isa<DIGlobalVariable>(Var)) ? "(Static) " + Builder.GetInsertBlock()->getParent()->getName().str() : Var->getScope()->getName().str();
+  //Inspection points inside functions are told apart by their source line
+  return Scope + this->PointTag;
+}
+
+Value* MemoryMonitor::CreateFunctionCounter(Function* F, IRBuilder<> Builder){
+  //The increment of the function counter is inserted at the beginning of the function, right after its counter block is loaded
+  return IncrementCounter(F->getName().str(), cast<Instruction>(this->CurrentCounters)->getNextNode());
 }
 
 Value* MemoryMonitor::CastPointerToVoid(Value* Ptr, IRBuilder<> Builder){ 
   if(CastInst::isCastable(Ptr->getType(), Builder.getInt8PtrTy())){
+    //Constants, such as global variables, are casted without instructions
+    if(Constant* C = dyn_cast<Constant>(Ptr))
+      return ConstantExpr::getPointerCast(C, Builder.getInt8PtrTy());
+    
+    //A pointer is casted once, right after its definition, and the cast is reused by every inspection point
+    std::map<Value*, Value*>::iterator it = this->VoidCasts.find(Ptr);
+    if(it != this->VoidCasts.end())
+      return it->second;
+    
     //If the type of the pointee value is castable to void*, we get the best cast instruction to do it
     Instruction::CastOps CastOP = CastInst::getCastOpcode(Ptr, false, Builder.getInt8PtrTy(), false);
     if(CastInst::castIsValid(CastOP, Ptr, Builder.getInt8PtrTy())){
       Value* PtrCast = CastInst::Create(CastOP, Ptr, Builder.getInt8PtrTy());
+      Instruction* HoistingPoint = nullptr;
+      if(Builder.GetInsertBlock() && Builder.GetInsertPoint() != Builder.GetInsertBlock()->end())
+        HoistingPoint = GetHoistingPoint(std::vector<Value*>(1, Ptr), &*Builder.GetInsertPoint());
+      if(HoistingPoint){
+        Builder.SetInsertPoint(HoistingPoint);
+        this->VoidCasts[Ptr] = PtrCast;
+      }
       Builder.Insert(dyn_cast<Instruction>(PtrCast));
       return PtrCast;
     }
@@ -579,7 +1281,7 @@ Value* MemoryMonitor::CastPointerToVoid(Value* Ptr, IRBuilder<> Builder){
   return nullptr;
 }
 
-void MemoryMonitor::InsertHeapEntry(Value* HeapPtr, Type* AllocatedType, Value* Size, Value* ArrayStep, IRBuilder<> Builder){
+void MemoryMonitor::InsertHeapEntry(Value* HeapPtr, Type* AllocatedType, Value* Size, Value* ArrayStep, Value* Bytes, IRBuilder<> Builder){
   #define DEBUG_TYPE "memon"
   LLVM_DEBUG(
     Instruction* HeapPtrAsInst = dyn_cast<Instruction>(HeapPtr);
@@ -593,6 +1295,7 @@ void MemoryMonitor::InsertHeapEntry(Value* HeapPtr, Type* AllocatedType, Value*
   ArgsType.push_back(Builder.getInt8PtrTy());
   ArgsType.push_back(Builder.getInt64Ty());
   ArgsType.push_back(Builder.getInt64Ty());
+  ArgsType.push_back(Builder.getInt64Ty());
   ArgsType.push_back(Builder.getInt32Ty());
   
   if(AllocatedType->isPointerTy())
@@ -608,15 +1311,16 @@ void MemoryMonitor::InsertHeapEntry(Value* HeapPtr, Type* AllocatedType, Value*
   Args.push_back(HeapPtr);
   Args.push_back(Size);
   Args.push_back(ArrayStep);
-  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), TypeIndex));
+  Args.push_back(Bytes);
+  Args.push_back(TypeIndexValue(TypeIndex, Builder));
   InsertFunctionCall("WhiroInsertHeapEntry", Builder.getVoidTy(), ArgsType, Args, Builder, false);
 }
 
-void MemoryMonitor::UpdateHeapEntrySize(Value* HeapPtr, Value* NewSize, IRBuilder<> Builder){
+void MemoryMonitor::ReallocHeapEntry(Value* OldHeapPtr, Value* NewHeapPtr, Type* AllocatedType, Value* Bytes, IRBuilder<> Builder){
   #define DEBUG_TYPE "memon"
   LLVM_DEBUG(
-    Instruction* HeapPtrAsInst = dyn_cast<Instruction>(HeapPtr);
-    dbgs() << "Updating size of heap entry. Reallocation at function " << HeapPtrAsInst->getFunction()->getName() << " at line " << GetSourceLine(HeapPtrAsInst) << ". File: " << HeapPtrAsInst->getFunction()->getSubprogram()->getFile()->getFilename() << "\n"; HeapPtrAsInst->dump();
+    Instruction* HeapPtrAsInst = dyn_cast<Instruction>(NewHeapPtr);
+    dbgs() << "Updating heap entry. Reallocation at function " << HeapPtrAsInst->getFunction()->getName() << " at line " << GetSourceLine(HeapPtrAsInst) << ". File: " << HeapPtrAsInst->getFunction()->getSubprogram()->getFile()->getFilename() << "\n"; HeapPtrAsInst->dump();
   );
   #undef DEBUG_TYPE
   
@@ -624,13 +1328,30 @@ void MemoryMonitor::UpdateHeapEntrySize(Value* HeapPtr, Value* NewSize, IRBuilde
   std::vector<Value*> Args;
   
   ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt64Ty());
   ArgsType.push_back(Builder.getInt64Ty());
+  ArgsType.push_back(Builder.getInt32Ty());
   
-  //If this pointer is not void*, we need to cast it
-  HeapPtr = (HeapPtr->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(HeapPtr, Builder) : HeapPtr;
-  Args.push_back(HeapPtr);
-  Args.push_back(NewSize);
-  InsertFunctionCall("WhiroUpdateHeapEntrySize", Builder.getVoidTy(), ArgsType, Args, Builder, false);  
+  if(AllocatedType->isPointerTy())
+    AllocatedType = dyn_cast<PointerType>(AllocatedType)->getElementType();
+  
+  //Unlike allocations, reallocations must always reach the runtime, so the old block is released even when the
+  //type of the new one is unknown. The runtime does not insert blocks with negative type indexes
+  int TypeIndex = GetTypeIndex(AllocatedType);
+  if(TypeIndex == 50000)
+    TypeIndex = -1;
+  uint64_t ElementSize = AllocatedType->isSized() ? this->M->getDataLayout().getTypeAllocSize(AllocatedType).getFixedSize() : 1;
+  
+  //If these pointers are not void*, we need to cast them
+  OldHeapPtr = (OldHeapPtr->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(OldHeapPtr, Builder) : OldHeapPtr;
+  NewHeapPtr = (NewHeapPtr->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(NewHeapPtr, Builder) : NewHeapPtr;
+  Args.push_back(OldHeapPtr);
+  Args.push_back(NewHeapPtr);
+  Args.push_back(Bytes);
+  Args.push_back(ConstantInt::get(Builder.getInt64Ty(), ElementSize));
+  Args.push_back(TypeIndexValue(TypeIndex, Builder));
+  InsertFunctionCall("WhiroReallocHeapEntry", Builder.getVoidTy(), ArgsType, Args, Builder, false);  
 }
 
 void MemoryMonitor::DeleteHeapEntry(Value* HeapPtr, IRBuilder<> Builder){
@@ -674,23 +1395,33 @@ void MemoryMonitor::HandleHeapOperation(CallInst* HeapOp, IRBuilder<> Builder){
   Type* AllocatedType = dyn_cast<PointerType>(HeapType)->getElementType();
   const DataLayout DL = this->M->getDataLayout();
   uint64_t AllocatedTypeSize = DL.getTypeAllocSize(AllocatedType).getFixedSize();
-  //If HeapOp is a call to 'realloc', the number of allocated bytes is the second argument in the call. If it is an allocation
-  //function, such as 'malloc' or 'calloc', this number is the first argument. 
-  Value* AllocatedBytes = (HeapOp->getCalledFunction()->getName() == "realloc") ? HeapOp->getOperand(1) : HeapOp->getOperand(0);
+  //If HeapOp is a call to 'realloc', the number of allocated bytes is the second argument in the call. If it is a call
+  //to 'calloc', this number is the product of its two arguments. For 'malloc', it is the first argument. 
+  StringRef HeapFuncName = HeapOp->getCalledFunction()->getName();
+  Value* AllocatedBytes = nullptr;
+  if(HeapFuncName == "realloc")
+    AllocatedBytes = HeapOp->getOperand(1);
+  else if(HeapFuncName == "calloc")
+    AllocatedBytes = Builder.CreateMul(HeapOp->getOperand(0), HeapOp->getOperand(1));
+  else
+    AllocatedBytes = HeapOp->getOperand(0);
+  
+  //Reallocations are handed to the runtime with the old and the new addresses, so it can move the entry
+  if(HeapFuncName == "realloc"){
+    ReallocHeapEntry(HeapOp->getOperand(0), HeapOp, HeapType, AllocatedBytes, Builder);
+    HeapOperations++;
+    return;
+  }
   
   //If we are allocating a constant amount of bytes, then we know the allocated amount at static time.
   //otherwise, we need to insert a instruction to compute such value at running time.
   Value* QuantAllocated = nullptr; 
   if(ConstantInt* C = dyn_cast<ConstantInt>(AllocatedBytes))
-    QuantAllocated = ConstantInt::get(Builder.getInt64Ty(), (C->getSExtValue() / AllocatedTypeSize));
+    QuantAllocated = ConstantInt::get(Builder.getInt64Ty(), (C->getZExtValue() / AllocatedTypeSize));
   else
     QuantAllocated = Builder.CreateUDiv(AllocatedBytes, ConstantInt::get(Builder.getInt64Ty(), AllocatedTypeSize));
   
-  
-  if(HeapOp->getCalledFunction()->getName() == "realloc")
-    UpdateHeapEntrySize(HeapOp, QuantAllocated, Builder);
-  else
-    InsertHeapEntry(HeapOp, HeapType, QuantAllocated, QuantAllocated, Builder);   
+  InsertHeapEntry(HeapOp, HeapType, QuantAllocated, QuantAllocated, AllocatedBytes, Builder);   
  
   HeapOperations++;
 }
@@ -792,6 +1523,68 @@ int MemoryMonitor::GetTypeIndex(Type* T){
     
 }
 
+bool MemoryMonitor::ReportScalar(DIVariable* Scalar, Value* ValidDef, std::string Format, Value* OutputFilePtr, Value* CallCounter, IRBuilder<> Builder, bool Scalarized){
+  //Each format specifier is written by a function of the formatter. Integers are first converted to the width
+  //that fprintf reads for their specifier, and then extended to 64 bits
+  std::string Report = "";
+  unsigned Width = 64;
+  bool Signed = true;
+  if(Format == "%.2lf\n" || Format == "%.2f\n")
+    Report = "WhiroReportF64";
+  else if(Format == "%d\n" || Format == "%hi\n" || Format == "%ld\n" || Format == "%lld\n"){
+    Report = "WhiroReportI64";
+    Width = (Format == "%d\n") ? 32 : (Format == "%hi\n") ? 16 : 64;
+  }
+  else if(Format == "%u\n" || Format == "%hu\n" || Format == "%lu\n" || Format == "%llu\n"){
+    Report = "WhiroReportU64";
+    Width = (Format == "%u\n") ? 32 : (Format == "%hu\n") ? 16 : 64;
+    Signed = false;
+  }
+  else if(Format == "%c\n"){
+    Report = "WhiroReportChar";
+    Width = 8;
+  }
+  else
+    return false;
+  
+  Type* ValueType = ValidDef->getType();
+  Value* ReportValue = nullptr;
+  if(Report == "WhiroReportF64"){
+    if(!ValueType->isFloatingPointTy())
+      return false;
+    ReportValue = Builder.CreateFPCast(ValidDef, Builder.getDoubleTy());
+  }
+  else{
+    if(!ValueType->isIntegerTy() || ValueType->getIntegerBitWidth() > 64)
+      return false;
+    ReportValue = ValidDef;
+    if(ValueType->getIntegerBitWidth() > Width)
+      ReportValue = Builder.CreateTrunc(ValidDef, Builder.getIntNTy(Width));
+    Type* ReportType = (Width == 8) ? Builder.getInt8Ty() : Builder.getInt64Ty();
+    ReportValue = Signed ? Builder.CreateSExtOrTrunc(ReportValue, ReportType) : Builder.CreateZExtOrTrunc(ReportValue, ReportType);
+  }
+  
+  //Uncomment this line to ignore I/O printing time
+  //return true;
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  ArgsType.push_back(this->OutputFileType);
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt64Ty());
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(ReportValue->getType());
+  
+  Args.push_back(OutputFilePtr);
+  Args.push_back(Builder.CreateGlobalStringPtr(Scalar->getName(), "str"));
+  Args.push_back(Builder.CreateGlobalStringPtr(GetScopeName(Scalar, Builder), "str"));
+  Args.push_back(CallCounter);
+  Args.push_back(Builder.CreateGlobalStringPtr(Scalarized ? " (scalarized) : " : " : ", "str"));
+  Args.push_back(ReportValue);
+  InsertFunctionCall(Report, Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  return true;
+}
+
 void MemoryMonitor::InspectScalar(DIVariable* Scalar, Value* ValidDef, Value* OutputFilePtr, Value* CallCounter,  IRBuilder<> Builder, bool Scalarized){
   if(ValidDef->getType()->isPointerTy()){
     PointerType* PT = dyn_cast<PointerType>(ValidDef->getType());
@@ -801,18 +1594,23 @@ void MemoryMonitor::InspectScalar(DIVariable* Scalar, Value* ValidDef, Value* Ou
     }
   }
   
+  //Scalars are reported by the formatter of the runtime, which writes the same text as fprintf without parsing
+  //a format string. Values whose type does not match their format specifier are still printed with fprintf
+  std::string Format = GetFormatSpecifier(Scalar->getType());
+  if(ReportScalar(Scalar, ValidDef, Format, OutputFilePtr, CallCounter, Builder, Scalarized))
+    return;
+  
   //We inspect scalar using the standard function 'fprintf'  
   //STDOUText is the string which is argument to the fprint function. It contains the name and scope
   //of the variable, plus its format specifier.
   std::string STDOUTText = Scalar->getName().str() + " ";
-  STDOUTText += (isa<DIGlobalVariable>(Scalar)) ?  "(Static) " + Builder.GetInsertBlock()->getParent()->getName().str() : Scalar->getScope()->getName().str();
-  STDOUTText +=  std::string(" %d"); //To print the call counter value
+  STDOUTText += GetScopeName(Scalar, Builder);
+  STDOUTText +=  std::string(" %ld"); //To print the call counter value
   
   if(Scalarized)
     STDOUTText += " (scalarized)";
   
   STDOUTText += std::string(" : ");
-  std::string Format = GetFormatSpecifier(Scalar->getType());
   STDOUTText += Format;
   
   //if we're about to print a float variable, LLVM first converts it to a double.
@@ -854,7 +1652,7 @@ void MemoryMonitor::InspectPointer(DIVariable* Pointer, Value* ValidDef, Value*
   //If this Value is not pointer is not void*, we need to cast it
   ValidDef = (ValidDef->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(ValidDef, Builder) : ValidDef;
   
-  std::string Scope = (isa<DIGlobalVariable>(Pointer)) ? "(Static) " + Builder.GetInsertBlock()->getParent()->getName().str() : Pointer->getScope()->getName().str();
+  std::string Scope = GetScopeName(Pointer, Builder);
   
   //Uncomment this line to ignore I/O printing time
   //return;
@@ -866,11 +1664,11 @@ void MemoryMonitor::InspectPointer(DIVariable* Pointer, Value* ValidDef, Value*
   ArgsType.push_back(Builder.getInt32Ty());
   ArgsType.push_back(Builder.getInt8PtrTy());
   ArgsType.push_back(Builder.getInt8PtrTy());
-  ArgsType.push_back(Builder.getInt32Ty());  
+  ArgsType.push_back(Builder.getInt64Ty());  
   
   Args.push_back(OutputFilePtr);
   Args.push_back(ValidDef);
-  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), TypeIndex));
+  Args.push_back(TypeIndexValue(TypeIndex, Builder));
   Args.push_back(Builder.CreateGlobalStringPtr(Pointer->getName()));
   Args.push_back(Builder.CreateGlobalStringPtr(Scope));
   Args.push_back(CallCounter);
@@ -891,7 +1689,7 @@ void MemoryMonitor::InspectUnion(DIVariable* Union, Value* ValidDef, DIComposite
   //If this pointer is not void*, we need to cast it
   ValidDef = (ValidDef->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(ValidDef, Builder) : ValidDef;
   
-  std::string Scope = (isa<DIGlobalVariable>(Union)) ? "(Static) " + Builder.GetInsertBlock()->getParent()->getName().str() : Union->getScope()->getName().str();  
+  std::string Scope = GetScopeName(Union, Builder);  
   
    //Uncomment this line to ignore I/O printing time
   //return;
@@ -903,7 +1701,7 @@ void MemoryMonitor::InspectUnion(DIVariable* Union, Value* ValidDef, DIComposite
   ArgsType.push_back(Builder.getInt64Ty());
   ArgsType.push_back(Builder.getInt8PtrTy());
   ArgsType.push_back(Builder.getInt8PtrTy());
-  ArgsType.push_back(Builder.getInt32Ty());
+  ArgsType.push_back(Builder.getInt64Ty());
   
   Args.push_back(OutputFilePtr);
   Args.push_back(ValidDef);
@@ -944,7 +1742,7 @@ void MemoryMonitor::InspectStruct(DIVariable* Struct, Value* ValidDef, Value* Ou
   //If this pointer is not void*, we need to cast it
   ValidDef = (ValidDef->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(ValidDef, Builder) : ValidDef;
   
-  std::string Scope = (isa<DIGlobalVariable>(Struct)) ? "(Static) " + Builder.GetInsertBlock()->getParent()->getName().str() : Struct->getScope()->getName().str();
+  std::string Scope = GetScopeName(Struct, Builder);
   
   //Uncomment this line to ignore I/O printing time
   //return;  
@@ -956,11 +1754,11 @@ void MemoryMonitor::InspectStruct(DIVariable* Struct, Value* ValidDef, Value* Ou
   ArgsType.push_back(Builder.getInt32Ty());
   ArgsType.push_back(Builder.getInt8PtrTy());
   ArgsType.push_back(Builder.getInt8PtrTy());
-  ArgsType.push_back(Builder.getInt32Ty());
+  ArgsType.push_back(Builder.getInt64Ty());
   
   Args.push_back(OutputFilePtr);
   Args.push_back(ValidDef);
-  Args.push_back(ConstantInt::get(Builder.getInt32Ty(), TypeIndex));
+  Args.push_back(TypeIndexValue(TypeIndex, Builder));
   Args.push_back(Builder.CreateGlobalStringPtr(Struct->getName()));
   Args.push_back(Builder.CreateGlobalStringPtr(Scope));
   Args.push_back(CallCounter);
@@ -968,29 +1766,16 @@ void MemoryMonitor::InspectStruct(DIVariable* Struct, Value* ValidDef, Value* Ou
   InsertFunctionCall("WhiroInspectStruct", Builder.getVoidTy(), ArgsType, Args, Builder, false);
 }
 
-void MemoryMonitor::InspectArray(DIVariable* Array, Value* ValidDef, DICompositeType* ArrayType, Value* OutputFilePtr, llvm::Value* CallCounter, IRBuilder<> Builder){
-  if(ValidDef->getType()->isPointerTy()){
-    PointerType* PT = dyn_cast<PointerType>(ValidDef->getType());
-    while(PT->getElementType()->isPointerTy()){
-      ValidDef = Builder.CreateLoad(ValidDef);
-      PT = dyn_cast<PointerType>(PT->getElementType());
-    }
-  }
-  //If we have scalarized array value, Whiro prints it as a scalar
-  if(!ValidDef->getType()->isPointerTy() || ValidDef->getType()->isSingleValueType()){
-    InspectScalar(Array, ValidDef, OutputFilePtr, CallCounter, Builder, true);
-    return;
-  }
-  
+Value* MemoryMonitor::GetArrayLength(DIVariable* Array, DICompositeType* ArrayType, uint64_t ElementBits, IRBuilder<> &Builder){
   DINodeArray Subranges = ArrayType->getElements();
   //Get total of elements. If it is constant, just access it. Otherwise, insert instructions to compute it
   //based on the number of elements in every dimension of the array
   Value* TotalElem = nullptr;
-  if(Array->getType()->getSizeInBits() > 0)   
-    TotalElem = ConstantInt::get(Builder.getInt64Ty(), (Array->getType()->getSizeInBits() / dyn_cast<DICompositeType>(Array->getType())->getBaseType()->getSizeInBits()));
+  if(Array->getType()->getSizeInBits() > 0 && ElementBits > 0)   
+    TotalElem = ConstantInt::get(Builder.getInt64Ty(), (Array->getType()->getSizeInBits() / ElementBits));
   else{
     //If the size of the array is not constant, we insert instructions to compute such size
-    TotalElem = ConstantInt::get(Builder.getInt64Ty(), 1);
+    std::vector<Value*> DimSizes;
     for(unsigned i = 0; i < Subranges.size(); i++){
       Value* DimSize = nullptr;
       auto Count = dyn_cast<DISubrange>(Subranges[i])->getCount();
@@ -1000,32 +1785,103 @@ void MemoryMonitor::InspectArray(DIVariable* Array, Value* ValidDef, DIComposite
         DimSize = Count.get<ConstantInt*>();
       else if(Count.is<DIVariable*>()){
         DIVariable* DV = Count.get<DIVariable*>();
-        DimSize = GetValidDef(this->CurrentStackMap[DV->getName().str()].second, Builder.GetInsertBlock(), nullptr, Builder);
+        DimSize = GetValidDef(this->CurrentStackMap[DV->getName().str()].second, &*Builder.GetInsertPoint(), nullptr, Builder);
+        if(isa<AllocaInst>(DimSize))
+          DimSize = Builder.CreateLoad(DimSize);
       }
-      TotalElem = Builder.CreateMul(TotalElem, DimSize);
+      DimSizes.push_back(DimSize);
+    }
+    
+    //The size is computed once, right after the definitions of the dimensions, and reused by every inspection point
+    std::map<std::vector<Value*>, Value*>::iterator it = this->ArraySizes.find(DimSizes);
+    if(it != this->ArraySizes.end())
+      TotalElem = it->second;
+    else{
+      Instruction* HoistingPoint = GetHoistingPoint(DimSizes, &*Builder.GetInsertPoint());
+      IRBuilder<> SizeBuilder(HoistingPoint ? HoistingPoint : &*Builder.GetInsertPoint());
+      TotalElem = ConstantInt::get(Builder.getInt64Ty(), 1);
+      for(Value* DimSize : DimSizes)
+        TotalElem = SizeBuilder.CreateMul(TotalElem, SizeBuilder.CreateZExtOrTrunc(DimSize, Builder.getInt64Ty()));
+      if(HoistingPoint)
+        this->ArraySizes[DimSizes] = TotalElem;
+    }
+  }
+  
+  return TotalElem;
+}
+
+void MemoryMonitor::InspectArray(DIVariable* Array, Value* ValidDef, DICompositeType* ArrayType, Value* OutputFilePtr, llvm::Value* CallCounter, IRBuilder<> Builder){
+  if(ValidDef->getType()->isPointerTy()){
+    PointerType* PT = dyn_cast<PointerType>(ValidDef->getType());
+    while(PT->getElementType()->isPointerTy()){
+      ValidDef = Builder.CreateLoad(ValidDef);
+      PT = dyn_cast<PointerType>(PT->getElementType());
     }
   }
+  //If we have scalarized array value, Whiro prints it as a scalar
+  if(!ValidDef->getType()->isPointerTy() || ValidDef->getType()->isSingleValueType()){
+    InspectScalar(Array, ValidDef, OutputFilePtr, CallCounter, Builder, true);
+    return;
+  }
+  
+  //Each element of an array of arrays holds the scalars of a whole row
+  DICompositeType* RowType = GetInnermostArrayType(ArrayType);
+  uint64_t ElementBits = GetDebugTypeSize(ArrayType->getBaseType());
+  Value* TotalElem = GetArrayLength(Array, ArrayType, ElementBits, Builder);
+  if(RowType != ArrayType && GetDebugTypeSize(RowType->getBaseType()) > 0)
+    TotalElem = Builder.CreateMul(TotalElem, ConstantInt::get(Builder.getInt64Ty(), ElementBits / GetDebugTypeSize(RowType->getBaseType())));
   
   //Get the array step, that is, the size of the outermost dimension
+  DINodeArray Subranges = RowType->getElements();
   auto Count = dyn_cast<DISubrange>(Subranges[Subranges.size() - 1])->getCount();
   Value* Step = nullptr;
   if(Count.is<ConstantInt*>())
     Step = Count.get<ConstantInt*>();
   else if(Count.is<DIVariable*>()){
     DIVariable* DV = Count.get<DIVariable*>();
-    Step = GetValidDef(this->CurrentStackMap[DV->getName().str()].second, Builder.GetInsertBlock(), nullptr, Builder);
+    Step = GetValidDef(this->CurrentStackMap[DV->getName().str()].second, &*Builder.GetInsertPoint(), nullptr, Builder);
+    if(isa<AllocaInst>(Step))
+      Step = Builder.CreateLoad(Step);
+    Step = Builder.CreateZExtOrTrunc(Step, Builder.getInt64Ty());
   }
   
   //If this Value is not pointer is not void*, we need to cast it
   ValidDef = (ValidDef->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(ValidDef, Builder) : ValidDef;
     
-  int Format = GetTypeFormat(ArrayType->getBaseType());
+  int Format = GetTypeFormat(RowType->getBaseType());
   
   //Uncomment this line to ignore I/O printing time
   //return;
   std::vector<Type*> ArgsType;
   std::vector<Value*> Args;
   
+  //The 64-bit hash streams over every element at once, so it does not need the step. It is reported as an unsigned long
+  //by the runtime, which knows the name of the array to write its hash tree
+  if(WideHash || HashTree > 0){
+    ArgsType.push_back(this->OutputFileType);
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    ArgsType.push_back(Builder.getInt64Ty());
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    ArgsType.push_back(Builder.getInt8PtrTy());
+    ArgsType.push_back(Builder.getInt64Ty());
+    ArgsType.push_back(Builder.getInt64Ty());
+    ArgsType.push_back(Builder.getInt32Ty());
+    
+    Args.push_back(OutputFilePtr);
+    Args.push_back(Builder.CreateGlobalStringPtr(Array->getName(), "str"));
+    Args.push_back(Builder.CreateGlobalStringPtr(GetScopeName(Array, Builder), "str"));
+    Args.push_back(CallCounter);
+    Args.push_back(Builder.CreateGlobalStringPtr(" : ", "str"));
+    Args.push_back(ValidDef);
+    Args.push_back(TotalElem);
+    Args.push_back(Step ? Step : TotalElem);
+    Args.push_back(ConstantInt::get(Builder.getInt32Ty(), Format));
+    
+    InsertFunctionCall("WhiroReportArrayHashcode", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+    return;
+  }
+  
   ArgsType.push_back(Builder.getInt8PtrTy());
   ArgsType.push_back(Builder.getInt64Ty());
   ArgsType.push_back(Builder.getInt64Ty());
@@ -1039,12 +1895,66 @@ void MemoryMonitor::InspectArray(DIVariable* Array, Value* ValidDef, DIComposite
   InspectScalar(Array, InsertFunctionCall("WhiroComputeHashcode", Builder.getInt32Ty(), ArgsType, Args, Builder, false), OutputFilePtr, CallCounter, Builder, false);  
 }
 
+void MemoryMonitor::InspectArrayOfData(DIVariable* Array, Value* ValidDef, DICompositeType* ArrayType, Value* OutputFilePtr, Value* CallCounter, IRBuilder<> Builder){
+  if(ValidDef->getType()->isPointerTy()){
+    PointerType* PT = dyn_cast<PointerType>(ValidDef->getType());
+    while(PT->getElementType()->isPointerTy()){
+      ValidDef = Builder.CreateLoad(ValidDef);
+      PT = dyn_cast<PointerType>(PT->getElementType());
+    }
+  }
+  //An array of data kept in registers cannot be visited in memory
+  if(!ValidDef->getType()->isPointerTy())
+    return;
+  
+  //The elements are visited with the type descriptor of the element type, which the runtime strides over
+  int TypeIndex = GetDebugTypeIndex(ArrayType->getBaseType(), 50000);
+  uint64_t ElementBits = GetDebugTypeSize(ArrayType->getBaseType());
+  //If for some reason we could not determine the type index of the elements, we are not able to inspect them
+  if(TypeIndex == 50000 || ElementBits == 0)
+    return;
+  
+  Value* TotalElem = GetArrayLength(Array, ArrayType, ElementBits, Builder);
+  
+  //If this pointer is not void*, we need to cast it
+  ValidDef = (ValidDef->getType() != Builder.getInt8PtrTy()) ? CastPointerToVoid(ValidDef, Builder) : ValidDef;
+  
+  std::string Scope = GetScopeName(Array, Builder);
+  
+  //Uncomment this line to ignore I/O printing time
+  //return;
+  std::vector<Type*> ArgsType;
+  std::vector<Value*> Args;
+  
+  ArgsType.push_back(this->OutputFileType);
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt64Ty());
+  ArgsType.push_back(Builder.getInt64Ty());
+  ArgsType.push_back(Builder.getInt32Ty());
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt8PtrTy());
+  ArgsType.push_back(Builder.getInt64Ty());
+  
+  Args.push_back(OutputFilePtr);
+  Args.push_back(ValidDef);
+  Args.push_back(TotalElem);
+  Args.push_back(ConstantInt::get(Builder.getInt64Ty(), ElementBits / 8));
+  Args.push_back(TypeIndexValue(TypeIndex, Builder));
+  Args.push_back(Builder.CreateGlobalStringPtr(Array->getName()));
+  Args.push_back(Builder.CreateGlobalStringPtr(Scope));
+  Args.push_back(CallCounter);
+  
+  InsertFunctionCall("WhiroInspectArrayOfData", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+}
+
 void MemoryMonitor::InspectVariable(DIVariable* Var, DIType* VarType, Value* ValidDef, Value* OutputFilePtr, Value* CallCounter, IRBuilder<> Builder){
   //If this is the first inspection point created in this function, update the number of 
   //variables inspected, only for local variables. The static are already counted
   if(this->FirstInspection && isa<DILocalVariable>(Var))
     TotalVars++;
   
+  //Arrays of data are visited in memory, so they keep the address of static variables
+  Value* Address = ValidDef;
   if(isa<GlobalVariable>(ValidDef))
     ValidDef = Builder.CreateLoad(ValidDef);
   
@@ -1078,14 +1988,19 @@ void MemoryMonitor::InspectVariable(DIVariable* Var, DIType* VarType, Value* Val
          InspectStruct(Var, ValidDef, OutputFilePtr, CallCounter, Builder);
          return;
          
-       case dwarf::DW_TAG_array_type:
-         if(isa<DIBasicType>(DICT->getBaseType()))
+       case dwarf::DW_TAG_array_type:{
+         //Arrays of scalars (possibly behind typedefs or enumerations), and arrays of arrays of them, are reported as
+         //a hashcode. Arrays of structs, unions and pointers are reported element by element
+         int ElementFormat = GetTypeFormat(DICT->getBaseType());
+         int ScalarFormat = GetTypeFormat(GetInnermostArrayType(DICT)->getBaseType());
+         if(ScalarFormat >= 1 && ScalarFormat <= 12)
            InspectArray(Var, ValidDef, DICT, OutputFilePtr, CallCounter, Builder);
-         else{
-           //Inspect non-scalar array
+         else if(ElementFormat == 13 || ElementFormat == 16 || ElementFormat == 17)
+           InspectArrayOfData(Var, Address, DICT, OutputFilePtr, CallCounter, Builder);
+         else
            errs() << "Do not inspect non-scalar arrays\n";
-         }
          return;
+       }
          
        case dwarf::DW_TAG_enumeration_type: //Whiro reports enumerations as simple integers
          InspectScalar(Var, ValidDef, OutputFilePtr, CallCounter, Builder, false);
@@ -1101,7 +2016,7 @@ void MemoryMonitor::InspectEntireHeap(Value* OutputFilePtr, StringRef FuncName,
         
   ArgsType.push_back(this->OutputFileType);
   ArgsType.push_back(Builder.getInt8PtrTy());
-  ArgsType.push_back(Builder.getInt32Ty());
+  ArgsType.push_back(Builder.getInt64Ty());
     
   Args.push_back(OutputFilePtr);
   Args.push_back(Builder.CreateGlobalStringPtr(FuncName, "str"));
@@ -1260,15 +2175,16 @@ PHINode* MemoryMonitor::ExtendLiveRange(std::vector<DbgVariableIntrinsic*>Trace,
     return nullptr;
 }
 
-Value* MemoryMonitor::GetValidDef(std::vector<DbgVariableIntrinsic*>Trace, BasicBlock* InsBlock, std::map<std::string, AllocaInst*>*ShadowVars, IRBuilder<> Builder){
+Value* MemoryMonitor::GetValidDef(std::vector<DbgVariableIntrinsic*>Trace, Instruction* InsPoint, std::map<std::string, AllocaInst*>*ShadowVars, IRBuilder<> Builder){
   Value* ValidDef = nullptr;
+  BasicBlock* InsBlock = InsPoint->getParent();
   DominatorTree* DT = new DominatorTree(*(InsBlock->getParent()));
   
   //Traverse the trace of the variable to select the definition that will be used to report that variable. We adopt the following criteria:
   //1. if a definition is a stack address, we use it
-  //2. otherwise, we select a definition that resides in the block being inspected (the return block of the function)
-  //3. if 1 and 2 fail, we use a definition that dominates the inspection block. 
-  //In cases 2 and 3, we use the last definition (if there are more than one in a block) or most immediate dominator.
+  //2. otherwise, we select a definition that dominates the inspection point. It might be in the block being inspected
+  //(e.g., the return block of the function) or in a block that dominates it
+  //In case 2, we use the last definition (if there are more than one in a block) or most immediate dominator.
   for(auto &Def : Trace){
     Value* DefValue = Def->isAddressOfVariable() ? dyn_cast<DbgDeclareInst>(Def)->getAddress() : dyn_cast<DbgValueInst>(Def)->getValue();
     if(isa<AllocaInst>(DefValue)){
@@ -1282,10 +2198,7 @@ Value* MemoryMonitor::GetValidDef(std::vector<DbgVariableIntrinsic*>Trace, Basic
         break;
       }
     }*/
-    else if(isa<ReturnInst>(Def->getParent()->getTerminator())){
-        ValidDef = DefValue;
-    }
-    else if(DT->dominates(Def, InsBlock)){
+    else if(DT->dominates(Def, InsPoint)){
       ValidDef = DefValue;
     }
   }
@@ -1309,6 +2222,10 @@ void MemoryMonitor::CreateInspectionPoint(Value* OutputFilePtr, Value* CallCount
   LLVM_DEBUG(dbgs() << "Creating inspection point\n";);
   #undef DEBUG_TYPE
   
+  //The report of the point starts here in the indexed output file, or in the reference of the checking mode
+  if(Indexed || !CheckReference.empty())
+    IndexInspectionPoint(OutputFilePtr, CallCounter, Builder);
+  
   //Inspect all the local variables function plus the static variables according to the Memory Filter    
   //First the local variables
   for(auto &v : this->CurrentStackMap){
@@ -1350,7 +2267,7 @@ void MemoryMonitor::CreateInspectionPoint(Value* OutputFilePtr, Value* CallCount
     LLVM_DEBUG(dbgs() << "Inspecting variable " << Var->getName() <<"\n";);
     #undef DEBUG_TYPE
     
-    InspectVariable(Var, VarType, GetValidDef(v.second.second, Builder.GetInsertBlock(), ShadowVars, Builder), OutputFilePtr, CallCounter, Builder);
+    InspectVariable(Var, VarType, GetValidDef(v.second.second, &*Builder.GetInsertPoint(), ShadowVars, Builder), OutputFilePtr, CallCounter, Builder);
   }
   
   //Inspect the static variables
@@ -1359,6 +2276,13 @@ void MemoryMonitor::CreateInspectionPoint(Value* OutputFilePtr, Value* CallCount
     return;
   }
   
+  //The runtime finds which tracked static variables changed since the last inspection point
+  if(!this->StaticIds.empty()){
+    std::vector<Type*> ArgsType;
+    std::vector<Value*> Args;
+    InsertFunctionCall("WhiroBeginStatics", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  }
+  
   for(auto &g : this->StaticMap){
     DIVariable* Var = g.second.first;
     
@@ -1383,7 +2307,15 @@ void MemoryMonitor::CreateInspectionPoint(Value* OutputFilePtr, Value* CallCount
     LLVM_DEBUG(dbgs() << "Inspecting variable " << Var->getName() << " (Static)\n";);
     #undef DEBUG_TYPE
     
+    //The report of a tracked static variable is delimited by markers, so it can be guarded once the function is instrumented
+    std::map<std::string, int>::iterator Tracked = this->StaticIds.find(g.first);
+    if(Tracked == this->StaticIds.end()){
+      InspectVariable(Var, VarType, g.second.second, OutputFilePtr, CallCounter, Builder);
+      continue;
+    }
+    Instruction* Marker = CreatePointMarker(&*Builder.GetInsertPoint());
     InspectVariable(Var, VarType, g.second.second, OutputFilePtr, CallCounter, Builder);
+    this->StaticGuards.push_back(std::make_tuple(Marker, CreatePointMarker(&*Builder.GetInsertPoint()), Tracked->second));
   }
   
   this->FirstInspection = false;
@@ -1426,6 +2358,12 @@ void MemoryMonitor::UpdateStackMap(DbgVariableIntrinsic* DVI){
   }
 }
 
+Instruction* MemoryMonitor::CreatePointMarker(Instruction* InsPoint){
+  //The marker is a dead instruction that tells where an inspection point begins or ends. Code hoisted out of the point
+  //is inserted before its first marker, so it is not guarded along with the point
+  return BinaryOperator::CreateAdd(ConstantInt::get(Type::getInt32Ty(InsPoint->getContext()), 0), ConstantInt::get(Type::getInt32Ty(InsPoint->getContext()), 0), "marker", InsPoint);
+}
+
 Instruction* MemoryMonitor::GetInsertionPoint(Function& F){
   //The inspection points are createad right before the return of the function. We find return basic block
   //of the function and set it as the insertion point of the IRBuilder.
@@ -1452,22 +2390,123 @@ Instruction* MemoryMonitor::GetInsertionPoint(Function& F){
     return InsBlock->getTerminator();
 }
 
+void MemoryMonitor::CollectInnerPoints(Function& F, std::vector<std::pair<Instruction*, unsigned>>*Points){
+  //Inspection points at the latches of loops are reached once per iteration
+  if(InsLoops){
+    DominatorTree DT(F);
+    LoopInfo LI(DT);
+    for(Loop* L : LI.getLoopsInPreorder()){
+      BasicBlock* Latch = L->getLoopLatch();
+      if(!Latch)
+        continue;
+      
+      unsigned Line = L->getStartLoc() ? L->getStartLoc().getLine() : 0;
+      Points->push_back(std::make_pair(Latch->getTerminator(), Line));
+    }
+  }
+  
+  //Inspection points at source lines are created before the first instruction of that line
+  for(auto &Location : InsLines){
+    StringRef File = StringRef(Location).rsplit(':').first;
+    unsigned Line = 0;
+    if(StringRef(Location).rsplit(':').second.getAsInteger(10, Line)){
+      errs() << "Invalid source line " << Location << ". Expected file:line\n";
+      continue;
+    }
+    
+    for(Instruction &I : instructions(F)){
+      //Calls to halting functions already have an inspection point right before them
+      if(isa<PHINode>(&I) || isa<DbgInfoIntrinsic>(&I) || isa<AllocaInst>(&I))
+        continue;
+      if(CallInst* CI = dyn_cast<CallInst>(&I)){
+        if(CI->getCalledFunction() && CI->getCalledFunction()->getName().equals("exit"))
+          continue;
+      }
+      
+      const DebugLoc &Loc = I.getDebugLoc();
+      if(!Loc || Loc.getLine() != Line)
+        continue;
+      StringRef Filename = Loc->getFilename();
+      if(Filename == File || Filename.endswith("/" + File.str())){
+        Points->push_back(std::make_pair(&I, Line));
+        break;
+      }
+    }
+  }
+}
+
+void MemoryMonitor::CreateInnerInspectionPoint(Function& F, Instruction* InsPoint, unsigned Line, Value* OutputFilePtr, std::map<std::string, AllocaInst*>*ShadowVars, std::vector<std::pair<Instruction*, Instruction*>>*Snapshots){
+  #define DEBUG_TYPE "memon"
+  LLVM_DEBUG(dbgs() << "Creating inspection point at line " << Line << " of function " << F.getName() << "\n";);
+  #undef DEBUG_TYPE
+  
+  //Every inspection point inside a function has a counter of its own, and its variables are reported with the scope function@line
+  IRBuilder<> Builder(InsPoint);
+  this->PointTag = "@" + std::to_string(Line);
+  Value* Counter = CreatePointCounter(F.getName().str() + this->PointTag, InsPoint, Builder);
+  
+  //If the user chooses a stride, the point is reported only when its counter is a multiple of it
+  Value* Report = (Stride > 1) ? Builder.CreateICmpEQ(Builder.CreateURem(Counter, Builder.getInt64(Stride)), Builder.getInt64(0)) : nullptr;
+  Instruction* Marker = CreatePointMarker(InsPoint);
+  
+  CreateInspectionPoint(OutputFilePtr, Counter, ShadowVars, Builder);
+  if(InsFullHeap)
+    InspectEntireHeap(OutputFilePtr, F.getName().str() + this->PointTag, Counter, Builder);
+  Instruction* EndMarker = CreatePointMarker(InsPoint);
+  
+  if(Report){
+    std::pair<BasicBlock*, BasicBlock*> Inspection = GuardInspectionPoint(Marker, EndMarker, [&](IRBuilder<>& GuardBuilder){ return Report; });
+    //The markers are moved into the guarded blocks, so a snapshot of the point is taken only when the point is reported
+    if(Inspection.first){
+      Marker->moveBefore(&Inspection.first->front());
+      EndMarker->moveBefore(Inspection.second->getTerminator());
+    }
+  }
+  Snapshots->push_back(std::make_pair(Marker, EndMarker));
+  this->PointTag = "";
+}
+
 void MemoryMonitor::InstrumentFunction(Function& F){
   #define DEBUG_TYPE "memon"
   LLVM_DEBUG(dbgs() << "Instrumenting function " << F.getName() << ". File: " << F.getSubprogram()->getFile()->getFilename() << "\n";);
   #undef DEBUG_TYPE
   
   InstFunc++;
+  //Collect the inspection points inside the function, such as the latches of loops. This is done before any instrumentation
+  //is inserted, so only the instructions of the program are considered
+  std::vector<std::pair<Instruction*, unsigned>>InnerPoints;
+  CollectInnerPoints(F, &InnerPoints);
+  
   //Create and set the IRBuilder which instruments the program.
   llvm::IRBuilder<> Builder(&F.getEntryBlock(), F.getEntryBlock().getFirstNonPHI()->getIterator());
   
   //Create the function call counter
-  llvm::Value* CallCounter = (F.getName().equals("main")) ? ConstantInt::get(Builder.getInt32Ty(), 1) : CreateFunctionCounter(&F, Builder);
+  this->CurrentCounters = LoadCounterBlock(F);
+  llvm::Value* CallCounter = CreateFunctionCounter(&F, Builder);
+  
+  //In the watch mode, the program is not inspected. The instrumentation only tells which function writes the watched variables
+  if(!WatchVars.empty()){
+    TrackCurrentFunction(F, cast<Instruction>(CallCounter)->getNextNode()->getNextNode());
+    Instruction* InsPoint = GetInsertionPoint(F);
+    if(F.getName() == "main" && InsPoint){
+      Builder.SetInsertPoint(InsPoint);
+      CloseOutputFile(LoadOutputFile(F), Builder);
+    }
+    return;
+  }
   
   //A map containing all the variables gathered in the function, mapped by their names plus a map containing all the variables shadowed in the stack
   std::map<std::string, std::pair<DIVariable*, std::vector<DbgVariableIntrinsic*>>>StackMap;
   this->CurrentStackMap = StackMap;
   std::map<std::string, AllocaInst*>ShadowVars;
+  //The inspection points of the function, given by the markers at their beginning and end. In the snapshot mode, they are
+  //guarded after all the instructions are visited
+  std::vector<std::pair<Instruction*, Instruction*>>Snapshots;
+  //The output file is loaded once, and the casts and sizes used by the inspection points are shared among them
+  Value* OutputFilePtr = LoadOutputFile(F);
+  this->VoidCasts.clear();
+  this->ArraySizes.clear();
+  this->DomTree.reset();
   
   for(Instruction &I : instructions(F)){
     if(DbgVariableIntrinsic* DVI = dyn_cast<DbgVariableIntrinsic>(&I)){
@@ -1489,17 +2528,17 @@ void MemoryMonitor::InstrumentFunction(Function& F){
           if(OnlyMain){
            if(F.getName() == "main"){
              Builder.SetInsertPoint(&I);
-             //Create a reference to the output file.
-             Value* OutputFilePtr = Builder.CreateLoad(this->OutputFile);
+             Instruction* Marker = CreatePointMarker(&I);
              CreateInspectionPoint(OutputFilePtr, CallCounter, &ShadowVars, Builder);
+             Snapshots.push_back(std::make_pair(Marker, CreatePointMarker(&I)));
              CloseOutputFile(OutputFilePtr, Builder);
            }
           }
           else{
             Builder.SetInsertPoint(&I);
-            //Create a reference to the output file.
-            Value* OutputFilePtr = Builder.CreateLoad(this->OutputFile);
+            Instruction* Marker = CreatePointMarker(&I);
             CreateInspectionPoint(OutputFilePtr, CallCounter, &ShadowVars, Builder);
+            Snapshots.push_back(std::make_pair(Marker, CreatePointMarker(&I)));
             CloseOutputFile(OutputFilePtr, Builder);
           }
         }
@@ -1511,35 +2550,72 @@ void MemoryMonitor::InstrumentFunction(Function& F){
   Instruction* InsPoint = GetInsertionPoint(F);
   if(!InsPoint){
     errs() << "Whiro could not find the return block of this function. Skipping it.\n";
+    for(auto &Point : InnerPoints)
+      CreateInnerInspectionPoint(F, Point.first, Point.second, OutputFilePtr, &ShadowVars, &Snapshots);
+    FinishInspectionPoints(F, OutputFilePtr, &Snapshots);
     this->CurrentStackMap.clear(); 
     return;
   }
   Builder.SetInsertPoint(InsPoint);
-  //Create a reference to the output file.
-  Value* OutputFilePtr = Builder.CreateLoad(this->OutputFile);
+  Instruction* Marker = CreatePointMarker(InsPoint);
   
-  //Creating inspection point  
-  if(OnlyMain){
-    if(F.getName() == "main")
+  //Creating inspection point, unless the user chooses to inspect only points inside functions
+  if(!NoReturnPoints){
+    if(OnlyMain){
+      if(F.getName() == "main")
+        CreateInspectionPoint(OutputFilePtr, CallCounter, &ShadowVars, Builder);
+    }
+    else
       CreateInspectionPoint(OutputFilePtr, CallCounter, &ShadowVars, Builder);
+    
+    if(InsFullHeap)
+      InspectEntireHeap(OutputFilePtr, F.getName(), CallCounter, Builder);
   }
-  else
-    CreateInspectionPoint(OutputFilePtr, CallCounter, &ShadowVars, Builder);
+  Snapshots.push_back(std::make_pair(Marker, CreatePointMarker(InsPoint)));
+  
+  //Create the inspection points inside the function
+  for(auto &Point : InnerPoints)
+    CreateInnerInspectionPoint(F, Point.first, Point.second, OutputFilePtr, &ShadowVars, &Snapshots);
+  
+  FinishInspectionPoints(F, OutputFilePtr, &Snapshots);
+  Builder.SetInsertPoint(InsPoint);
   
   //If this is the main routine, close the output file. Notice that in case of calls to halting functions,
   //we also close the file right before the halting
   if(F.getName() == "main")
     CloseOutputFile(OutputFilePtr, Builder);
   
-  if(InsFullHeap)
-    InspectEntireHeap(OutputFilePtr, F.getName(), CallCounter, Builder);
-  
   this->CurrentStackMap.clear();
 }
 
+void MemoryMonitor::FinishInspectionPoints(Function& F, Value* OutputFilePtr, std::vector<std::pair<Instruction*, Instruction*>>*Snapshots){
+  //Static variables tracked by the runtime are reported only if they changed
+  for(auto &Static : this->StaticGuards)
+    GuardStatic(std::get<0>(Static), std::get<1>(Static), std::get<2>(Static));
+  
+  //In the snapshot mode, every inspection point is reported by a forked child of the program
+  if(ForkSnapshot){
+    for(auto &Snapshot : *Snapshots)
+      SnapshotInspectionPoint(Snapshot.first, Snapshot.second, OutputFilePtr);
+  }
+  
+  //The markers are no longer needed once the inspection points are guarded
+  for(auto &Static : this->StaticGuards){
+    std::get<0>(Static)->eraseFromParent();
+    std::get<1>(Static)->eraseFromParent();
+  }
+  this->StaticGuards.clear();
+  for(auto &Snapshot : *Snapshots){
+    Snapshot.first->eraseFromParent();
+    Snapshot.second->eraseFromParent();
+  }
+}
+
 void MemoryMonitor::InstrumentOnlyHeap(Function& F){
   //Create and set the IRBuilder which instruments the program.
   llvm::IRBuilder<> Builder(&F.getEntryBlock(), F.getEntryBlock().getFirstNonPHI()->getIterator());
+  this->VoidCasts.clear();
+  this->DomTree.reset();
   for(Instruction &I : instructions(F)){
     if(CallInst* CI = dyn_cast<CallInst>(&I)){
       Function* CalledFunction = CI->getCalledFunction();
@@ -1555,6 +2631,37 @@ void MemoryMonitor::InstrumentOnlyHeap(Function& F){
   }
 }
 
+void MemoryMonitor::ResolveOptions(){
+  //The options are only written when they conflict, so once they are resolved the pass does not write them again
+  //and many modules can be instrumented at once
+  if(InsHeap && !TrackPtr)
+    TrackPtr = true;
+  
+  //The static variables tracked by the runtime are numbered in each module, so the numbers of different units clash
+  if(SeparateUnit && DedupStatic){
+    errs() << "Whiro cannot report static variables only when they change in separate compilation. Reporting them at every point\n";
+    DedupStatic = false;
+  }
+  
+  //Children of the snapshot mode write to files of their own, so their reports cannot be indexed as they are written
+  if(Indexed && ForkSnapshot){
+    errs() << "Whiro cannot index the output file in the snapshot mode. Writing a plain output file\n";
+    Indexed = false;
+  }
+  
+  //The checking mode compares the reports of each point as the program writes them
+  if(!CheckReference.empty()){
+    if(ForkSnapshot){
+      errs() << "Whiro cannot check the reports of snapshots against a reference. Disabling the snapshot mode\n";
+      ForkSnapshot = false;
+    }
+    if(Indexed){
+      errs() << "Whiro does not write an indexed output file in the checking mode\n";
+      Indexed = false;
+    }
+  }
+}
+
 bool MemoryMonitor::runOnModule(Module &M){
   #define DEBUG_TYPE "memon"
   LLVM_DEBUG(dbgs() << "Instrumeting program " << M.getSourceFileName() <<".\n";);
@@ -1565,7 +2672,7 @@ bool MemoryMonitor::runOnModule(Module &M){
   this->DbgFinder.processModule(M);
   this->MemFilter = InsHeap || InsStack || InsStatic;
   this->FirstInspection = true;
-  if(InsHeap) TrackPtr = true;
+  ResolveOptions();
   
   //Initialize the statistis to zero. This way they will appear in the -stats output even
   //if they are not incremented during the execution of this pass
@@ -1578,16 +2685,38 @@ bool MemoryMonitor::runOnModule(Module &M){
   //Create an IRBuilder to insert calls to the functions that Initialize the dynamic components of
   //the Memory Monitor
   Function* Main = M.getFunction(StringRef("main"));
-  if(Main == nullptr){
+  if(Main && Main->isDeclaration())
+    Main = nullptr;
+  if(Main == nullptr && !SeparateUnit){
     errs() << "Program has no main function!\n Aborting instrumentation...\n";
     exit(1);
   }
   
-  BasicBlock* InsBlock = &Main->getEntryBlock();
-  BasicBlock::iterator InsPoint = Main->getEntryBlock().begin();
-  
-  while(isa<AllocaInst>(InsPoint)) ++InsPoint;
-  IRBuilder<> Builder(InsBlock, InsPoint);
+  //The settings of Whiro are inserted in main, after the allocas
+  this->MainBody = nullptr;
+  if(Main){
+    BasicBlock::iterator MainPoint = Main->getEntryBlock().begin();
+    while(isa<AllocaInst>(MainPoint)) ++MainPoint;
+    this->MainBody = &*MainPoint;
+  }
+  IRBuilder<> Builder(M.getContext());
+  if(this->MainBody)
+    Builder.SetInsertPoint(this->MainBody);
+  
+  //In separate compilation, every unit registers its Type Table and counters in a constructor, which runs before main.
+  //The first unit loaded, in the program or in one of its shared libraries, also inserts the settings of Whiro
+  if(SeparateUnit){
+    FunctionType* ConstructorType = FunctionType::get(Type::getVoidTy(M.getContext()), false);
+    this->UnitConstructor = Function::Create(ConstructorType, GlobalValue::InternalLinkage, "WhiroRegisterUnit", &M);
+    ReturnInst* UnitReturn = ReturnInst::Create(M.getContext(), BasicBlock::Create(M.getContext(), "entry", this->UnitConstructor));
+    appendToGlobalCtors(M, this->UnitConstructor, 0);
+    
+    Builder.SetInsertPoint(UnitReturn);
+    std::vector<Type*> ArgsType;
+    std::vector<Value*> Args;
+    Value* Claim = InsertFunctionCall("WhiroClaimRuntime", Builder.getInt32Ty(), ArgsType, Args, Builder, false);
+    Builder.SetInsertPoint(SplitBlockAndInsertIfThen(Builder.CreateICmpNE(Claim, Builder.getInt32(0)), UnitReturn, false));
+  }
   
   //Collect the global variables before injecting anything in the program
   if(!this->MemFilter || (this->MemFilter && InsStatic)){
@@ -1613,11 +2742,62 @@ bool MemoryMonitor::runOnModule(Module &M){
   
   //Create the output file.
   OpenOutputFile(Builder);
+  if(Indexed)
+    SetIndexedOutput(Builder);
+  if(ForkSnapshot)
+    SetSnapshotMode(Builder);
   
   //Open the Type Table
   std::pair<std::string, int> TypeTableMD = CreateTypeTable();
+  if(SeparateUnit)
+    RegisterTypeTable(TypeTableMD.first, TypeTableMD.second);
   OpenTypeTable(TypeTableMD.first, TypeTableMD.second, Builder);
   
+  //The entire heap is inspected by many threads only if the user chooses to
+  if(InsFullHeap && HeapWorkers > 0)
+    SetParallelHeap(Builder);
+  
+  //Heap graphs are hashed only if the user chooses to
+  if(HashHeap || !HashReference.empty())
+    SetHeapHashing(Builder);
+  
+  //Arrays are hashed with the 32-bit hashcode and reals are quantized, unless the user chooses otherwise. Hash
+  //trees are built with the 64-bit hash
+  if(WideHash || ExactRealHash || HashTree > 0){
+    std::vector<Type*> ArgsType;
+    std::vector<Value*> Args;
+    ArgsType.push_back(Builder.getInt32Ty());
+    ArgsType.push_back(Builder.getInt32Ty());
+    Args.push_back(ConstantInt::get(Builder.getInt32Ty(), WideHash || HashTree > 0));
+    Args.push_back(ConstantInt::get(Builder.getInt32Ty(), ExactRealHash));
+    InsertFunctionCall("WhiroSetArrayHashing", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  }
+  
+  //Large arrays are hashed as trees only if the user chooses to
+  if(HashTree > 0)
+    SetHashTree(Builder);
+  
+  //Raw bytes are printed in hexadecimal, unless the user asks for the decimal format of older outputs
+  if(DecimalBytes){
+    std::vector<Type*> ArgsType;
+    std::vector<Value*> Args;
+    InsertFunctionCall("WhiroSetDecimalBytes", Builder.getVoidTy(), ArgsType, Args, Builder, false);
+  }
+  
+  //The number of counters and their names are known only after every function is instrumented
+  CallInst* SetCounters = SetCallCounters(Builder);
+  
+  //In the watch mode, the selected static variables are watched with hardware breakpoints. In separate compilation,
+  //they are the static variables of the unit that defines main
+  if(!WatchVars.empty() && this->MainBody){
+    Builder.SetInsertPoint(this->MainBody);
+    SetWatchpoints(Builder);
+  }
+  
+  //Static variables are reported only when they change, if the user chooses to
+  if(DedupStatic)
+    TrackStatics(Builder);
+  
   //Instrument the functions in the program
   for(Function &F : M){
     if(OnlyMain && F.getName () != "main"){
@@ -1634,6 +2814,7 @@ bool MemoryMonitor::runOnModule(Module &M){
     
     this->FirstInspection = true;
   }
+  FinishCallCounters(SetCounters);
   
   #define DEBUG_TYPE "memon"
   LLVM_DEBUG(dbgs() << "\nInstrumentation done!\n --------------------------------------------------\n\n";);
@@ -1642,4 +2823,7 @@ bool MemoryMonitor::runOnModule(Module &M){
 }
 
 char MemoryMonitor::ID = 0;
+bool MemoryMonitor::SharedDescriptors = false;
+std::mutex MemoryMonitor::SharedDescriptorsLock;
+std::map<uint64_t, TypeDescriptorEntry> MemoryMonitor::SharedDescriptorsCache;
 static RegisterPass<MemoryMonitor> X("memoryMonitor", "Memory Monitor Pass");
@@ -0,0 +1,198 @@
+#include "../include/Whiro.h"
+#include<pthread.h>
+
+extern HeapEntry * HeapTable;
+
+//Usage mode setting. If it is greater than zero, the entire heap is inspected by this number of threads
+int HeapWorkers = 0;
+
+/**
+ * This structure holds the report of a chunk of the Heap Table
+ * Buffer is the text reported for the entries of the chunk
+ * Length is the length of Buffer
+ */
+typedef struct {
+  char* Buffer;
+  size_t Length;
+} HeapChunk;
+
+/**
+ * This structure describes an inspection of the entire heap shared by the workers
+ * Entries are the live entries of the Heap Table, in the order of the table
+ * Chunks are the reports of the chunks of Entries
+ * NextChunk is the next chunk to be taken by a worker
+ * Mode is the mode of the inspections of the workers, including the thread of the program
+ */
+typedef struct {
+  HeapEntry** Entries;
+  size_t QuantEntries;
+  HeapChunk* Chunks;
+  size_t QuantChunks;
+  size_t ChunkSize;
+  size_t NextChunk;
+  char* FuncName;
+  long CallCounter;
+  int Mode;
+} HeapInspection;
+
+//The array of live entries is reused by every inspection point
+static HeapEntry **LiveEntries = NULL;
+static size_t LiveCapacity = 0;
+
+//The pool of workers is started by the first inspection of the heap and reused by the next ones. Each inspection
+//is published with a new Generation, and the thread of the program waits until no worker is Busy with it
+static pthread_t *PoolThreads = NULL;
+static int PoolSize = 0, PoolStarted = 0, PoolStopping = 0, Busy = 0;
+static unsigned long Generation = 0;
+static HeapInspection *CurrentInspection = NULL;
+static pthread_mutex_t PoolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t WorkReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t WorkDone = PTHREAD_COND_INITIALIZER;
+//Program threads inspect the entire heap one at a time
+static pthread_mutex_t InspectionLock = PTHREAD_MUTEX_INITIALIZER;
+
+void WhiroSetParallelHeap(int Workers){
+  HeapWorkers = Workers;
+}
+
+static void WhiroInspectChunks(HeapInspection *Inspection){
+  int PreviousMode = WhiroSetThreadMode(Inspection->Mode);
+  size_t Chunk;
+  while ((Chunk = __atomic_fetch_add(&Inspection->NextChunk, 1, __ATOMIC_RELAXED)) < Inspection->QuantChunks){
+    HeapChunk *Current = &Inspection->Chunks[Chunk];
+    FILE *Buffer = open_memstream(&Current->Buffer, &Current->Length);
+    if (Buffer == NULL){
+      printf("Error creating the buffer of chunk %zu of the heap\n", Chunk);
+      continue;
+    }
+
+    size_t First = Chunk * Inspection->ChunkSize;
+    size_t Last = First + Inspection->ChunkSize;
+    if (Last > Inspection->QuantEntries)
+      Last = Inspection->QuantEntries;
+    for (size_t i = First; i < Last; i++)
+      WhiroInspectHeapData(Buffer, Inspection->Entries[i], "Heap Data", Inspection->FuncName, Inspection->CallCounter);
+    fclose(Buffer);
+  }
+  WhiroSetThreadMode(PreviousMode);
+}
+
+static void* WhiroHeapWorker(void *Unused){
+  (void) Unused;
+  unsigned long Seen = 0;
+  pthread_mutex_lock(&PoolLock);
+  while (1){
+    while (Generation == Seen && !PoolStopping)
+      pthread_cond_wait(&WorkReady, &PoolLock);
+    if (PoolStopping)
+      break;
+    Seen = Generation;
+    HeapInspection *Inspection = CurrentInspection;
+    pthread_mutex_unlock(&PoolLock);
+
+    WhiroInspectChunks(Inspection);
+
+    pthread_mutex_lock(&PoolLock);
+    if (--Busy == 0)
+      pthread_cond_signal(&WorkDone);
+  }
+  pthread_mutex_unlock(&PoolLock);
+  WhiroReleaseInspectionBuffers();
+  return NULL;
+}
+
+static void WhiroStopHeapWorkers(){
+  pthread_mutex_lock(&PoolLock);
+  PoolStopping = 1;
+  pthread_cond_broadcast(&WorkReady);
+  pthread_mutex_unlock(&PoolLock);
+  for (int i = 0; i < PoolSize; i++)
+    pthread_join(PoolThreads[i], NULL);
+  free(PoolThreads);
+  PoolThreads = NULL;
+  PoolSize = 0;
+}
+
+static void WhiroForgetHeapWorkers(){
+  //A forked child has only the thread that forked, so it starts a pool of its own if it inspects the heap
+  PoolThreads = NULL;
+  PoolSize = PoolStarted = PoolStopping = Busy = 0;
+  pthread_mutex_init(&PoolLock, NULL);
+  pthread_mutex_init(&InspectionLock, NULL);
+  pthread_cond_init(&WorkReady, NULL);
+  pthread_cond_init(&WorkDone, NULL);
+}
+
+static void WhiroStartHeapWorkers(){
+  //The thread of the program is one of the workers. If a thread cannot be created, the others do its work
+  PoolStarted = 1;
+  PoolThreads = (pthread_t*) malloc(sizeof(pthread_t) * (HeapWorkers - 1));
+  for (int i = 1; PoolThreads != NULL && i < HeapWorkers; i++){
+    if (pthread_create(&PoolThreads[PoolSize], NULL, WhiroHeapWorker, NULL) == 0)
+      PoolSize++;
+  }
+  pthread_atfork(NULL, NULL, WhiroForgetHeapWorkers);
+  atexit(WhiroStopHeapWorkers);
+}
+
+void WhiroInspectHeapInParallel(FILE *OutputFile, char *FuncName, long CallCounter){
+  pthread_mutex_lock(&InspectionLock);
+  if (!PoolStarted && HeapWorkers > 1)
+    WhiroStartHeapWorkers();
+
+  //Collect the live entries first, so the workers can split them by index
+  size_t QuantEntries = 0;
+  HeapEntry *Entry;
+  for (Entry = HeapTable; Entry != NULL; Entry = Entry->hh.next){
+    if (Entry->Free == 1)
+      continue;
+
+    if (QuantEntries == LiveCapacity){
+      LiveCapacity = LiveCapacity ? 2 * LiveCapacity : 1024;
+      LiveEntries = (HeapEntry**) realloc(LiveEntries, sizeof(HeapEntry*) * LiveCapacity);
+    }
+    LiveEntries[QuantEntries++] = Entry;
+  }
+
+  if (QuantEntries == 0){
+    pthread_mutex_unlock(&InspectionLock);
+    return;
+  }
+
+  HeapInspection Inspection;
+  Inspection.Entries = LiveEntries;
+  Inspection.QuantEntries = QuantEntries;
+  Inspection.QuantChunks = (size_t) HeapWorkers * WHIRO_CHUNKS_PER_WORKER;
+  if (Inspection.QuantChunks > QuantEntries)
+    Inspection.QuantChunks = QuantEntries;
+  Inspection.ChunkSize = (QuantEntries + Inspection.QuantChunks - 1) / Inspection.QuantChunks;
+  Inspection.QuantChunks = (QuantEntries + Inspection.ChunkSize - 1) / Inspection.ChunkSize;
+  Inspection.Chunks = (HeapChunk*) calloc(Inspection.QuantChunks, sizeof(HeapChunk));
+  Inspection.NextChunk = 0;
+  Inspection.FuncName = FuncName;
+  Inspection.CallCounter = CallCounter;
+  //Blocks are reported by themselves, even in the Precise mode, so the output does not depend on which worker
+  //visits a block first
+  Inspection.Mode = 0;
+
+  //Workers that find no chunk left go back to wait for the next inspection
+  pthread_mutex_lock(&PoolLock);
+  CurrentInspection = &Inspection;
+  Busy = PoolSize;
+  Generation++;
+  pthread_cond_broadcast(&WorkReady);
+  pthread_mutex_unlock(&PoolLock);
+  WhiroInspectChunks(&Inspection);
+  pthread_mutex_lock(&PoolLock);
+  while (Busy > 0)
+    pthread_cond_wait(&WorkDone, &PoolLock);
+  pthread_mutex_unlock(&PoolLock);
+
+  for (size_t i = 0; i < Inspection.QuantChunks; i++){
+    if (Inspection.Chunks[i].Buffer)
+      WhiroProfiledWrite(Inspection.Chunks[i].Buffer, 1, Inspection.Chunks[i].Length, OutputFile);
+    free(Inspection.Chunks[i].Buffer);
+  }
+  free(Inspection.Chunks);
+  pthread_mutex_unlock(&InspectionLock);
+}
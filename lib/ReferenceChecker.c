@@ -0,0 +1,207 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "../include/Whiro.h"
+#include<pthread.h>
+
+/**
+ * This structure holds the state of the checking mode
+ * Reference is the indexed output file of the reference run, or NULL if it could not be read
+ * Data and Size are the mapped reference file
+ * Position and End delimit the part of the report of the current point not checked yet
+ * Line holds the last line written by the program, while it is not complete
+ * Divergences is the file the divergences are written to
+ */
+typedef struct {
+  WhiroCheckpoint* Reference;
+  const char* Data;
+  size_t Size;
+  size_t Position;
+  size_t End;
+  char* Line;
+  size_t LineLength;
+  size_t LineCapacity;
+  FILE* Divergences;
+  const char* ReferenceName;
+  int Stop;
+  uint64_t QuantDivergences;
+  uint64_t QuantChecked;
+  uint64_t QuantMissing;
+} ReferenceChecker;
+
+//The program has a single output file, so there is a single checker. Its state is only touched with CheckerLock held.
+//The lock is taken after the lock of the stream, which is held when the stream calls WhiroCheckWrite, and it is
+//recursive because WhiroCheckPoint flushes the stream while it holds both
+static ReferenceChecker *ActiveChecker = NULL;
+static pthread_mutex_t CheckerLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static void WhiroReportDivergence(ReferenceChecker* Checker, const char* Expected, size_t ExpectedLength, const char* Found, size_t FoundLength){
+  //Divergences are written as diff does: the line of the reference, and then the line of the program
+  Checker->QuantDivergences++;
+  if (Expected)
+    fprintf(Checker->Divergences, "< %.*s\n", (int) ExpectedLength, Expected);
+  if (Found)
+    fprintf(Checker->Divergences, "> %.*s\n", (int) FoundLength, Found);
+
+  if (Checker->Stop){
+    fflush(Checker->Divergences);
+    fprintf(stderr, "Whiro found a divergence from %s:\n", Checker->ReferenceName);
+    if (Expected)
+      fprintf(stderr, "< %.*s\n", (int) ExpectedLength, Expected);
+    if (Found)
+      fprintf(stderr, "> %.*s\n", (int) FoundLength, Found);
+    abort();
+  }
+}
+
+static void WhiroCheckLine(ReferenceChecker* Checker, const char* Line, size_t Length){
+  //Lines written after the report of the point in the reference is over have nothing to be compared to
+  if (Checker->Position >= Checker->End){
+    WhiroReportDivergence(Checker, NULL, 0, Line, Length);
+    return;
+  }
+
+  const char* Expected = Checker->Data + Checker->Position;
+  const char* ExpectedEnd = memchr(Expected, '\n', Checker->End - Checker->Position);
+  size_t ExpectedLength = ExpectedEnd ? (size_t)(ExpectedEnd - Expected) : Checker->End - Checker->Position;
+  Checker->Position += ExpectedLength + 1;
+  if (ExpectedLength != Length || memcmp(Expected, Line, Length) != 0)
+    WhiroReportDivergence(Checker, Expected, ExpectedLength, Line, Length);
+}
+
+static void WhiroKeepLine(ReferenceChecker* Checker, const char* Data, size_t Length){
+  if (Checker->LineLength + Length > Checker->LineCapacity){
+    Checker->LineCapacity = 2 * (Checker->LineLength + Length);
+    Checker->Line = (char*) realloc(Checker->Line, Checker->LineCapacity);
+  }
+  memcpy(Checker->Line + Checker->LineLength, Data, Length);
+  Checker->LineLength += Length;
+}
+
+static ssize_t WhiroCheckWrite(void* Cookie, const char* Buffer, size_t Size){
+  ReferenceChecker* Checker = (ReferenceChecker*) Cookie;
+  pthread_mutex_lock(&CheckerLock);
+  size_t Checked = 0;
+  while (Checked < Size){
+    const char* Data = Buffer + Checked;
+    size_t Remaining = Size - Checked;
+
+    //When the reports match the reference, the whole buffer is compared at once. Only its last line, if it
+    //is not complete, is kept to be checked with the next buffer
+    if (Checker->LineLength == 0 && Checker->End - Checker->Position >= Remaining && memcmp(Data, Checker->Data + Checker->Position, Remaining) == 0){
+      const char* LastBreak = memrchr(Data, '\n', Remaining);
+      size_t Complete = LastBreak ? (size_t)(LastBreak - Data) + 1 : 0;
+      Checker->Position += Complete;
+      WhiroKeepLine(Checker, Data + Complete, Remaining - Complete);
+      break;
+    }
+
+    //Otherwise, the buffer is checked line by line
+    const char* Break = memchr(Data, '\n', Remaining);
+    if (Break == NULL){
+      WhiroKeepLine(Checker, Data, Remaining);
+      break;
+    }
+    if (Checker->LineLength > 0){
+      WhiroKeepLine(Checker, Data, Break - Data);
+      WhiroCheckLine(Checker, Checker->Line, Checker->LineLength);
+      Checker->LineLength = 0;
+    }
+    else
+      WhiroCheckLine(Checker, Data, Break - Data);
+    Checked += Break - Data + 1;
+  }
+  pthread_mutex_unlock(&CheckerLock);
+  return Size;
+}
+
+static void WhiroFinishPoint(ReferenceChecker* Checker){
+  if (Checker->LineLength > 0){
+    WhiroCheckLine(Checker, Checker->Line, Checker->LineLength);
+    Checker->LineLength = 0;
+  }
+
+  //Lines of the reference that the program did not write are missing
+  while (Checker->Position < Checker->End){
+    const char* Expected = Checker->Data + Checker->Position;
+    const char* ExpectedEnd = memchr(Expected, '\n', Checker->End - Checker->Position);
+    size_t ExpectedLength = ExpectedEnd ? (size_t)(ExpectedEnd - Expected) : Checker->End - Checker->Position;
+    Checker->Position += ExpectedLength + 1;
+    WhiroReportDivergence(Checker, Expected, ExpectedLength, NULL, 0);
+  }
+}
+
+static int WhiroCheckClose(void* Cookie){
+  ReferenceChecker* Checker = (ReferenceChecker*) Cookie;
+  pthread_mutex_lock(&CheckerLock);
+  WhiroFinishPoint(Checker);
+  fprintf(stderr, "Whiro checked %lu inspection points against %s: %lu divergences", Checker->QuantChecked, Checker->ReferenceName, Checker->QuantDivergences);
+  if (Checker->QuantMissing > 0)
+    fprintf(stderr, ", %lu points not in the reference", Checker->QuantMissing);
+  fprintf(stderr, "\n");
+  fclose(Checker->Divergences);
+  if (Checker->Reference)
+    WhiroCloseCheckpoint(Checker->Reference);
+  free(Checker->Line);
+  free(Checker);
+  ActiveChecker = NULL;
+  pthread_mutex_unlock(&CheckerLock);
+  return 0;
+}
+
+FILE* WhiroOpenChecker(const char* ReferenceName, const char* OutputName, int Stop){
+  ReferenceChecker* Checker = (ReferenceChecker*) calloc(1, sizeof(ReferenceChecker));
+  Checker->ReferenceName = ReferenceName;
+  Checker->Stop = Stop;
+  Checker->Divergences = fopen(OutputName, "w");
+  if (Checker->Divergences == NULL){
+    printf("Error opening output file %s\n", OutputName);
+    free(Checker);
+    return NULL;
+  }
+
+  Checker->Reference = WhiroOpenCheckpoint(ReferenceName);
+  if (Checker->Reference == NULL){
+    printf("Every report is a divergence from %s\n", ReferenceName);
+    Checker->Data = "";
+  }
+  else{
+    Checker->Data = Checker->Reference->Data;
+    Checker->Size = Checker->Reference->Size;
+  }
+
+  ActiveChecker = Checker;
+  cookie_io_functions_t Functions = {NULL, WhiroCheckWrite, NULL, WhiroCheckClose};
+  return fopencookie(Checker, "w", Functions);
+}
+
+void WhiroCheckPoint(FILE* OutputFile, char* Point, long CallCounter){
+  //Flushing the stream checks the reports written since the previous point. The stream stays locked until the
+  //report of the new point is found, so the reports of other threads are not checked against the previous one
+  flockfile(OutputFile);
+  pthread_mutex_lock(&CheckerLock);
+  fflush(OutputFile);
+  ReferenceChecker* Checker = ActiveChecker;
+  if (Checker == NULL){
+    pthread_mutex_unlock(&CheckerLock);
+    funlockfile(OutputFile);
+    return;
+  }
+  WhiroFinishPoint(Checker);
+
+  //Reports of points missing from the reference are divergences as a whole
+  WhiroCheckpointEntry Entry;
+  long Id = Checker->Reference ? WhiroFindCheckpointPoint(Checker->Reference, Point) : -1;
+  if (Id < 0 || !WhiroFindCheckpointReport(Checker->Reference, Id, CallCounter, &Entry)){
+    Checker->QuantMissing++;
+    Checker->Position = Checker->End = 0;
+    pthread_mutex_unlock(&CheckerLock);
+    funlockfile(OutputFile);
+    return;
+  }
+  Checker->Position = Checker->Reference->Blocks[Entry.Block] + Entry.Start;
+  Checker->End = Checker->Position + Entry.Length;
+  Checker->QuantChecked++;
+  pthread_mutex_unlock(&CheckerLock);
+  funlockfile(OutputFile);
+}
@@ -0,0 +1,93 @@
+#include "../include/Whiro.h"
+
+#ifdef WHIRO_PROFILE
+#include<stdarg.h>
+#include<time.h>
+#include<sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include<x86intrin.h>
+#endif
+
+static const char *SectionNames[WHIRO_QUANT_SECTIONS] = {"heap table", "track pointer", "hashing", "inspect data", "entire heap", "output"};
+
+//Totals of every section, updated by all the threads
+static uint64_t SectionCalls[WHIRO_QUANT_SECTIONS];
+static uint64_t SectionTicks[WHIRO_QUANT_SECTIONS];
+//Sections running in each thread, so sections entered again are measured once
+static __thread int SectionDepth[WHIRO_QUANT_SECTIONS];
+
+static int Registered = 0;
+static uint64_t FirstTicks = 0;
+static struct timespec FirstTime;
+
+static inline uint64_t WhiroProfileNow(){
+  //The time stamp counter is read in a few cycles. It is converted to seconds at the exit
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec Now;
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (uint64_t) Now.tv_sec * 1000000000ULL + Now.tv_nsec;
+#endif
+}
+
+uint64_t WhiroProfileBegin(int Section){
+  if (!Registered && !__atomic_exchange_n(&Registered, 1, __ATOMIC_ACQ_REL)){
+    clock_gettime(CLOCK_MONOTONIC, &FirstTime);
+    FirstTicks = WhiroProfileNow();
+    atexit(WhiroDumpRuntimeProfile);
+  }
+
+  __atomic_fetch_add(&SectionCalls[Section], 1, __ATOMIC_RELAXED);
+  if (SectionDepth[Section]++ > 0)
+    return 0;
+  return WhiroProfileNow();
+}
+
+void WhiroProfileEnd(int Section, uint64_t Start){
+  if (--SectionDepth[Section] > 0)
+    return;
+  __atomic_fetch_add(&SectionTicks[Section], WhiroProfileNow() - Start, __ATOMIC_RELAXED);
+}
+
+int WhiroProfiledPrintf(FILE* Stream, const char* Format, ...){
+  WHIRO_PROFILE_BEGIN(OUTPUT);
+  va_list Args;
+  va_start(Args, Format);
+  int Written = vfprintf(Stream, Format, Args);
+  va_end(Args);
+  WHIRO_PROFILE_END(OUTPUT);
+  return Written;
+}
+
+size_t WhiroProfiledWrite(const void* Data, size_t Size, size_t Count, FILE* Stream){
+  WHIRO_PROFILE_BEGIN(OUTPUT);
+  size_t Written = fwrite(Data, Size, Count, Stream);
+  WHIRO_PROFILE_END(OUTPUT);
+  return Written;
+}
+
+void WhiroDumpRuntimeProfile(){
+  struct timespec LastTime;
+  clock_gettime(CLOCK_MONOTONIC, &LastTime);
+  uint64_t LastTicks = WhiroProfileNow();
+  double Seconds = (LastTime.tv_sec - FirstTime.tv_sec) + (LastTime.tv_nsec - FirstTime.tv_nsec) / 1e9;
+  //Ticks are converted with the rate measured between the first section and the exit
+  double TicksPerSecond = (Seconds > 0 && LastTicks > FirstTicks) ? (LastTicks - FirstTicks) / Seconds : 1e9;
+
+  struct rusage Usage;
+  getrusage(RUSAGE_SELF, &Usage);
+  double KernelSeconds = Usage.ru_stime.tv_sec + Usage.ru_stime.tv_usec / 1e6;
+
+  fprintf(stderr, "\nWhiro runtime profile (%.2f s since the first section)\n", Seconds);
+  fprintf(stderr, "%-16s %16s %12s %8s\n", "section", "calls", "seconds", "% time");
+  for (int i = 0; i < WHIRO_QUANT_SECTIONS; i++){
+    double SectionSeconds = SectionTicks[i] / TicksPerSecond;
+    fprintf(stderr, "%-16s %16lu %12.4f %7.1f%%\n", SectionNames[i], SectionCalls[i], SectionSeconds, Seconds > 0 ? 100 * SectionSeconds / Seconds : 0);
+  }
+  //The writes to the output file happen inside the kernel, which is not measured by the sections
+  fprintf(stderr, "%-16s %16s %12.4f %7.1f%%\n", "kernel (I/O)", "-", KernelSeconds, Seconds > 0 ? 100 * KernelSeconds / Seconds : 0);
+  fprintf(stderr, "Sections are inclusive: output also counts in the sections that write it\n");
+}
+
+#endif
@@ -0,0 +1,25 @@
+#include "../include/Whiro.h"
+
+FILE* WhiroOutputFile = NULL;
+static int RuntimeClaimed = 0;
+
+static void WhiroCloseSharedOutput(){
+  if(WhiroOutputFile == NULL)
+    return;
+  
+  //The unit that defines main may not be instrumented, so the output file is finished here instead of at the
+  //return of main. Snapshots still running are merged, and the index goes after the last report
+  WhiroWaitSnapshots(WhiroOutputFile);
+  WhiroWriteIndex(WhiroOutputFile);
+  fclose(WhiroOutputFile);
+  WhiroOutputFile = NULL;
+}
+
+int WhiroClaimRuntime(){
+  //Shared libraries may be loaded by many threads at once
+  if(!__sync_bool_compare_and_swap(&RuntimeClaimed, 0, 1))
+    return 0;
+  
+  atexit(WhiroCloseSharedOutput);
+  return 1;
+}
@@ -0,0 +1,136 @@
+#include "../include/Whiro.h"
+#include<fcntl.h>
+#include<errno.h>
+#include<unistd.h>
+#include<sys/wait.h>
+
+//Snapshot mode settings
+static char *SnapshotName = NULL;
+static int MaxSnapshots = 0;
+//Children still running, in the order they were forked, and whether this process is one of them. Only
+//these children are waited for, so the children of the program itself are left to the program
+static pid_t *ActivePids = NULL;
+static int ActiveSnapshots = 0;
+static int InSnapshot = 0;
+//Snapshots are numbered in the order of the inspection points. Those up to MergedSnapshots are already
+//in the output file
+static unsigned long QuantSnapshots = 0, MergedSnapshots = 0;
+
+void WhiroSetSnapshotMode(const char* OutputName, int MaxChildren){
+  SnapshotName = strdup(OutputName);
+  MaxSnapshots = (MaxChildren > 0) ? MaxChildren : 1;
+  ActivePids = (pid_t*) malloc(sizeof(pid_t) * MaxSnapshots);
+}
+
+static char* WhiroGetSnapshotName(unsigned long Snapshot){
+  int Length = snprintf(NULL, 0, "%s.%lu", SnapshotName, Snapshot);
+  char *Name = (char*) malloc(Length + 1);
+  snprintf(Name, Length + 1, "%s.%lu", SnapshotName, Snapshot);
+  return Name;
+}
+
+static int WhiroReapSnapshot(int Snapshot, int Options){
+  //A child that cannot be waited for (e.g., the program ignores SIGCHLD) is gone as well
+  pid_t Child;
+  do
+    Child = waitpid(ActivePids[Snapshot], NULL, Options);
+  while (Child < 0 && errno == EINTR);
+  if (Child == 0)
+    return 0;
+
+  ActiveSnapshots--;
+  memmove(&ActivePids[Snapshot], &ActivePids[Snapshot + 1], sizeof(pid_t) * (ActiveSnapshots - Snapshot));
+  return 1;
+}
+
+static void WhiroReapSnapshots(int Block){
+  //Collect the children that finished. If Block is set and none did, wait for the oldest one
+  int Reaped = 0;
+  for (int i = 0; i < ActiveSnapshots; ){
+    if (WhiroReapSnapshot(i, WNOHANG))
+      Reaped++;
+    else
+      i++;
+  }
+  if (Block && !Reaped && ActiveSnapshots > 0)
+    WhiroReapSnapshot(0, 0);
+}
+
+static void WhiroMergeSnapshots(FILE *OutputFile){
+  //Wait for every child and append their reports to the output file, in order
+  while (ActiveSnapshots > 0)
+    WhiroReapSnapshots(1);
+
+  char Buffer[65536];
+  for (; MergedSnapshots < QuantSnapshots; MergedSnapshots++){
+    char *Name = WhiroGetSnapshotName(MergedSnapshots + 1);
+    FILE *Snapshot = fopen(Name, "r");
+    if (Snapshot){
+      size_t Read;
+      while ((Read = fread(Buffer, 1, sizeof(Buffer), Snapshot)) > 0)
+        WhiroProfiledWrite(Buffer, 1, Read, OutputFile);
+      fclose(Snapshot);
+      remove(Name);
+    }
+    else
+      printf("Error opening snapshot file %s\n", Name);
+    free(Name);
+  }
+}
+
+int WhiroBeginSnapshot(FILE *OutputFile){
+  if (SnapshotName == NULL || InSnapshot)
+    return 1;
+
+  //Bound the memory held by copy-on-write images
+  WhiroReapSnapshots(0);
+  while (ActiveSnapshots >= MaxSnapshots)
+    WhiroReapSnapshots(1);
+
+  //The static variables that changed are found by the program, so it keeps track of them across snapshots
+  if (TrackStatics)
+    WhiroUpdateStatics();
+
+  //Flush the output file, otherwise the child would write the pending data again
+  fflush(OutputFile);
+  char *Name = WhiroGetSnapshotName(QuantSnapshots + 1);
+  pid_t Child = fork();
+  if (Child < 0){
+    //If we cannot fork, the state is reported by the program itself, after the reports before it
+    free(Name);
+    WhiroMergeSnapshots(OutputFile);
+    return 1;
+  }
+
+  QuantSnapshots++;
+  if (Child == 0){
+    //The child writes its report to a file of its own
+    InSnapshot = 1;
+    int Snapshot = open(Name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (Snapshot < 0)
+      _exit(1);
+    dup2(Snapshot, fileno(OutputFile));
+    close(Snapshot);
+    free(Name);
+    return 1;
+  }
+
+  free(Name);
+  ActivePids[ActiveSnapshots++] = Child;
+  return 0;
+}
+
+void WhiroEndSnapshot(FILE *OutputFile){
+  //The child must not run the exit handlers of the program, nor flush its other buffers
+  if (InSnapshot){
+    fflush(OutputFile);
+    _exit(0);
+  }
+}
+
+void WhiroWaitSnapshots(FILE *OutputFile){
+  if (SnapshotName == NULL || InSnapshot)
+    return;
+
+  WhiroMergeSnapshots(OutputFile);
+}
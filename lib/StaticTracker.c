@@ -0,0 +1,167 @@
+#include "../include/Whiro.h"
+#include<fcntl.h>
+#include<unistd.h>
+
+//Usage mode setting. If it is set, static variables are reported only when their contents change
+int TrackStatics = 0;
+
+//The soft-dirty bit of an entry of /proc/self/pagemap
+#define WHIRO_SOFT_DIRTY (1ULL << 55)
+
+/**
+ * This structure describes a static variable being tracked
+ * Address is the address of the variable
+ * Size is the size of the variable in bytes
+ * Hashcode is the hashcode of the contents of the variable when it was last checked
+ * Changed tells whether the variable changed since the last inspection point
+ * Reported tells whether the variable was already reported once
+ */
+typedef struct {
+  char* Address;
+  uint64_t Size;
+  uint64_t Hashcode;
+  int Changed;
+  int Reported;
+} TrackedStatic;
+
+static TrackedStatic *Statics = NULL;
+static int QuantStatics = 0, StaticsCapacity = 0;
+static long PageSize = 0;
+//Whether the soft-dirty bits are available. It is unknown (-1) until the first update
+static int SoftDirty = -1;
+static int Pagemap = -1, ClearRefs = -1;
+//The entries of the pagemap of the pages read last, from ReadFirst to ReadLast. Variables may be spread over the
+//program and its shared libraries, so the pages of each variable are read by themselves. The buffer holds the pages
+//of the largest variable
+static uint64_t *PageEntries = NULL;
+static uintptr_t EntriesCapacity = 0, ReadFirst = 1, ReadLast = 0;
+//Whether the static variables were already checked for the current inspection point
+static int StaticsFresh = 0;
+
+void WhiroTrackStatic(void* Address, uint64_t Size){
+  TrackStatics = 1;
+  if (PageSize == 0)
+    PageSize = sysconf(_SC_PAGESIZE);
+
+  if (QuantStatics == StaticsCapacity){
+    StaticsCapacity = StaticsCapacity ? 2 * StaticsCapacity : 64;
+    Statics = (TrackedStatic*) realloc(Statics, sizeof(TrackedStatic) * StaticsCapacity);
+  }
+  TrackedStatic *Static = &Statics[QuantStatics++];
+  Static->Address = (char*) Address;
+  Static->Size = Size;
+  Static->Hashcode = 0;
+  Static->Changed = 1;
+  Static->Reported = 0;
+
+  uintptr_t First = (uintptr_t) Address / PageSize;
+  uintptr_t Last = ((uintptr_t) Address + (Size ? Size - 1 : 0)) / PageSize;
+  if (Last - First + 1 > EntriesCapacity){
+    EntriesCapacity = Last - First + 1;
+    PageEntries = (uint64_t*) realloc(PageEntries, EntriesCapacity * sizeof(uint64_t));
+  }
+}
+
+static void WhiroClearSoftDirty(){
+  if (pwrite(ClearRefs, "4", 1, 0) != 1)
+    SoftDirty = 0;
+}
+
+static int WhiroReadPageEntries(uintptr_t First, uintptr_t Last, uint64_t *Entries){
+  size_t Bytes = (Last - First + 1) * sizeof(uint64_t);
+  return pread(Pagemap, Entries, Bytes, First * sizeof(uint64_t)) == (ssize_t) Bytes;
+}
+
+static void WhiroProbeSoftDirty(){
+  //The soft-dirty bits are used only if a page written after clearing them is reported as dirty
+  SoftDirty = 0;
+  Pagemap = open("/proc/self/pagemap", O_RDONLY);
+  ClearRefs = open("/proc/self/clear_refs", O_WRONLY);
+  if (Pagemap < 0 || ClearRefs < 0)
+    return;
+
+  volatile char *ProbePage = (char*) aligned_alloc(PageSize, PageSize);
+  if (ProbePage == NULL)
+    return;
+  ProbePage[0] = 1;
+  SoftDirty = 1;
+  WhiroClearSoftDirty();
+  ProbePage[0] = 2;
+  uint64_t Entry = 0;
+  uintptr_t Page = (uintptr_t) ProbePage / PageSize;
+  if (!SoftDirty || !WhiroReadPageEntries(Page, Page, &Entry) || !(Entry & WHIRO_SOFT_DIRTY))
+    SoftDirty = 0;
+  free((void*) ProbePage);
+}
+
+static int WhiroIsStaticDirty(TrackedStatic *Static){
+  //Neighbouring variables often share their pages, so the pages read last are reused when they cover the variable
+  uintptr_t First = (uintptr_t) Static->Address / PageSize;
+  uintptr_t Last = ((uintptr_t) Static->Address + (Static->Size ? Static->Size - 1 : 0)) / PageSize;
+  if (First < ReadFirst || Last > ReadLast){
+    if (!WhiroReadPageEntries(First, Last, PageEntries)){
+      ReadFirst = 1;
+      ReadLast = 0;
+      return 1;
+    }
+    ReadFirst = First;
+    ReadLast = Last;
+  }
+
+  for (uintptr_t Page = First; Page <= Last; Page++){
+    if (PageEntries[Page - ReadFirst] & WHIRO_SOFT_DIRTY)
+      return 1;
+  }
+  return 0;
+}
+
+static uint64_t WhiroHashStatic(TrackedStatic *Static){
+  uint64_t Hashcode = Static->Size;
+  uint64_t Word;
+  uint64_t i = 0;
+  for (; i + sizeof(uint64_t) <= Static->Size; i += sizeof(uint64_t)){
+    memcpy(&Word, Static->Address + i, sizeof(uint64_t));
+    Hashcode = WhiroHashCombine(Hashcode, Word);
+  }
+  for (; i < Static->Size; i++)
+    Hashcode = WhiroHashCombine(Hashcode, (unsigned char) Static->Address[i]);
+  return Hashcode;
+}
+
+void WhiroUpdateStatics(){
+  if (SoftDirty == -1)
+    WhiroProbeSoftDirty();
+
+  //Without the soft-dirty bits, every static variable is hashed. The pagemap changes between inspection points, so
+  //no page read before is reused
+  int Dirty = SoftDirty;
+  ReadFirst = 1;
+  ReadLast = 0;
+  for (int i = 0; i < QuantStatics; i++){
+    TrackedStatic *Static = &Statics[i];
+    Static->Changed = !Static->Reported;
+    if (Dirty && Static->Reported && !WhiroIsStaticDirty(Static))
+      continue;
+
+    //A page may be written without changing the variable, so its contents decide whether it is reported
+    uint64_t Hashcode = WhiroHashStatic(Static);
+    if (Hashcode != Static->Hashcode)
+      Static->Changed = 1;
+    Static->Hashcode = Hashcode;
+    Static->Reported = 1;
+  }
+
+  if (Dirty)
+    WhiroClearSoftDirty();
+  StaticsFresh = 1;
+}
+
+void WhiroBeginStatics(){
+  if (!StaticsFresh)
+    WhiroUpdateStatics();
+  StaticsFresh = 0;
+}
+
+WHIRO_HOT int WhiroStaticChanged(int Id){
+  return Statics[Id].Changed;
+}
@@ -3,6 +3,51 @@
 TypeDescriptor* TypeTable = NULL;
 extern int InsHeap, InsStack, MemFilter, Precise;
 
+//In separate compilation, the Type Table grows as the units register theirs. The entries are found by the
+//structural hash of their types, in an open addressing table whose slots hold the index of an entry plus one
+static int TypeTableSize = 0;
+static uint64_t* EntryHashes = NULL;
+static int* HashSlots = NULL;
+static int QuantSlots = 0;
+
+static void WhiroReadTypeDescriptor(FILE* TypeTableFile, TypeDescriptor* Type, int Separate){
+  fread(&Type->Name, sizeof(char), MAX_NAME_LENGTH + 1, TypeTableFile);
+  fread(&Type->QuantFields, sizeof(int), 1, TypeTableFile);
+  Type->Fields = (Field*)malloc(sizeof(struct Field) * Type->QuantFields);
+  for(int j = 0; j < Type->QuantFields; j++){
+    fread(Type->Fields[j].Name, sizeof(char), MAX_NAME_LENGTH + 1, TypeTableFile);
+    fread(&Type->Fields[j].Format, sizeof(int), 1, TypeTableFile);
+    fread(&Type->Fields[j].Offset, sizeof(int), 1, TypeTableFile);
+    fread(&Type->Fields[j].BaseTypeIndex, sizeof(int), 1, TypeTableFile);
+    //Base types in the Type Table of the unit are marked with negative indexes, until the unit is mapped
+    int Local = 0;
+    if(Separate)
+      fread(&Local, sizeof(int), 1, TypeTableFile);
+    if(Local)
+      Type->Fields[j].BaseTypeIndex = -Type->Fields[j].BaseTypeIndex - 1;
+  }
+}
+
+static int* WhiroFindHashSlot(uint64_t Hash){
+  int Slot = (int)(Hash & (uint64_t)(QuantSlots - 1));
+  while(HashSlots[Slot] != 0 && EntryHashes[HashSlots[Slot] - 1] != Hash)
+    Slot = (Slot + 1) & (QuantSlots - 1);
+  return &HashSlots[Slot];
+}
+
+static void WhiroReserveHashSlots(int QuantEntries){
+  if(2 * QuantEntries <= QuantSlots)
+    return;
+  int NewQuantSlots = QuantSlots ? QuantSlots : 64;
+  while(2 * QuantEntries > NewQuantSlots)
+    NewQuantSlots *= 2;
+  free(HashSlots);
+  HashSlots = (int*)calloc(NewQuantSlots, sizeof(int));
+  QuantSlots = NewQuantSlots;
+  for(int i = 0; i < TypeTableSize; i++)
+    *WhiroFindHashSlot(EntryHashes[i]) = i + 1;
+}
+
 void WhiroOpenTypeTable(const char* ProgramName, int TableSize, int InsHeapArg, int InsStackArg, int PreciseArg){
   //Set the usage mode settings  
   InsHeap = InsHeapArg;
@@ -10,6 +55,10 @@ void WhiroOpenTypeTable(const char* ProgramName, int TableSize, int InsHeapArg,
   MemFilter = InsHeap || InsStack;
   Precise = PreciseArg;
   
+  //In separate compilation, the units registered their Type Tables before main
+  if(ProgramName == NULL)
+    return;
+  
   //Allocate and read the Type Table
   TypeTable = (TypeDescriptor*)malloc(sizeof(struct TypeDescriptor) * TableSize);
   FILE* TypeTableFile = fopen(ProgramName, "rb");
@@ -18,18 +67,47 @@ void WhiroOpenTypeTable(const char* ProgramName, int TableSize, int InsHeapArg,
     exit(1);
   }
   	
+  for(int i = 0; i < TableSize; i++)
+    WhiroReadTypeDescriptor(TypeTableFile, &TypeTable[i], 0);
+  fclose(TypeTableFile);
+}
+
+void WhiroRegisterTypeTable(const char* FileName, int TableSize, int* Map){
+  FILE* TypeTableFile = fopen(FileName, "rb");
+  if(TypeTableFile == NULL){
+    printf("Error opening Type Table file %s\n", FileName);
+    exit(1);
+  }
+  
+  TypeTable = (TypeDescriptor*)realloc(TypeTable, sizeof(struct TypeDescriptor) * (TypeTableSize + TableSize));
+  EntryHashes = (uint64_t*)realloc(EntryHashes, sizeof(uint64_t) * (TypeTableSize + TableSize));
+  WhiroReserveHashSlots(TypeTableSize + TableSize);
+  
+  //Entries whose types are already in the Type Table are read only to be discarded
+  int First = TypeTableSize;
   for(int i = 0; i < TableSize; i++){
-    fread(&TypeTable[i].Name, sizeof(char), MAX_NAME_LENGTH + 1, TypeTableFile);
-    fread(&TypeTable[i].QuantFields, sizeof(int), 1, TypeTableFile);
-    TypeTable[i].Fields = (Field*)malloc(sizeof(struct Field) * TypeTable[i].QuantFields);
+    uint64_t Hash;
+    fread(&Hash, sizeof(uint64_t), 1, TypeTableFile);
+    WhiroReadTypeDescriptor(TypeTableFile, &TypeTable[TypeTableSize], 1);
+    int* Slot = WhiroFindHashSlot(Hash);
+    if(*Slot != 0){
+      free(TypeTable[TypeTableSize].Fields);
+      Map[i] = *Slot - 1;
+      continue;
+    }
+    EntryHashes[TypeTableSize] = Hash;
+    *Slot = TypeTableSize + 1;
+    Map[i] = TypeTableSize++;
+  }
+  fclose(TypeTableFile);
+  
+  //The base types of the new entries may come after them in the file, so they are mapped once every entry is known
+  for(int i = First; i < TypeTableSize; i++){
     for(int j = 0; j < TypeTable[i].QuantFields; j++){
-      fread(TypeTable[i].Fields[j].Name, sizeof(char), MAX_NAME_LENGTH + 1, TypeTableFile);
-      fread(&TypeTable[i].Fields[j].Format, sizeof(int), 1, TypeTableFile);
-      fread(&TypeTable[i].Fields[j].Offset, sizeof(int), 1, TypeTableFile);
-      fread(&TypeTable[i].Fields[j].BaseTypeIndex, sizeof(int), 1, TypeTableFile);
-   }
-  }	 
- 
+      if(TypeTable[i].Fields[j].BaseTypeIndex < 0)
+        TypeTable[i].Fields[j].BaseTypeIndex = Map[-TypeTable[i].Fields[j].BaseTypeIndex - 1];
+    }
+  }
 }
 
 int WhiroIsScalarType(int Format){
@@ -0,0 +1,214 @@
+#include "../include/Whiro.h"
+#include<signal.h>
+#include<unistd.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+#include<linux/hw_breakpoint.h>
+
+//The code of the signals sent by perf events, which older C libraries do not define
+#ifndef TRAP_PERF
+#define TRAP_PERF 6
+#endif
+
+/**
+ * This structure describes a watched variable
+ * Address is the address of the variable
+ * Size is the size of the variable in bytes
+ * Name is the name of the variable
+ * Format is the format of the type of the variable
+ * Event is the file descriptor of the breakpoint
+ */
+typedef struct {
+  char* Address;
+  uint64_t Size;
+  char* Name;
+  int Format;
+  int Event;
+} WatchedVariable;
+
+/**
+ * This structure holds a write to a watched variable
+ * Watch is the index of the variable
+ * Function is the identifier of the counter of the function that wrote it
+ * Counter is the value of that counter
+ * Value holds the bytes of the variable after the write
+ */
+typedef struct {
+  int Watch;
+  int Function;
+  uint64_t Counter;
+  uint64_t Value;
+} WatchRecord;
+
+//Processors have at most 4 hardware breakpoints
+#define WHIRO_MAX_WATCHES 4
+
+static WatchedVariable Watches[WHIRO_MAX_WATCHES];
+static int QuantWatches = 0;
+static char *WatchName = NULL;
+static WatchRecord *Records = NULL;
+static uint64_t RecordsCapacity = 0;
+//Number of writes recorded so far. The ring buffer keeps the last RecordsCapacity of them
+static uint64_t QuantRecords = 0;
+
+static void WhiroRecordWrite(int Signal, siginfo_t *Info, void *Context){
+  (void) Signal;
+  (void) Context;
+  if (Info->si_code != TRAP_PERF)
+    return;
+
+  //The breakpoint traps right after the write, so the variable already holds the new value
+  for (int i = 0; i < QuantWatches; i++){
+    if (Info->si_addr != Watches[i].Address)
+      continue;
+
+    WatchRecord *Record = &Records[__atomic_fetch_add(&QuantRecords, 1, __ATOMIC_RELAXED) % RecordsCapacity];
+    Record->Watch = i;
+    Record->Function = WhiroCurrentFunction;
+    Record->Counter = WhiroReadCounter(WhiroCurrentFunction);
+    Record->Value = 0;
+    memcpy(&Record->Value, Watches[i].Address, Watches[i].Size);
+    return;
+  }
+}
+
+void WhiroSetWatchpoints(const char* OutputName, int Capacity){
+  WatchName = strdup(OutputName);
+  RecordsCapacity = (Capacity > 0) ? Capacity : 1;
+  Records = (WatchRecord*) calloc(RecordsCapacity, sizeof(WatchRecord));
+
+  struct sigaction Action;
+  memset(&Action, 0, sizeof(struct sigaction));
+  Action.sa_sigaction = WhiroRecordWrite;
+  Action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&Action.sa_mask);
+  sigaction(SIGTRAP, &Action, NULL);
+  atexit(WhiroDumpWatchpoints);
+}
+
+void WhiroWatchStatic(void* Address, uint64_t Size, char* Name, int Format){
+  if (QuantWatches == WHIRO_MAX_WATCHES){
+    printf("Whiro can watch at most %d variables. Skipping %s\n", WHIRO_MAX_WATCHES, Name);
+    return;
+  }
+  if ((Size != 1 && Size != 2 && Size != 4 && Size != 8) || (uintptr_t) Address % Size != 0){
+    printf("Whiro can only watch aligned variables of 1, 2, 4 or 8 bytes. Skipping %s\n", Name);
+    return;
+  }
+
+  //The breakpoint sends SIGTRAP to the thread that writes the variable, including threads created later
+  struct perf_event_attr Attributes;
+  memset(&Attributes, 0, sizeof(struct perf_event_attr));
+  Attributes.type = PERF_TYPE_BREAKPOINT;
+  Attributes.size = sizeof(struct perf_event_attr);
+  Attributes.bp_type = HW_BREAKPOINT_W;
+  Attributes.bp_addr = (uintptr_t) Address;
+  Attributes.bp_len = Size;
+  Attributes.sample_period = 1;
+  Attributes.sample_type = PERF_SAMPLE_ADDR;
+  Attributes.exclude_kernel = 1;
+  Attributes.exclude_hv = 1;
+  Attributes.inherit = 1;
+  Attributes.remove_on_exec = 1;
+  Attributes.sigtrap = 1;
+
+  int Event = syscall(__NR_perf_event_open, &Attributes, 0, -1, -1, 0);
+  if (Event < 0){
+    printf("Error arming a hardware breakpoint on %s\n", Name);
+    return;
+  }
+
+  WatchedVariable *Watch = &Watches[QuantWatches++];
+  Watch->Address = (char*) Address;
+  Watch->Size = Size;
+  Watch->Name = Name;
+  Watch->Format = Format;
+  Watch->Event = Event;
+}
+
+static void WhiroPrintWatchedValue(FILE *Output, WatchRecord *Record){
+  WatchedVariable *Watch = &Watches[Record->Watch];
+  void *Value = &Record->Value;
+  WhiroProfiledPrintf(Output, "%s %s %lu : ", Watch->Name, WhiroGetCounterName(Record->Function), Record->Counter);
+  switch (Watch->Format){
+    case 1:
+      WhiroProfiledPrintf(Output, "%.2lf\n", *(double*)Value);
+      break;
+
+    case 2:
+      WhiroProfiledPrintf(Output, "%.2f\n", *(float*)Value);
+      break;
+
+    case 3:
+      WhiroProfiledPrintf(Output, "%hi\n", *(short*)Value);
+      break;
+
+    case 4:
+      WhiroProfiledPrintf(Output, "%ld\n", *(long*)Value);
+      break;
+
+    case 5:
+      WhiroProfiledPrintf(Output, "%lld\n", *(long long*)Value);
+      break;
+
+    case 6:
+      WhiroProfiledPrintf(Output, "%d\n", *(int*)Value);
+      break;
+
+    case 7:
+      //Characters are printed as the inspection points print them, with '@' for those that are not printable
+      WhiroProfiledPrintf(Output, "%c\n", isprint(*(char*)Value) ? *(char*)Value : '@');
+      break;
+
+    case 8:
+      if (isprint(*(unsigned char*)Value))
+        WhiroProfiledPrintf(Output, "%u\n", *(unsigned char*)Value);
+      else
+        WhiroProfiledPrintf(Output, "@\n");
+      break;
+
+    case 9:
+      WhiroProfiledPrintf(Output, "%hu\n", *(unsigned short*)Value);
+      break;
+
+    case 10:
+      WhiroProfiledPrintf(Output, "%lu\n", *(unsigned long*)Value);
+      break;
+
+    case 11:
+      WhiroProfiledPrintf(Output, "%llu\n", *(unsigned long long*)Value);
+      break;
+
+    case 12:
+      WhiroProfiledPrintf(Output, "%u\n", *(unsigned int*)Value);
+      break;
+
+    default:
+      WhiroProfiledPrintf(Output, "%p\n", *(void**)Value);
+  }
+}
+
+void WhiroDumpWatchpoints(){
+  for (int i = 0; i < QuantWatches; i++){
+    ioctl(Watches[i].Event, PERF_EVENT_IOC_DISABLE, 0);
+    close(Watches[i].Event);
+  }
+
+  FILE* Output = fopen(WatchName, "w");
+  if (Output == NULL){
+    printf("Error opening watch file %s\n", WatchName);
+    return;
+  }
+
+  //If the ring buffer wrapped around, the oldest writes were overwritten
+  uint64_t First = 0;
+  if (QuantRecords > RecordsCapacity){
+    First = QuantRecords - RecordsCapacity;
+    WhiroProfiledPrintf(Output, "(%lu older writes were dropped)\n", First);
+  }
+  for (uint64_t i = First; i < QuantRecords; i++)
+    WhiroPrintWatchedValue(Output, &Records[i % RecordsCapacity]);
+
+  fclose(Output);
+}
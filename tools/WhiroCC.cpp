@@ -0,0 +1,514 @@
+//===- WhiroCC.cpp - Instrument and build programs with Whiro in one process ---------------===//
+// Copyright (C) 2021  José Wesley de S. Magalhães
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//===----------------------------------------------------------------------===//
+//
+// This file implements whiro-cc, a driver that builds instrumented programs. Each input
+// is a C file or an LLVM bytecode. The module of an input is kept in memory while it is
+// prepared (mem2reg and mergereturn), instrumented by the Memory Monitor, linked with the
+// bytecode of the runtime and compiled to an object file, which is then linked into an
+// executable. Many inputs are built at once by a pool of threads, each one with a context
+// of its own. The options of the Memory Monitor are options of this driver too.
+// The driver can also run as a server that keeps LLVM loaded and builds the inputs sent to
+// a Unix socket by other instances of the driver. The instances of the pass in the server
+// share the descriptors of the types they find, so the types of common headers are
+// described only once.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Pass.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h" //To read bytecodes and textual IR
+#include "llvm/Bitcode/BitcodeReader.h" //To read the runtime
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Linker/Linker.h" //To link the runtime into the program
+#include "llvm/Transforms/Utils.h" //To use mem2reg
+#include "llvm/Transforms/Utils/UnifyFunctionExitNodes.h" //To use mergereturn
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h" //To optimize the program with the runtime
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Config/llvm-config.h"
+#if LLVM_VERSION_MAJOR >= 14
+#include "llvm/MC/TargetRegistry.h" //Moved from Support in LLVM 14
+#else
+#include "llvm/Support/TargetRegistry.h"
+#endif
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h" //To run clang and the linker
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../include/MemoryMonitor.h"
+
+using namespace llvm;
+
+static cl::OptionCategory DriverCategory("whiro-cc options");
+
+static cl::list<std::string> Inputs (cl::Positional, cl::ZeroOrMore, cl::desc("<input .c, .bc or .ll files>"), cl::cat(DriverCategory));
+//This option names the executable. It is only accepted with a single input. Otherwise, each input x.c is built as x.out
+static cl::opt<std::string> OutputName ("o", cl::init(""), cl::desc("Name of the executable (only with a single input)"), cl::value_desc("filename"), cl::cat(DriverCategory));
+//This option sets the number of inputs built at once
+static cl::opt<unsigned> Jobs ("j", cl::init(0), cl::desc("Number of inputs built at once (default: number of cores)"), cl::value_desc("number"), cl::cat(DriverCategory));
+//This option gives the runtime, linked into every program as a single bytecode
+static cl::opt<std::string> RuntimeBitcode ("runtime", cl::init(WHIRO_RUNTIME_BITCODE), cl::desc("Bytecode of the Whiro runtime"), cl::value_desc("filename"), cl::cat(DriverCategory));
+//This flag tells the driver to optimize the program together with the runtime, so the hot calls to the runtime are inlined
+static cl::opt<bool> Lto ("lto", cl::init(false), cl::desc("Optimize the instrumented program together with the runtime"), cl::cat(DriverCategory));
+//This flag tells the driver to stop after the object file is written
+static cl::opt<bool> OnlyCompile ("c", cl::init(false), cl::desc("Write the object file of each input instead of an executable"), cl::cat(DriverCategory));
+//This flag tells the driver to write the instrumented module as a bytecode, as opt -memoryMonitor does
+static cl::opt<bool> EmitBitcode ("emit-wbc", cl::init(false), cl::desc("Write the instrumented module of each input as x.wbc instead of an executable"), cl::cat(DriverCategory));
+//These options give the programs that compile C files and link executables
+static cl::opt<std::string> ClangPath ("clang", cl::init(WHIRO_LLVM_BIN "/clang"), cl::desc("The clang used to compile C files"), cl::value_desc("path"), cl::cat(DriverCategory));
+static cl::opt<std::string> LinkerPath ("ld", cl::init("cc"), cl::desc("The compiler used to link executables"), cl::value_desc("path"), cl::cat(DriverCategory));
+static cl::list<std::string> LinkFlags ("Wl", cl::CommaSeparated, cl::desc("Extra flags to link the executables"), cl::value_desc("flag,..."), cl::cat(DriverCategory));
+//This option makes the driver a server that builds the inputs sent to a socket, until it is stopped
+static cl::opt<std::string> ServeSocket ("serve", cl::init(""), cl::desc("Build the inputs sent to this socket, until stopped"), cl::value_desc("socket"), cl::cat(DriverCategory));
+//This option sends the inputs to a server instead of building them
+static cl::opt<std::string> ConnectSocket ("connect", cl::init(""), cl::desc("Send the inputs to the server listening to this socket"), cl::value_desc("socket"), cl::cat(DriverCategory));
+
+//! An input to build. The paths are relative to Directory, the working directory of the client, or to the
+//! current directory if it is empty
+struct BuildRequest {
+  std::string Directory;
+  std::string Input;
+  std::string Output;
+};
+
+//Messages of different inputs are not interleaved
+static std::mutex ErrorsLock;
+//The last error of the thread, which the server sends back to the client
+static thread_local std::string LastError;
+
+static bool Fail(StringRef Input, const Twine &Message){
+  LastError = Message.str();
+  std::lock_guard<std::mutex> Guard(ErrorsLock);
+  errs() << "whiro-cc: " << Input << ": " << Message << "\n";
+  return false;
+}
+
+static bool RunProgram(StringRef Input, StringRef Program, ArrayRef<StringRef> Args){
+  ErrorOr<std::string> Path = sys::findProgramByName(Program);
+  if(!Path)
+    return Fail(Input, "cannot find " + Program);
+  std::string Message;
+  int Status = sys::ExecuteAndWait(*Path, Args, None, {}, 0, 0, &Message);
+  if(Status != 0)
+    return Fail(Input, Program + " failed" + (Message.empty() ? "" : ": " + Message));
+  return true;
+}
+
+/**
+ * This function reads the module of an input. A C file is compiled to a bytecode by clang first,
+ * with debug information and without optnone, as the Memory Monitor expects.
+ * @param Input is the path of the input
+ * @param Context is the context of the thread that builds the input
+ */
+static std::unique_ptr<Module> ReadInput(StringRef Input, LLVMContext &Context){
+  std::string Bytecode = Input.str();
+  SmallString<128> Temporary;
+  if(sys::path::extension(Input) == ".c"){
+    if(std::error_code EC = sys::fs::createTemporaryFile("whiro", "bc", Temporary)){
+      Fail(Input, "cannot create a temporary file: " + EC.message());
+      return nullptr;
+    }
+    StringRef Args[] = {ClangPath, "-Xclang", "-disable-O0-optnone", "-fno-discard-value-names", "-g", "-c", "-emit-llvm",
+                        Input, "-o", Temporary};
+    if(!RunProgram(Input, ClangPath, Args)){
+      sys::fs::remove(Temporary);
+      return nullptr;
+    }
+    Bytecode = Temporary.str().str();
+  }
+
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseIRFile(Bytecode, Err, Context);
+  if(!Temporary.empty())
+    sys::fs::remove(Temporary);
+  if(!M)
+    Fail(Input, Err.getMessage());
+  return M;
+}
+
+/**
+ * This function compiles a module to an object file for the host.
+ * @param Input is the path of the input, used in error messages
+ * @param M is the module, already instrumented and linked with the runtime
+ * @param ObjectName is the name of the object file
+ */
+static bool EmitObject(StringRef Input, Module &M, StringRef ObjectName){
+  std::string Triple = sys::getDefaultTargetTriple();
+  std::string Error;
+  const Target* TheTarget = TargetRegistry::lookupTarget(Triple, Error);
+  if(!TheTarget)
+    return Fail(Input, Error);
+
+  //Executables are linked as position independent by default in most systems
+  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(Triple, sys::getHostCPUName(), "", TargetOptions(),
+                                                                   Reloc::PIC_, None, CodeGenOpt::Default));
+  M.setTargetTriple(Triple);
+  M.setDataLayout(TM->createDataLayout());
+
+  std::error_code EC;
+  ToolOutputFile Object(ObjectName, EC, sys::fs::OF_None);
+  if(EC)
+    return Fail(Input, "cannot open " + ObjectName + ": " + EC.message());
+
+  legacy::PassManager CodeGen;
+  if(TM->addPassesToEmitFile(CodeGen, Object.os(), nullptr, CGFT_ObjectFile))
+    return Fail(Input, "the target cannot emit object files");
+  CodeGen.run(M);
+  Object.keep();
+  return true;
+}
+
+/**
+ * This function returns the path of a file of a request, given relative to the directory of the request.
+ * @param Request is the request
+ * @param Path is the path of the file as given in the request
+ */
+static std::string ResolvePath(const BuildRequest &Request, StringRef Path){
+  SmallString<128> Resolved(Path);
+  if(!Request.Directory.empty())
+    sys::fs::make_absolute(Request.Directory, Resolved);
+  return Resolved.str().str();
+}
+
+/**
+ * This function returns the name of the file built for an input, when no name is given.
+ * @param Input is the path of the input
+ */
+static std::string DefaultOutput(StringRef Input){
+  SmallString<128> Name(Input);
+  sys::path::replace_extension(Name, EmitBitcode ? "wbc" : (OnlyCompile ? "o" : "out"));
+  return Name.str().str();
+}
+
+/**
+ * This function builds one input. The module is read once and every step works on it in memory.
+ * @param Request gives the input, the name of the file built and the directory they are relative to
+ * @param Runtime is the bytecode of the runtime, shared by every thread
+ */
+static bool BuildInput(const BuildRequest &Request, MemoryBufferRef Runtime){
+  StringRef Input = Request.Input;
+  std::string OutputPath = ResolvePath(Request, Request.Output);
+  LLVMContext Context;
+  std::unique_ptr<Module> M = ReadInput(ResolvePath(Request, Input), Context);
+  if(!M)
+    return false;
+  //The program names its output files after the source file, as given by the user
+  if(sys::path::extension(Input) == ".c")
+    M->setSourceFileName(Input);
+
+  //Prepare and instrument the program, as opt -mem2reg -mergereturn -memoryMonitor
+  legacy::PassManager Instrumentation;
+  Instrumentation.add(createPromoteMemoryToRegisterPass());
+  Instrumentation.add(createUnifyFunctionExitNodesPass());
+  Instrumentation.add(new MemoryMonitor(Request.Directory));
+  Instrumentation.run(*M);
+
+  if(EmitBitcode){
+    std::error_code EC;
+    ToolOutputFile Bitcode(OutputPath, EC, sys::fs::OF_None);
+    if(EC)
+      return Fail(Input, "cannot write the instrumented module: " + EC.message());
+    WriteBitcodeToFile(*M, Bitcode.os());
+    Bitcode.keep();
+    return true;
+  }
+
+  //Each thread parses the runtime into its own context
+  Expected<std::unique_ptr<Module>> RuntimeModule = parseBitcodeFile(Runtime, Context);
+  if(!RuntimeModule)
+    return Fail(Input, "cannot read the runtime: " + toString(RuntimeModule.takeError()));
+  if(Linker::linkModules(*M, std::move(*RuntimeModule)))
+    return Fail(Input, "cannot link the runtime");
+
+  if(Lto){
+    PassManagerBuilder Builder;
+    Builder.OptLevel = 2;
+    Builder.Inliner = createFunctionInliningPass(2, 0, false);
+    legacy::PassManager Optimization;
+    Builder.populateModulePassManager(Optimization);
+    Optimization.run(*M);
+  }
+
+  if(verifyModule(*M, &errs()))
+    return Fail(Input, "the instrumented module is broken");
+
+  if(OnlyCompile)
+    return EmitObject(Input, *M, OutputPath);
+
+  SmallString<128> ObjectName;
+  if(std::error_code EC = sys::fs::createTemporaryFile("whiro", "o", ObjectName))
+    return Fail(Input, "cannot create a temporary file: " + EC.message());
+  bool Built = EmitObject(Input, *M, ObjectName);
+  if(Built){
+    std::vector<StringRef> Args = {LinkerPath, ObjectName, "-o", OutputPath, "-lpthread", "-lm"};
+    for(const std::string &Flag : LinkFlags)
+      Args.push_back(Flag);
+    Built = RunProgram(Input, LinkerPath, Args);
+  }
+  sys::fs::remove(ObjectName);
+  return Built;
+}
+
+/**
+ * This function runs Worker in QuantThreads threads, counting the current one, and waits for them.
+ * @param QuantThreads is the number of threads
+ * @param Worker is the function run by every thread
+ */
+static void RunWorkers(unsigned QuantThreads, std::function<void()> Worker){
+  std::vector<std::thread> Threads;
+  for(unsigned i = 1; i < QuantThreads; i++)
+    Threads.emplace_back(Worker);
+  Worker();
+  for(std::thread &T : Threads)
+    T.join();
+}
+
+/**
+ * This function writes a whole line to a socket.
+ * @param Socket is the descriptor of the socket
+ * @param Line is the line, with its line break
+ */
+static bool WriteLine(int Socket, const std::string &Line){
+  size_t Written = 0;
+  while(Written < Line.size()){
+    ssize_t Bytes = write(Socket, Line.data() + Written, Line.size() - Written);
+    if(Bytes < 0 && errno == EINTR)
+      continue;
+    if(Bytes <= 0)
+      return false;
+    Written += Bytes;
+  }
+  return true;
+}
+
+/**
+ * This function reads a line from a socket, without its line break.
+ * @param Socket is the descriptor of the socket
+ * @param Buffer holds what was read after the line, for the next call
+ * @param Line receives the line
+ * @return false if the connection was closed before a whole line was read
+ */
+static bool ReadLine(int Socket, std::string &Buffer, std::string &Line){
+  size_t End;
+  while((End = Buffer.find('\n')) == std::string::npos){
+    char Chunk[4096];
+    ssize_t Bytes = read(Socket, Chunk, sizeof(Chunk));
+    if(Bytes < 0 && errno == EINTR)
+      continue;
+    if(Bytes <= 0)
+      return false;
+    Buffer.append(Chunk, Bytes);
+  }
+  Line = Buffer.substr(0, End);
+  Buffer.erase(0, End + 1);
+  return true;
+}
+
+/**
+ * This function opens the socket of the server, or connects to it.
+ * @param Path is the path of the socket
+ * @param Listen tells whether the socket is bound and listened to, or connected
+ * @return the descriptor of the socket, or -1 if it fails
+ */
+static int OpenSocket(StringRef Path, bool Listen){
+  sockaddr_un Address;
+  memset(&Address, 0, sizeof(Address));
+  Address.sun_family = AF_UNIX;
+  if(Path.size() >= sizeof(Address.sun_path)){
+    errs() << "whiro-cc: the path of the socket is too long: " << Path << "\n";
+    return -1;
+  }
+  memcpy(Address.sun_path, Path.data(), Path.size());
+
+  int Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(Socket < 0){
+    errs() << "whiro-cc: cannot create a socket: " << strerror(errno) << "\n";
+    return -1;
+  }
+  if(Listen){
+    unlink(Address.sun_path);
+    if(bind(Socket, (sockaddr*) &Address, sizeof(Address)) == 0 && listen(Socket, SOMAXCONN) == 0)
+      return Socket;
+  }
+  else if(connect(Socket, (sockaddr*) &Address, sizeof(Address)) == 0)
+    return Socket;
+  errs() << "whiro-cc: cannot " << (Listen ? "listen to " : "connect to ") << Path << ": " << strerror(errno) << "\n";
+  close(Socket);
+  return -1;
+}
+
+/**
+ * This function runs the server. Each thread accepts a connection and builds the inputs requested on it,
+ * one per line, until the client closes it. A request is "directory<TAB>input<TAB>output", and it is
+ * answered with "ok" or "error <message>". If the output is empty, the server names it after the input.
+ * The options given to the server apply to every request.
+ * @param Runtime is the bytecode of the runtime, shared by every thread
+ * @param QuantThreads is the number of connections served at once
+ */
+static int Serve(MemoryBufferRef Runtime, unsigned QuantThreads){
+  int Socket = OpenSocket(ServeSocket, true);
+  if(Socket < 0)
+    return 1;
+  //Programs that include the same headers have the same types, whose descriptors are built only once
+  MemoryMonitor::ShareTypeDescriptors();
+  errs() << "whiro-cc: serving on " << ServeSocket << " with " << QuantThreads << " threads\n";
+
+  RunWorkers(QuantThreads, [&](){
+    while(true){
+      int Client = accept(Socket, nullptr, nullptr);
+      if(Client < 0){
+        if(errno == EINTR || errno == ECONNABORTED)
+          continue;
+        break;
+      }
+      std::string Buffer, Line;
+      while(ReadLine(Client, Buffer, Line)){
+        SmallVector<StringRef, 3> Fields;
+        StringRef(Line).split(Fields, '\t');
+        bool Built = false;
+        LastError.clear();
+        if(Fields.size() != 3 || !sys::path::is_absolute(Fields[0]))
+          LastError = "malformed request";
+        else{
+          BuildRequest Request = {Fields[0].str(), Fields[1].str(), Fields[2].str()};
+          if(Request.Output.empty())
+            Request.Output = DefaultOutput(Request.Input);
+          Built = BuildInput(Request, Runtime);
+        }
+        if(!WriteLine(Client, Built ? "ok\n" : "error " + LastError + "\n"))
+          break;
+      }
+      close(Client);
+    }
+  });
+  close(Socket);
+  return 1;
+}
+
+int main(int argc, char** argv){
+  InitLLVM X(argc, argv);
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  cl::ParseCommandLineOptions(argc, argv, "whiro-cc: build programs instrumented by Whiro\n");
+
+  if(!OutputName.empty() && Inputs.size() > 1){
+    errs() << "whiro-cc: -o can only be used with a single input\n";
+    return 1;
+  }
+  if(ServeSocket.empty() && Inputs.empty()){
+    errs() << "whiro-cc: no input files\n";
+    return 1;
+  }
+
+  unsigned QuantThreads = Jobs > 0 ? Jobs : std::thread::hardware_concurrency();
+  if(QuantThreads == 0)
+    QuantThreads = 1;
+  if(ServeSocket.empty() && QuantThreads > Inputs.size())
+    QuantThreads = Inputs.size();
+
+  //Each thread takes the next input not built yet
+  std::atomic<size_t> NextInput(0);
+  std::atomic<unsigned> Failures(0);
+  auto NextRequest = [&](BuildRequest &Request){
+    size_t i = NextInput++;
+    if(i >= Inputs.size())
+      return false;
+    Request.Input = Inputs[i];
+    Request.Output = OutputName;
+    //The server names the files it builds, as its options tell which files they are
+    if(Request.Output.empty() && ConnectSocket.empty())
+      Request.Output = DefaultOutput(Request.Input);
+    return true;
+  };
+
+  //A client sends its inputs to the server, one connection per thread
+  if(!ConnectSocket.empty()){
+    SmallString<128> Directory;
+    if(sys::fs::current_path(Directory)){
+      errs() << "whiro-cc: cannot get the current directory\n";
+      return 1;
+    }
+    RunWorkers(QuantThreads, [&](){
+      int Socket = -1;
+      std::string Buffer, Reply;
+      BuildRequest Request;
+      while(NextRequest(Request)){
+        if(Socket < 0 && (Socket = OpenSocket(ConnectSocket, false)) < 0){
+          Failures++;
+          continue;
+        }
+        if(!WriteLine(Socket, (Directory + "\t" + Request.Input + "\t" + Request.Output + "\n").str()) ||
+           !ReadLine(Socket, Buffer, Reply))
+          Reply = "error the server closed the connection";
+        if(Reply != "ok"){
+          Fail(Request.Input, StringRef(Reply).startswith("error ") ? StringRef(Reply).substr(6) : StringRef(Reply));
+          Failures++;
+        }
+      }
+      if(Socket >= 0)
+        close(Socket);
+    });
+    return Failures > 0 ? 1 : 0;
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Runtime = MemoryBuffer::getFile(RuntimeBitcode);
+  if(!Runtime){
+    errs() << "whiro-cc: cannot read the runtime " << RuntimeBitcode << ": " << Runtime.getError().message() << "\n";
+    return 1;
+  }
+
+  //The options of the pass are resolved before the threads start, so they are only read from now on
+  MemoryMonitor::ResolveOptions();
+
+  if(!ServeSocket.empty())
+    return Serve((*Runtime)->getMemBufferRef(), QuantThreads);
+
+  RunWorkers(QuantThreads, [&](){
+    BuildRequest Request;
+    while(NextRequest(Request)){
+      if(!BuildInput(Request, (*Runtime)->getMemBufferRef()))
+        Failures++;
+    }
+  });
+  return Failures > 0 ? 1 : 0;
+}
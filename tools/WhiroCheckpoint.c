@@ -0,0 +1,30 @@
+#include<stdlib.h>
+#include "../include/CheckpointReader.h"
+
+/**
+ * This tool reads the indexed output files written by programs instrumented with -indexed.
+ * With a point and a call counter, it prints the state reported there, as in the text output.
+ * Otherwise, it lists the inspection points in the file.
+ */
+int main(int argc, char** argv){
+  if (argc != 2 && argc != 4){
+    fprintf(stderr, "Usage: %s <checkpoint file> [<point> <call counter>]\n", argv[0]);
+    fprintf(stderr, "Points are named after their function, followed by @line for points inside functions\n");
+    return 1;
+  }
+
+  WhiroCheckpoint* Checkpoint = WhiroOpenCheckpoint(argv[1]);
+  if (Checkpoint == NULL)
+    return 1;
+
+  int Status = 0;
+  if (argc == 2)
+    WhiroListCheckpoint(Checkpoint, stdout);
+  else if (WhiroPrintCheckpoint(Checkpoint, argv[2], strtoull(argv[3], NULL, 10), stdout) == 0){
+    fprintf(stderr, "The point %s was not reported with the call counter %s\n", argv[2], argv[3]);
+    Status = 1;
+  }
+
+  WhiroCloseCheckpoint(Checkpoint);
+  return Status;
+}
@@ -0,0 +1,404 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<pthread.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include "../include/uthash.h"
+
+//Mark printed after the call counter of the values scalarized by an optimization
+#define WHIRO_SCALARIZED " (scalarized)"
+
+/**
+ * This tool compares two output files of Whiro, such as the outputs of two builds of the same
+ * program, and reports the first inspection point where each variable diverges.
+ * Every line of an output file is a record "name scope counter : value". The records of a variable
+ * (its name and scope) are paired in the order they appear in both files, so the n-th report of
+ * a variable in one file is compared with its n-th report in the other.
+ * The files are mapped in memory and read in rounds. In each round, every thread parses a slice
+ * of both files and splits the records by their function, and then every thread pairs the records
+ * of the functions it owns. Records wait for their pair only while the files are out of step, so
+ * the memory used does not grow with the size of the files. While no record waits for its pair,
+ * rounds that are equal in both files are skipped without being parsed.
+ */
+
+/**
+ * This structure holds a record of an output file
+ * Line is the beginning of the record in the mapped file
+ * LineLength is the size of the record, without the line break
+ * KeyLength is the size of the name and scope of the record
+ * Value is the beginning of the value of the record
+ * ValueLength is the size of the value
+ * Counter is the call counter of the record
+ */
+typedef struct {
+  const char* Line;
+  uint32_t LineLength;
+  uint32_t KeyLength;
+  const char* Value;
+  uint32_t ValueLength;
+  uint64_t Counter;
+} DiffRecord;
+
+/**
+ * This structure holds a growable array of records
+ */
+typedef struct {
+  DiffRecord* Records;
+  size_t Quant;
+  size_t Capacity;
+} RecordList;
+
+/**
+ * This structure holds the state of a variable
+ * Key is the name and scope of the variable
+ * Pending holds the records of one file still waiting for their pair, from Head on
+ * Side is the file the pending records come from
+ * Diverged tells whether the variable diverged. Its records are ignored from then on
+ * First and Second are the records where the variable diverged. A missing record has no line
+ */
+typedef struct {
+  const char* Key;
+  uint32_t KeyLength;
+  RecordList Pending;
+  size_t Head;
+  int Side;
+  int Diverged;
+  DiffRecord First;
+  DiffRecord Second;
+  UT_hash_handle hh;
+} DiffVariable;
+
+/**
+ * This structure holds a mapped output file and the part of it read in the current round
+ */
+typedef struct {
+  const char* Data;
+  size_t Size;
+  size_t Position;
+  size_t *Slices;
+} DiffFile;
+
+static DiffFile Files[2];
+static int QuantThreads = 0;
+static size_t RoundBytes = 64 << 20;
+//The records parsed by each thread in a round, split by partition: Batches[File][Thread][Partition]
+static RecordList ***Batches;
+//The variables owned by each partition
+static DiffVariable **Variables;
+static pthread_barrier_t Barrier;
+static int Finished = 0;
+//The number of records waiting for their pair in each partition
+static size_t *QuantPending;
+
+static void WhiroAppendRecord(RecordList* List, DiffRecord* Record){
+  if (List->Quant == List->Capacity){
+    List->Capacity = List->Capacity ? 2 * List->Capacity : 1024;
+    List->Records = (DiffRecord*) realloc(List->Records, sizeof(DiffRecord) * List->Capacity);
+  }
+  List->Records[List->Quant++] = *Record;
+}
+
+static uint64_t WhiroHashBytes(const char* Data, size_t Length){
+  //FNV-1a, only to spread the functions among the threads
+  uint64_t Hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < Length; i++)
+    Hash = (Hash ^ (unsigned char) Data[i]) * 0x100000001b3ULL;
+  return Hash;
+}
+
+static int WhiroParseRecord(const char* Line, const char* End, DiffRecord* Record, uint64_t* Function){
+  Record->Line = Line;
+  Record->LineLength = End - Line;
+  Record->Counter = 0;
+
+  //Lines that are not records are compared as a whole
+  const char* Separator = memmem(Line, End - Line, " : ", 3);
+  //Values scalarized by an optimization are marked after the counter, and the mark is not part of the key
+  const char* CounterEnd = Separator;
+  if (Separator && (size_t)(Separator - Line) >= sizeof(WHIRO_SCALARIZED) - 1 && memcmp(Separator - (sizeof(WHIRO_SCALARIZED) - 1), WHIRO_SCALARIZED, sizeof(WHIRO_SCALARIZED) - 1) == 0)
+    CounterEnd = Separator - (sizeof(WHIRO_SCALARIZED) - 1);
+  const char* CounterStart = Separator ? memrchr(Line, ' ', CounterEnd - Line) : NULL;
+  if (CounterStart == NULL){
+    Record->KeyLength = End - Line;
+    Record->Value = End;
+    Record->ValueLength = 0;
+    *Function = 0;
+    return 0;
+  }
+
+  Record->KeyLength = CounterStart - Line;
+  Record->Value = Separator + 3;
+  Record->ValueLength = End - Record->Value;
+  for (const char* Digit = CounterStart + 1; Digit < CounterEnd; Digit++)
+    Record->Counter = Record->Counter * 10 + (*Digit - '0');
+
+  //The function is the last word of the scope, as in "(Static) main" or "foo@12"
+  const char* FunctionStart = memrchr(Line, ' ', Record->KeyLength);
+  FunctionStart = FunctionStart ? FunctionStart + 1 : Line;
+  *Function = WhiroHashBytes(FunctionStart, CounterStart - FunctionStart);
+  return 1;
+}
+
+static size_t WhiroNextLine(DiffFile* File, size_t Offset){
+  if (Offset >= File->Size)
+    return File->Size;
+  const char* Break = memchr(File->Data + Offset, '\n', File->Size - Offset);
+  return Break ? (size_t)(Break - File->Data) + 1 : File->Size;
+}
+
+static void WhiroSliceRound(DiffFile* File){
+  //The round is split in one slice per thread, cut at line breaks
+  size_t RoundEnd = (File->Size - File->Position > RoundBytes) ? WhiroNextLine(File, File->Position + RoundBytes) : File->Size;
+  size_t SliceBytes = (RoundEnd - File->Position) / QuantThreads + 1;
+  File->Slices[0] = File->Position;
+  for (int i = 1; i < QuantThreads; i++){
+    size_t Cut = File->Slices[i - 1] + SliceBytes;
+    File->Slices[i] = (Cut >= RoundEnd) ? RoundEnd : WhiroNextLine(File, Cut - 1);
+  }
+  File->Slices[QuantThreads] = RoundEnd;
+}
+
+static void WhiroParseSlice(int FileId, int Thread){
+  DiffFile* File = &Files[FileId];
+  RecordList* Partitions = Batches[FileId][Thread];
+  for (int i = 0; i < QuantThreads; i++)
+    Partitions[i].Quant = 0;
+
+  const char* Line = File->Data + File->Slices[Thread];
+  const char* SliceEnd = File->Data + File->Slices[Thread + 1];
+  while (Line < SliceEnd){
+    const char* End = memchr(Line, '\n', SliceEnd - Line);
+    if (End == NULL)
+      End = SliceEnd;
+
+    DiffRecord Record;
+    uint64_t Function;
+    WhiroParseRecord(Line, End, &Record, &Function);
+    WhiroAppendRecord(&Partitions[Function % QuantThreads], &Record);
+    Line = End + 1;
+  }
+}
+
+static void WhiroSetDivergence(int Partition, DiffVariable* Variable, DiffRecord* First, DiffRecord* Second){
+  Variable->Diverged = 1;
+  QuantPending[Partition] -= Variable->Pending.Quant - Variable->Head;
+  memset(&Variable->First, 0, sizeof(DiffRecord));
+  memset(&Variable->Second, 0, sizeof(DiffRecord));
+  if (First)
+    Variable->First = *First;
+  if (Second)
+    Variable->Second = *Second;
+  free(Variable->Pending.Records);
+  memset(&Variable->Pending, 0, sizeof(RecordList));
+}
+
+static void WhiroPairRecord(int Partition, int FileId, DiffRecord* Record){
+  DiffVariable* Variable;
+  HASH_FIND(hh, Variables[Partition], Record->Line, Record->KeyLength, Variable);
+  if (Variable == NULL){
+    Variable = (DiffVariable*) calloc(1, sizeof(DiffVariable));
+    Variable->Key = Record->Line;
+    Variable->KeyLength = Record->KeyLength;
+    HASH_ADD_KEYPTR(hh, Variables[Partition], Variable->Key, Variable->KeyLength, Variable);
+  }
+  if (Variable->Diverged)
+    return;
+
+  //The record waits for its pair if the other file did not reach it yet
+  if (Variable->Head == Variable->Pending.Quant || Variable->Side == FileId){
+    if (Variable->Head == Variable->Pending.Quant)
+      Variable->Head = Variable->Pending.Quant = 0;
+    Variable->Side = FileId;
+    WhiroAppendRecord(&Variable->Pending, Record);
+    QuantPending[Partition]++;
+    return;
+  }
+
+  DiffRecord* Pair = &Variable->Pending.Records[Variable->Head++];
+  QuantPending[Partition]--;
+  DiffRecord* First = (FileId == 0) ? Record : Pair;
+  DiffRecord* Second = (FileId == 0) ? Pair : Record;
+  if (First->Counter != Second->Counter || First->ValueLength != Second->ValueLength || memcmp(First->Value, Second->Value, First->ValueLength) != 0)
+    WhiroSetDivergence(Partition, Variable, First, Second);
+}
+
+static void WhiroPairPartition(int Partition){
+  //Slices are visited in the order of the files, so the records of a variable are paired in order
+  for (int Thread = 0; Thread < QuantThreads; Thread++){
+    for (int FileId = 0; FileId < 2; FileId++){
+      RecordList* List = &Batches[FileId][Thread][Partition];
+      for (size_t i = 0; i < List->Quant; i++)
+        WhiroPairRecord(Partition, FileId, &List->Records[i]);
+    }
+  }
+}
+
+static void WhiroReleaseRound(DiffFile* File){
+  //The pages of a finished round are dropped from memory. Records still waiting for their pair point to them,
+  //but the mapping is never written, so those pages are read back from the file if needed
+  size_t PageSize = sysconf(_SC_PAGESIZE);
+  size_t Begin = File->Position / PageSize * PageSize;
+  size_t End = File->Slices[QuantThreads] / PageSize * PageSize;
+  if (End > Begin)
+    madvise((void*)(File->Data + Begin), End - Begin, MADV_DONTNEED);
+  File->Position = File->Slices[QuantThreads];
+}
+
+static void WhiroPrepareRound(){
+  while (1){
+    Finished = Files[0].Position == Files[0].Size && Files[1].Position == Files[1].Size;
+    if (Finished)
+      return;
+    WhiroSliceRound(&Files[0]);
+    WhiroSliceRound(&Files[1]);
+
+    //If no record waits for its pair, equal rounds would pair every record with an equal one
+    size_t Pending = 0;
+    for (int i = 0; i < QuantThreads; i++)
+      Pending += QuantPending[i];
+    size_t Length = Files[0].Slices[QuantThreads] - Files[0].Position;
+    if (Pending > 0 || Length != Files[1].Slices[QuantThreads] - Files[1].Position || memcmp(Files[0].Data + Files[0].Position, Files[1].Data + Files[1].Position, Length) != 0)
+      return;
+    WhiroReleaseRound(&Files[0]);
+    WhiroReleaseRound(&Files[1]);
+  }
+}
+
+static void* WhiroDiffWorker(void* Arg){
+  int Thread = (int)(intptr_t) Arg;
+  while (1){
+    //The first thread cuts the next round of both files
+    if (Thread == 0)
+      WhiroPrepareRound();
+    pthread_barrier_wait(&Barrier);
+    if (Finished)
+      break;
+
+    WhiroParseSlice(0, Thread);
+    WhiroParseSlice(1, Thread);
+    pthread_barrier_wait(&Barrier);
+
+    WhiroPairPartition(Thread);
+    pthread_barrier_wait(&Barrier);
+    if (Thread == 0){
+      WhiroReleaseRound(&Files[0]);
+      WhiroReleaseRound(&Files[1]);
+    }
+  }
+  return NULL;
+}
+
+static int WhiroMapFile(const char* FileName, DiffFile* File){
+  int Descriptor = open(FileName, O_RDONLY);
+  struct stat Status;
+  if (Descriptor < 0 || fstat(Descriptor, &Status) != 0){
+    fprintf(stderr, "Error opening output file %s\n", FileName);
+    return 0;
+  }
+
+  File->Size = Status.st_size;
+  File->Position = 0;
+  File->Slices = (size_t*) calloc(QuantThreads + 1, sizeof(size_t));
+  File->Data = "";
+  if (File->Size > 0){
+    File->Data = (const char*) mmap(NULL, File->Size, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+    if (File->Data == MAP_FAILED){
+      fprintf(stderr, "Error mapping output file %s\n", FileName);
+      close(Descriptor);
+      return 0;
+    }
+    madvise((void*) File->Data, File->Size, MADV_SEQUENTIAL);
+  }
+  close(Descriptor);
+  return 1;
+}
+
+static size_t WhiroRecordPosition(DiffVariable* Variable){
+  return Variable->First.Line ? (size_t)(Variable->First.Line - Files[0].Data) : (size_t)(Variable->Second.Line - Files[1].Data) + Files[0].Size;
+}
+
+static int WhiroCompareDivergences(const void* A, const void* B){
+  //Divergences are reported in the order of the first file. Records missing from it come last
+  size_t PositionA = WhiroRecordPosition(*(DiffVariable**) A);
+  size_t PositionB = WhiroRecordPosition(*(DiffVariable**) B);
+  return (PositionA < PositionB) ? -1 : (PositionA > PositionB);
+}
+
+int main(int argc, char** argv){
+  int Argument = 1;
+  for (; Argument < argc && argv[Argument][0] == '-'; Argument++){
+    if (strcmp(argv[Argument], "-j") == 0 && Argument + 1 < argc)
+      QuantThreads = atoi(argv[++Argument]);
+    else if (strcmp(argv[Argument], "-round") == 0 && Argument + 1 < argc)
+      RoundBytes = (size_t) atol(argv[++Argument]) << 20;
+    else
+      break;
+  }
+  if (QuantThreads == 0)
+    QuantThreads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (argc - Argument != 2 || QuantThreads < 1 || RoundBytes == 0){
+    fprintf(stderr, "Usage: %s [-j <threads>] [-round <MB>] <output file> <output file>\n", argv[0]);
+    fprintf(stderr, "By default, it uses one thread per core and reads 64 MB of each file per round\n");
+    return 2;
+  }
+  if (!WhiroMapFile(argv[Argument], &Files[0]) || !WhiroMapFile(argv[Argument + 1], &Files[1]))
+    return 2;
+
+  Batches = (RecordList***) malloc(sizeof(RecordList**) * 2);
+  for (int FileId = 0; FileId < 2; FileId++){
+    Batches[FileId] = (RecordList**) malloc(sizeof(RecordList*) * QuantThreads);
+    for (int Thread = 0; Thread < QuantThreads; Thread++)
+      Batches[FileId][Thread] = (RecordList*) calloc(QuantThreads, sizeof(RecordList));
+  }
+  Variables = (DiffVariable**) calloc(QuantThreads, sizeof(DiffVariable*));
+  QuantPending = (size_t*) calloc(QuantThreads, sizeof(size_t));
+
+  pthread_barrier_init(&Barrier, NULL, QuantThreads);
+  pthread_t* Threads = (pthread_t*) malloc(sizeof(pthread_t) * QuantThreads);
+  for (int Thread = 1; Thread < QuantThreads; Thread++)
+    pthread_create(&Threads[Thread], NULL, WhiroDiffWorker, (void*)(intptr_t) Thread);
+  WhiroDiffWorker((void*) 0);
+  for (int Thread = 1; Thread < QuantThreads; Thread++)
+    pthread_join(Threads[Thread], NULL);
+
+  //Records still waiting for a pair are missing from the other file
+  size_t QuantVariables = 0, QuantDivergences = 0;
+  for (int Partition = 0; Partition < QuantThreads; Partition++)
+    QuantVariables += HASH_COUNT(Variables[Partition]);
+  DiffVariable** Divergences = (DiffVariable**) malloc(sizeof(DiffVariable*) * (QuantVariables + 1));
+  for (int Partition = 0; Partition < QuantThreads; Partition++){
+    DiffVariable *Variable, *Next;
+    HASH_ITER(hh, Variables[Partition], Variable, Next){
+      if (!Variable->Diverged && Variable->Head < Variable->Pending.Quant){
+        DiffRecord* Missing = &Variable->Pending.Records[Variable->Head];
+        WhiroSetDivergence(Partition, Variable, Variable->Side == 0 ? Missing : NULL, Variable->Side == 1 ? Missing : NULL);
+      }
+      if (Variable->Diverged)
+        Divergences[QuantDivergences++] = Variable;
+    }
+  }
+
+  //Each divergence is printed as the records of both files, as diff does. A missing record is not printed
+  qsort(Divergences, QuantDivergences, sizeof(DiffVariable*), WhiroCompareDivergences);
+  for (size_t i = 0; i < QuantDivergences; i++){
+    DiffVariable* Variable = Divergences[i];
+    if (Variable->First.Line)
+      printf("< %.*s\n", (int) Variable->First.LineLength, Variable->First.Line);
+    else
+      printf("< (no report of %.*s)\n", (int) Variable->KeyLength, Variable->Key);
+    if (Variable->Second.Line)
+      printf("> %.*s\n", (int) Variable->Second.LineLength, Variable->Second.Line);
+    else
+      printf("> (no report of %.*s)\n", (int) Variable->KeyLength, Variable->Key);
+  }
+  fflush(stdout);
+  fprintf(stderr, "%zu variables diverge\n", QuantDivergences);
+  return QuantDivergences > 0;
+}
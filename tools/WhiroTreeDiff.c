@@ -0,0 +1,315 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include "../include/uthash.h"
+#include "../include/HashTree.h"
+
+/**
+ * This tool compares two files of hash trees, written by programs instrumented with -hash-tree-file,
+ * such as the trees of two builds of the same program. The trees of an array (its name, scope and call
+ * counter) are paired in the order they appear in both files. When the roots of a pair differ, the
+ * tool descends only into the children whose hashcodes differ, so it finds each range of differing
+ * elements reading a logarithmic number of nodes, and prints the ranges.
+ */
+
+/**
+ * This structure holds a tree of a file of trees
+ * Record is the header of the tree
+ * Name and Scope point into the mapped file
+ * Nodes points to the first leaf of the tree in the mapped file. Nodes may be unaligned
+ * Key is the name, scope, call counter and occurrence of the tree
+ * Paired tells whether a tree of the other file was paired with this one
+ */
+typedef struct {
+  WhiroTreeRecord Record;
+  const char* Name;
+  const char* Scope;
+  const unsigned char* Nodes;
+  char* Key;
+  int Paired;
+  UT_hash_handle hh;
+} TreeEntry;
+
+/**
+ * This structure counts the trees of a name, scope and call counter seen so far in a file
+ */
+typedef struct {
+  char* Key;
+  uint32_t Quant;
+  UT_hash_handle hh;
+} KeyCount;
+
+/**
+ * This structure holds a mapped file of trees and its trees
+ */
+typedef struct {
+  const char* FileName;
+  const unsigned char* Data;
+  size_t Size;
+  TreeEntry* Trees;
+  size_t QuantTrees;
+} TreeFile;
+
+//Ranges of differing elements are merged while they are adjacent, and printed when they end
+typedef struct {
+  uint64_t First;
+  uint64_t Last;
+  int Open;
+} ElementRange;
+
+static uint64_t WhiroReadNode(const TreeEntry *Tree, uint64_t Index){
+  uint64_t Node;
+  memcpy(&Node, Tree->Nodes + Index * sizeof(uint64_t), sizeof(uint64_t));
+  return Node;
+}
+
+/**
+ * This function checks the header of a tree read from a file, so a corrupted header cannot make the
+ * comparison read outside of the tree.
+ * @return true if the levels and the nodes of the tree follow from its elements, chunks and fanout
+ */
+static int WhiroIsValidTree(const WhiroTreeRecord *Record){
+  if (Record->Fanout < 2 || Record->ChunkElements == 0 || Record->QuantLevels < 1)
+    return 0;
+
+  uint64_t Width = Record->TotalElements / Record->ChunkElements + (Record->TotalElements % Record->ChunkElements != 0);
+  uint64_t QuantNodes = 0;
+  uint32_t QuantLevels = 0;
+  for (Width = Width ? Width : 1; ; Width = Width / Record->Fanout + (Width % Record->Fanout != 0)){
+    QuantNodes += Width;
+    QuantLevels++;
+    if (Width == 1)
+      break;
+  }
+  return QuantLevels == Record->QuantLevels && QuantNodes == Record->QuantNodes;
+}
+
+static int WhiroMapTrees(TreeFile *File){
+  int Descriptor = open(File->FileName, O_RDONLY);
+  if (Descriptor < 0){
+    fprintf(stderr, "Error opening %s\n", File->FileName);
+    return 0;
+  }
+  struct stat Status;
+  fstat(Descriptor, &Status);
+  File->Size = Status.st_size;
+  if (File->Size < 8){
+    fprintf(stderr, "%s is not a file of hash trees\n", File->FileName);
+    close(Descriptor);
+    return 0;
+  }
+  File->Data = (const unsigned char*) mmap(NULL, File->Size, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+  close(Descriptor);
+  if (File->Data == MAP_FAILED || memcmp(File->Data, WHIRO_TREE_MAGIC, 8) != 0){
+    fprintf(stderr, "%s is not a file of hash trees\n", File->FileName);
+    return 0;
+  }
+
+  //Only the headers are read. The nodes stay in the file until a pair of trees differs
+  KeyCount *Counts = NULL, *Count, *Next;
+  size_t Capacity = 0, Position = 8;
+  while (Position + sizeof(WhiroTreeRecord) <= File->Size){
+    WhiroTreeRecord Record;
+    memcpy(&Record, File->Data + Position, sizeof(WhiroTreeRecord));
+    if (!WhiroIsValidTree(&Record) || Record.QuantNodes > File->Size / sizeof(uint64_t)){
+      fprintf(stderr, "%s has a malformed tree. It and the trees after it are ignored\n", File->FileName);
+      break;
+    }
+    size_t Length = sizeof(WhiroTreeRecord) + Record.NameLength + Record.ScopeLength + Record.QuantNodes * sizeof(uint64_t);
+    if (Position + Length > File->Size){
+      fprintf(stderr, "%s is truncated. Its last tree is ignored\n", File->FileName);
+      break;
+    }
+
+    if (File->QuantTrees == Capacity){
+      Capacity = Capacity ? 2 * Capacity : 1024;
+      File->Trees = (TreeEntry*) realloc(File->Trees, sizeof(TreeEntry) * Capacity);
+    }
+    TreeEntry *Tree = &File->Trees[File->QuantTrees++];
+    memset(Tree, 0, sizeof(TreeEntry));
+    Tree->Record = Record;
+    Tree->Name = (const char*) File->Data + Position + sizeof(WhiroTreeRecord);
+    Tree->Scope = Tree->Name + Record.NameLength;
+    Tree->Nodes = (const unsigned char*) Tree->Scope + Record.ScopeLength;
+    Position += Length;
+
+    //The n-th tree of an array at a call counter is paired with its n-th tree in the other file
+    char *Base = NULL;
+    if (asprintf(&Base, "%.*s %.*s %ld", (int) Record.NameLength, Tree->Name, (int) Record.ScopeLength, Tree->Scope, (long) Record.CallCounter) < 0)
+      return 0;
+    HASH_FIND_STR(Counts, Base, Count);
+    if (Count == NULL){
+      Count = (KeyCount*) calloc(1, sizeof(KeyCount));
+      Count->Key = Base;
+      HASH_ADD_KEYPTR(hh, Counts, Count->Key, strlen(Count->Key), Count);
+    }
+    else
+      free(Base);
+    if (asprintf(&Tree->Key, "%s #%u", Count->Key, Count->Quant++) < 0)
+      return 0;
+  }
+
+  HASH_ITER(hh, Counts, Count, Next){
+    HASH_DEL(Counts, Count);
+    free(Count->Key);
+    free(Count);
+  }
+  return 1;
+}
+
+static void WhiroPrintTree(const char* Side, const TreeEntry *Tree, const char* Message){
+  printf("%s %.*s %.*s %ld : %s\n", Side, (int) Tree->Record.NameLength, Tree->Name, (int) Tree->Record.ScopeLength, Tree->Scope, (long) Tree->Record.CallCounter, Message);
+}
+
+static void WhiroCloseRange(const TreeEntry *Tree, ElementRange *Range){
+  if (!Range->Open)
+    return;
+  printf("%.*s %.*s %ld : elements %lu-%lu differ\n", (int) Tree->Record.NameLength, Tree->Name, (int) Tree->Record.ScopeLength, Tree->Scope,
+         (long) Tree->Record.CallCounter, Range->First, Range->Last);
+  Range->Open = 0;
+}
+
+/**
+ * This function descends from a node that differs in both trees into its children that differ, and
+ * reports the elements of the leaves that differ.
+ * @param First and Second are the pair of trees
+ * @param Levels holds the index of the first node of each level
+ * @param Height is the level of the node, zero for the leaves
+ * @param Index is the index of the node in its level
+ * @param Widths holds the amount of nodes of each level
+ * @param Range is the range of differing elements being built
+ * @return the amount of nodes read in each tree
+ */
+static uint64_t WhiroDescend(const TreeEntry *First, const TreeEntry *Second, const uint64_t *Levels, const uint64_t *Widths, uint32_t Height, uint64_t Index, ElementRange *Range){
+  const WhiroTreeRecord *Record = &First->Record;
+  if (Height == 0){
+    uint64_t Begin = Index * Record->ChunkElements;
+    uint64_t End = Begin + Record->ChunkElements;
+    if (End > Record->TotalElements)
+      End = Record->TotalElements;
+    if (Range->Open && Range->Last + 1 == Begin)
+      Range->Last = End - 1;
+    else{
+      WhiroCloseRange(First, Range);
+      Range->First = Begin;
+      Range->Last = End - 1;
+      Range->Open = 1;
+    }
+    return 0;
+  }
+
+  uint64_t Reads = 0;
+  uint64_t Child = Index * Record->Fanout;
+  uint64_t LastChild = Child + Record->Fanout;
+  if (LastChild > Widths[Height - 1])
+    LastChild = Widths[Height - 1];
+  for (; Child < LastChild; Child++){
+    Reads++;
+    if (WhiroReadNode(First, Levels[Height - 1] + Child) != WhiroReadNode(Second, Levels[Height - 1] + Child))
+      Reads += WhiroDescend(First, Second, Levels, Widths, Height - 1, Child, Range);
+  }
+  return Reads;
+}
+
+/**
+ * This function compares a pair of trees, and prints the ranges of elements where they differ.
+ * @param Verbose tells whether the amount of nodes read is printed
+ * @return true if the arrays differ
+ */
+static int WhiroCompareTrees(const TreeEntry *First, const TreeEntry *Second, int Verbose){
+  const WhiroTreeRecord *A = &First->Record, *B = &Second->Record;
+  if (A->TotalElements != B->TotalElements || A->ChunkElements != B->ChunkElements || A->Format != B->Format || A->Fanout != B->Fanout || A->QuantNodes != B->QuantNodes){
+    char Message[128];
+    snprintf(Message, sizeof(Message), "%lu elements in chunks of %lu", A->TotalElements, A->ChunkElements);
+    WhiroPrintTree("<", First, Message);
+    snprintf(Message, sizeof(Message), "%lu elements in chunks of %lu", B->TotalElements, B->ChunkElements);
+    WhiroPrintTree(">", Second, Message);
+    return 1;
+  }
+
+  if (WhiroReadNode(First, A->QuantNodes - 1) == WhiroReadNode(Second, A->QuantNodes - 1))
+    return 0;
+
+  //The levels are stored from the leaves up, so the first node of each level follows from the widths below it. The
+  //amount of levels was checked against the shape of the tree when the file was mapped
+  uint64_t Levels[A->QuantLevels], Widths[A->QuantLevels];
+  uint64_t Offset = 0, Width = A->TotalElements / A->ChunkElements + (A->TotalElements % A->ChunkElements != 0);
+  if (Width == 0)
+    Width = 1;
+  for (uint32_t i = 0; i < A->QuantLevels; i++){
+    Levels[i] = Offset;
+    Widths[i] = Width;
+    Offset += Width;
+    Width = Width / A->Fanout + (Width % A->Fanout != 0);
+  }
+
+  ElementRange Range;
+  memset(&Range, 0, sizeof(ElementRange));
+  uint64_t Reads = WhiroDescend(First, Second, Levels, Widths, A->QuantLevels - 1, 0, &Range);
+  WhiroCloseRange(First, &Range);
+  if (Verbose)
+    fprintf(stderr, "%.*s %.*s %ld : %lu of %lu nodes read\n", (int) A->NameLength, First->Name, (int) A->ScopeLength, First->Scope, (long) A->CallCounter, Reads + 1, A->QuantNodes);
+  return 1;
+}
+
+int main(int argc, char** argv){
+  int Verbose = 0, Argument = 1;
+  if (argc > 1 && strcmp(argv[1], "-v") == 0){
+    Verbose = 1;
+    Argument++;
+  }
+  if (argc - Argument != 2){
+    fprintf(stderr, "Usage: %s [-v] <tree file> <tree file>\n", argv[0]);
+    fprintf(stderr, "Tree files are written by programs instrumented with -hash-tree-file\n");
+    return 2;
+  }
+
+  TreeFile Files[2];
+  memset(Files, 0, sizeof(Files));
+  Files[0].FileName = argv[Argument];
+  Files[1].FileName = argv[Argument + 1];
+  if (!WhiroMapTrees(&Files[0]) || !WhiroMapTrees(&Files[1]))
+    return 2;
+
+  TreeEntry *Index = NULL, *Tree;
+  for (size_t i = 0; i < Files[1].QuantTrees; i++){
+    Tree = &Files[1].Trees[i];
+    HASH_ADD_KEYPTR(hh, Index, Tree->Key, strlen(Tree->Key), Tree);
+  }
+
+  int Status = 0;
+  for (size_t i = 0; i < Files[0].QuantTrees; i++){
+    TreeEntry *First = &Files[0].Trees[i];
+    HASH_FIND_STR(Index, First->Key, Tree);
+    if (Tree == NULL){
+      WhiroPrintTree("<", First, "missing from the second file");
+      Status = 1;
+      continue;
+    }
+    Tree->Paired = 1;
+    Status |= WhiroCompareTrees(First, Tree, Verbose);
+  }
+  for (size_t i = 0; i < Files[1].QuantTrees; i++){
+    if (!Files[1].Trees[i].Paired){
+      WhiroPrintTree(">", &Files[1].Trees[i], "missing from the first file");
+      Status = 1;
+    }
+  }
+
+  HASH_CLEAR(hh, Index);
+  for (int f = 0; f < 2; f++){
+    for (size_t i = 0; i < Files[f].QuantTrees; i++)
+      free(Files[f].Trees[i].Key);
+    free(Files[f].Trees);
+    munmap((void*) Files[f].Data, Files[f].Size);
+  }
+  return Status;
+}